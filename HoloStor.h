@@ -37,8 +37,8 @@
 extern "C" {
 #endif
 
-#define HOLOSTOR_VERSION		"1.0.4"
-#define HOLOSTOR_VERSION_NUM	0x010004
+#define HOLOSTOR_VERSION		"1.1.0"
+#define HOLOSTOR_VERSION_NUM	0x010100
 
 #define HOLOSTORAPI
 
@@ -51,6 +51,47 @@ typedef struct _HOLOSTOR_CFG {
   unsigned int	EccBlocks;			// Redundancy blocks per reliability group
 } HOLOSTOR_CFG;
 
+// The options of HoloStor_CreateSessionEx().  Size is that of the structure as
+// the caller knows it:  the members beyond Size are taken as 0, so that a
+// caller built against an older HoloStor.h gets the defaults of the newer
+// members.  A Size beyond that of this release fails the call.
+typedef struct _HOLOSTOR_OPTIONS {
+  unsigned int	Size;				// sizeof(HOLOSTOR_OPTIONS)
+  unsigned int	Flags;				// HOLOSTOR_FLAG_* options (0 for none)
+  unsigned int	Method;				// Method limit if HOLOSTOR_FLAG_METHOD
+} HOLOSTOR_OPTIONS;
+
+// Session options (HOLOSTOR_OPTIONS Flags)
+#define HOLOSTOR_FLAG_NONTEMPORAL	(1u<<0)	// Output blocks bypass the CPU cache
+#define HOLOSTOR_FLAG_METHOD		(1u<<1)	// Method limits this session's method
+#define HOLOSTOR_FLAG_GF256			(1u<<2)	// Code bytes over GF(2**8) (see below)
+#define HOLOSTOR_FLAG_BITSLICED		(1u<<3)	// With GF256: bit-sliced layout (see below)
+#define HOLOSTOR_FLAG_MINXOR		(1u<<4)	// Encoding matrix of fewest XORs (see below)
+#define HOLOSTOR_FLAG_LAZY			(1u<<5)	// Recovery matrices built on use (see below)
+#define HOLOSTOR_FLAGS_VALID		\
+	(HOLOSTOR_FLAG_NONTEMPORAL|HOLOSTOR_FLAG_METHOD|HOLOSTOR_FLAG_GF256|	\
+	 HOLOSTOR_FLAG_BITSLICED|HOLOSTOR_FLAG_MINXOR|HOLOSTOR_FLAG_LAZY)
+
+// A HOLOSTOR_FLAG_GF256 session codes each byte of a block as an element of
+// GF(2**8) (the polynomial x^8+x^4+x^3+x^2+1), rather than in the bit-sliced
+// layout of GF(2**4).  It allows up to 255 Data+ECC blocks (rather than 17),
+// which HoloStor_DecodeEx() and HoloStor_RebuildEx() take a mask of.
+//
+// With HOLOSTOR_FLAG_BITSLICED as well, the symbols of GF(2**8) are instead
+// bit-sliced: each 512 bytes of a block hold 512 symbols, bit i of them in
+// bytes 64*i to 64*i+63.  BlockSize must then be a multiple of 512.
+//
+// HOLOSTOR_FLAG_MINXOR selects, in place of the default encoding matrix, one
+// that is searched for the fewest XORs in the bit-sliced layouts, both to encode
+// and to recover a single Data block.  The ECC blocks differ from those of the
+// default matrix, so the flag must be the same for every session that codes
+// the same blocks.  The search adds to the time of HoloStor_CreateSession().
+//
+// HoloStor_CreateSession() builds a recovery matrix for every combination of
+// up to EccBlocks invalid blocks.  HOLOSTOR_FLAG_LAZY builds only that of
+// HoloStor_Encode(), and each other one by the first call that needs it (which
+// may then fail with HOLOSTOR_STATUS_NO_MEMORY); see also HoloStor_Warmup().
+
 typedef int HOLOSTOR_SESSION;
 
 // Function return values
@@ -62,12 +103,24 @@ typedef int HOLOSTOR_SESSION;
 #define HOLOSTOR_STATUS_BAD_SESSION			(-5)
 #define HOLOSTOR_STATUS_MISALIGNED_BUFFER	(-6)
 #define HOLOSTOR_STATUS_TOO_MANY_SESSIONS	(-7)
+#define HOLOSTOR_STATUS_QUEUE_FULL			(-8)
 
 HOLOSTORAPI HOLOSTOR_SESSION
 HoloStor_CreateSession(
   const HOLOSTOR_CFG*	lpConfiguration
   );
 
+// As HoloStor_CreateSession(), with the options of the session (NULL for the
+// defaults, as HoloStor_CreateSession()).
+HOLOSTORAPI HOLOSTOR_SESSION
+HoloStor_CreateSessionEx(
+  const HOLOSTOR_CFG*	lpConfiguration,
+  const HOLOSTOR_OPTIONS* lpOptions
+  );
+
+// A session may be closed while other threads are still in calls on it:  it
+// is deleted when the last of them returns, and its handle is invalid for any
+// call made after the close (even once the handle's slot is reused).
 HOLOSTORAPI int
 HoloStor_CloseSession(
   IN HOLOSTOR_SESSION	hSession
@@ -94,6 +147,24 @@ HoloStor_Rebuild(
   IN int			lWhichBlock			// Block index to rebuild (-1 all)
   );
 
+// As HoloStor_Decode() and HoloStor_Rebuild(), for more than 32 blocks.  Block
+// i is invalid if bit i%32 of lpInvalidBlockMask[i/32] is on, and the mask is
+// (DataBlocks+EccBlocks+31)/32 words long.
+HOLOSTORAPI int
+HoloStor_DecodeEx(
+  IN HOLOSTOR_SESSION	hSession,
+  IN OUT void**		lpBlockGroup,		// IN Data & ECC; OUT missing data
+  IN const unsigned int* lpInvalidBlockMask	// Mask of buffers with invalid data
+  );
+
+HOLOSTORAPI int
+HoloStor_RebuildEx(
+  IN HOLOSTOR_SESSION	hSession,
+  IN OUT void**		lpBlockGroup, 		// IN Data & ECC; OUT as specified
+  IN const unsigned int* lpInvalidBlockMask,	// Mask of buffers with invalid data
+  IN int			lWhichBlock			// Block index to rebuild (-1 all)
+  );
+
 HOLOSTORAPI int
 HoloStor_WriteDelta(
   IN HOLOSTOR_SESSION	hSession,
@@ -112,15 +183,188 @@ HoloStor_EncodeDelta(
   OUT void*			lpEccBlockNew		// Returned new ECC block
   );
 
+// As HoloStor_Encode(), HoloStor_DecodeEx(), HoloStor_RebuildEx(),
+// HoloStor_WriteDelta() and HoloStor_EncodeDelta(), for only the bytes
+// lOffset thru lOffset+lLength-1 of each block (e.g. of a small write or a
+// degraded read); the other bytes are neither read nor written.  The buffers
+// are still those of the whole blocks.  lOffset and lLength must be multiples
+// of 64 (of 512 with HOLOSTOR_FLAG_BITSLICED), and lLength non-zero.
+HOLOSTORAPI int
+HoloStor_EncodeRange(
+  IN HOLOSTOR_SESSION	hSession,
+  IN OUT void**		lpBlockGroup,		// IN Data; OUT all ECC
+  IN unsigned int	lOffset,			// Byte offset of the range in each block
+  IN unsigned int	lLength				// Bytes in the range
+  );
+
+HOLOSTORAPI int
+HoloStor_DecodeRange(
+  IN HOLOSTOR_SESSION	hSession,
+  IN OUT void**		lpBlockGroup,		// IN Data & ECC; OUT missing data
+  IN const unsigned int* lpInvalidBlockMask,	// Mask of buffers with invalid data
+  IN unsigned int	lOffset,			// Byte offset of the range in each block
+  IN unsigned int	lLength				// Bytes in the range
+  );
+
+HOLOSTORAPI int
+HoloStor_RebuildRange(
+  IN HOLOSTOR_SESSION	hSession,
+  IN OUT void**		lpBlockGroup, 		// IN Data & ECC; OUT as specified
+  IN const unsigned int* lpInvalidBlockMask,	// Mask of buffers with invalid data
+  IN int			lWhichBlock,		// Block index to rebuild (-1 all)
+  IN unsigned int	lOffset,			// Byte offset of the range in each block
+  IN unsigned int	lLength				// Bytes in the range
+  );
+
+HOLOSTORAPI int
+HoloStor_WriteDeltaRange(
+  IN HOLOSTOR_SESSION	hSession,
+  IN const void*	lpDataBlockOld,		// Data block before updating
+  IN const void*	lpDataBlockNew,		// New contents of the data block
+  OUT void*			lpDeltaBlock,		// Delta for forwarding to ECC's
+  IN unsigned int	lOffset,			// Byte offset of the range in each block
+  IN unsigned int	lLength				// Bytes in the range
+  );
+
+HOLOSTORAPI int
+HoloStor_EncodeDeltaRange(
+  IN HOLOSTOR_SESSION	hSession,
+  IN unsigned int	lDataIndex,			// Data block index of delta
+  IN const void*	lpDeltaBlock,		// Forwarded data delta
+  IN unsigned int	lEccIndex,			// ECC block index being updated
+  IN const void*	lpEccBlockOld,		// Old ECC block
+  OUT void*			lpEccBlockNew,		// Returned new ECC block
+  IN unsigned int	lOffset,			// Byte offset of the range in each block
+  IN unsigned int	lLength				// Bytes in the range
+  );
+
+// As HoloStor_Encode() and HoloStor_DecodeEx() on each of nGroups stripes,
+// lpBlockGroups[s] being the block group of stripe s.  The mask of stripe s
+// is the (DataBlocks+EccBlocks+31)/32 words at lpInvalidBlockMasks +
+// s*((DataBlocks+EccBlocks+31)/32).  The stripes that have the same invalid
+// blocks are coded together, which costs less than a call per stripe.  Every
+// stripe is checked before any is coded; a failure of HoloStor_DecodeBatch()
+// with HOLOSTOR_STATUS_NO_MEMORY may leave some of the stripes decoded.
+HOLOSTORAPI int
+HoloStor_EncodeBatch(
+  IN HOLOSTOR_SESSION	hSession,
+  IN OUT void***	lpBlockGroups,		// IN Data; OUT all ECC (each stripe)
+  IN unsigned int	nGroups				// Stripes in the batch
+  );
+
+HOLOSTORAPI int
+HoloStor_DecodeBatch(
+  IN HOLOSTOR_SESSION	hSession,
+  IN OUT void***	lpBlockGroups,		// IN Data & ECC; OUT missing data
+  IN const unsigned int* lpInvalidBlockMasks,	// Masks of invalid buffers
+  IN unsigned int	nGroups				// Stripes in the batch
+  );
+
+// Asynchronous calls.  HoloStor_OpenQueue() lets a session have up to
+// nEntries calls in flight (1 to 16384) and returns an eventfd (Linux only;
+// elsewhere it fails with HOLOSTOR_STATUS_BAD_CONFIGURATION).  Each
+// HoloStor_Submit*() queues the call of the same name, to be made by a thread
+// of the library, and returns at once, with HOLOSTOR_STATUS_QUEUE_FULL if the
+// session has nEntries calls in flight already.  The buffers (and the block
+// group) must be left alone until the call is reaped, but the mask is copied.
+// As each call completes, its lpContext and the status it returned are put
+// into a completion and the eventfd is signalled.  HoloStor_Reap() takes up
+// to nMax completions, without blocking, and returns how many it took; a
+// call is in flight until it is reaped.  A session closed with calls in
+// flight is deleted when they complete, and their completions are lost.
+typedef struct {
+	void*	lpContext;					// of the HoloStor_Submit*() call
+	int		lStatus;					// its return value
+} HOLOSTOR_COMPLETION;
+
+HOLOSTORAPI int
+HoloStor_OpenQueue(
+  IN HOLOSTOR_SESSION	hSession,
+  IN unsigned int	nEntries			// Calls in flight at most
+  );
+
+HOLOSTORAPI int
+HoloStor_SubmitEncode(
+  IN HOLOSTOR_SESSION	hSession,
+  IN OUT void**		lpBlockGroup,		// IN Data; OUT all ECC
+  IN void*			lpContext			// Returned with the completion
+  );
+
+HOLOSTORAPI int
+HoloStor_SubmitDecode(
+  IN HOLOSTOR_SESSION	hSession,
+  IN OUT void**		lpBlockGroup,		// IN Data & ECC; OUT missing data
+  IN const unsigned int* lpInvalidBlockMask,	// Mask of buffers with invalid data
+  IN void*			lpContext			// Returned with the completion
+  );
+
+HOLOSTORAPI int
+HoloStor_SubmitRebuild(
+  IN HOLOSTOR_SESSION	hSession,
+  IN OUT void**		lpBlockGroup, 		// IN Data & ECC; OUT as specified
+  IN const unsigned int* lpInvalidBlockMask,	// Mask of buffers with invalid data
+  IN int			lWhichBlock,		// Block index to rebuild (-1 all)
+  IN void*			lpContext			// Returned with the completion
+  );
+
+HOLOSTORAPI int
+HoloStor_SubmitEncodeDelta(
+  IN HOLOSTOR_SESSION	hSession,
+  IN unsigned int	lDataIndex,			// Data block index of delta
+  IN const void*	lpDeltaBlock,		// Forwarded data delta
+  IN unsigned int	lEccIndex,			// ECC block index being updated
+  IN const void*	lpEccBlockOld,		// Old ECC block
+  OUT void*			lpEccBlockNew,		// Returned new ECC block
+  IN void*			lpContext			// Returned with the completion
+  );
+
+HOLOSTORAPI int
+HoloStor_Reap(
+  IN HOLOSTOR_SESSION	hSession,
+  OUT HOLOSTOR_COMPLETION* lpCompletions,	// Completions taken
+  IN unsigned int	nMax				// Size of lpCompletions
+  );
+
+// Build the recovery matrices of a HOLOSTOR_FLAG_LAZY session for every
+// combination of up to nFaults invalid blocks (1 for the single failures),
+// ahead of the calls that would.  It may be called while other threads are in
+// calls on the session.
+HOLOSTORAPI int
+HoloStor_Warmup(
+  IN HOLOSTOR_SESSION	hSession,
+  IN unsigned int	nFaults				// Invalid blocks to be ready for
+  );
+
 // Force the library to use a sub-optimal method (for testing ONLY).
 // Method 0 is always supported; higher values provide higher performance.
 // Input a numerical method limit and the largest limited value supported
-// in HW is returned.
+// in HW is returned.  The method of a session is fixed when it is created
+// (and may be limited further by HOLOSTOR_FLAG_METHOD).
 HOLOSTORAPI int
 HoloStor_SetMethod(
   IN OUT unsigned int*	pMethod			// opaque method id (see source code)
   );
 
+// Set how far ahead (in bytes) the coding kernels prefetch their input, for
+// tuning to a platform; 0 disables software prefetching.  The distance is
+// rounded down to a multiple of 64 and limited to 4096, and the value put
+// into effect is returned.
+HOLOSTORAPI int
+HoloStor_SetPrefetch(
+  IN OUT unsigned int*	pDistance		// prefetch distance in bytes
+  );
+
+// Set the threads that code a large stripe (more than 64 KB per block) to
+// nThreads: the calling thread and nThreads-1 worker threads of the library,
+// which each code a range of the blocks.  The calls stay synchronous, and
+// only one call at a time has the workers (the others code on their own).
+// The default is 1 (no workers); builds without threads (e.g. the Linux
+// kernel) stay at 1.  The number put into effect is returned.
+HOLOSTORAPI int
+HoloStor_SetThreads(
+  IN OUT unsigned int*	pThreads		// threads per call
+  );
+
 #ifdef  __cplusplus
 }
 #endif
@@ -33,71 +33,219 @@
 #include <string.h>			// for ANSI memset(), memcpy()
 
 #include "CodingMatrix.hpp"
+//
+#include <assert.h>		// for ANSI assert()
+#ifdef	SIMD_INTRINSICS
+#include <immintrin.h>
+#endif
 
 namespace HoloStor {
 
-bool 
-CodingMatrix::CodingMatrixInit(Tuple faults, IDA& generator)
+// Keep the rows of the recovery matrix that recover the faults.
+template <class gf, class Mul> bool
+CodingMatrix::_Init(Tuple faults, const IDAT<gf>& generator)
 {
+	assert(sizeof(Mul) == 1);
 	nRows = faults.getDim();
 	for (int k = 0; k < nRows; k++)
 		RowID[k] = faults(k);
-	matrixGFQ_t mCoding;
-	if ( !generator.GenerateCoding(faults, mCoding, ColID) )
-		return false;								// out of memory
-	mGF2ops.setDim(nRows, mCoding.cols());
-	if ( mGF2ops.isNil() )
+	matrix<gf> mCoding;
+	if ( !generator.GenerateCoding(faults, mCoding, _ColID()) )
 		return false;								// out of memory
-	for (unsigned i = 0; i < mGF2ops.rows(); i++)
-		for (unsigned j = 0; j < mGF2ops.cols(); j++)
-			mGF2ops(i, j) = GF2Mul( mCoding(RowID[i],j) );
+	nCols = mCoding.cols();
+	for (unsigned i = 0; i < nRows; i++) {
+		Mul *pOps = (Mul*)_Ops<Mul>(i);
+		for (unsigned j = 0; j < nCols; j++)
+			pOps[j] = Mul( mCoding(i,j) );
+	}
 	return true;
 }
 
+bool 
+CodingMatrix::CodingMatrixInit(Tuple faults, const IDA& generator)
+{
+	return _Init<gfQ, GF2Mul>(faults, generator);
+}
+
+bool 
+CodingMatrix::CodingMatrixInit(Tuple faults, const IDA256& generator)
+{
+	return _Init<GF256, GF256Mul>(faults, generator);
+}
+
+// Return the number of rows to rebuild (all, or just lWhichBlock if it is
+// one of them) and the first of them.  A Rebuild() of a lWhichBlock that is
+// not one of them zeroes it (as it always has).
+int
+CodingMatrix::_Rows(INT lWhichBlock, int& first) const
+{
+	first = 0;
+	if (lWhichBlock < 0)
+		return nRows;
+	for (first = 0; first < nRows; first++)
+		if (RowID[first] == (unsigned)lWhichBlock)
+			return 1;
+	return 0;
+}
+
 void
-CodingMatrix::Rebuild(UCHAR **lpBlockGroup, INT lWhichBlock, UINT BlockSize) const
+CodingMatrix::Rebuild(UCHAR **lpBlockGroup, INT lWhichBlock, UINT BlockSize,
+					  const GF2Kernels& kernels, bool bNonTemporal) const
 {
-	// zero the destination blocks
-	if (lWhichBlock >= 0)
-		::memset(lpBlockGroup[lWhichBlock], 0, BlockSize);
-	else for (int i = 0; i < nRows; i++) 
-		::memset(lpBlockGroup[RowID[i]], 0, BlockSize);
+	const hyperword_t *pSrcs[MaxN];
+	for (unsigned j = 0; j < nCols; j++)
+		pSrcs[j] = (const hyperword_t*)(lpBlockGroup[_ColID()[j]]);
+	hyperword_t *pDsts[MaxK];
+	for (int i = 0; i < nRows; i++)
+		pDsts[i] = (hyperword_t*)(lpBlockGroup[RowID[i]]);
 	//
-	for (int i = 0; i < nRows; i++) {
-		const unsigned row = RowID[i];
-		if (lWhichBlock >= 0 && row != (unsigned)lWhichBlock)
-			continue;
-		for (unsigned j = 0; j < mGF2ops.cols(); j++) {
-			const int col = ColID[j];
-#if 1
-			// 20-30% faster
-			mGF2ops(i, j).gf2multadd(
-							(hyperword_t*)(lpBlockGroup[row]),
-							(hyperword_t*)(lpBlockGroup[col]),
-							BlockSize/sizeof(Element)
-							);
+	// One pass over the sources computes all the destination blocks.
+	int first;
+	const int count = _Rows(lWhichBlock, first);
+	if (count == 0) {
+		::memset(lpBlockGroup[lWhichBlock], 0, BlockSize);
+		return;
+	}
+	const unsigned nElements = BlockSize/sizeof(Element);
+	unsigned nTile = nElements;
+	if (BlockSize >= MinTiledBlockSize)
+		nTile = TileElements(nCols + count);
+	// Large blocks are done a tile at a time, so that a pass (or the passes
+	// of the fallback and of more than RowBlock rows) stays within the cache.
+	for (unsigned e = 0; e < nElements; e += nTile) {
+		const unsigned n = nElements-e < nTile ? nElements-e : nTile;
+		const unsigned offset = e*ELEMENT_WIDTH;
+		hyperword_t *pTileDsts[MaxK];
+		const hyperword_t *pTileSrcs[MaxN];
+		for (int i = 0; i < count; i++)
+			pTileDsts[i] = pDsts[first+i] + offset;
+		for (unsigned j = 0; j < nCols; j++)
+			pTileSrcs[j] = pSrcs[j] + offset;
+		GF2Mul::gf2multsum(
+						pTileDsts, count,
+						pTileSrcs, nCols,
+						_Ops<GF2Mul>(first),
+						n,
+						kernels,
+						bNonTemporal
+						);
+	}
+}
+
+// The GF(2**8) kernels always have a fused kernel (except in builds without
+// intrinsics), which reads each source once, so the blocks are not tiled.
+void
+CodingMatrix::Rebuild(UCHAR **lpBlockGroup, INT lWhichBlock, UINT BlockSize,
+					  const GF256Kernels& kernels, bool bNonTemporal) const
+{
+	int first;
+	const int count = _Rows(lWhichBlock, first);
+	if (count == 0) {
+		::memset(lpBlockGroup[lWhichBlock], 0, BlockSize);
+		return;
+	}
+	const hyperword_t *pSrcs[MaxBlocks];
+	for (unsigned j = 0; j < nCols; j++)
+		pSrcs[j] = (const hyperword_t*)(lpBlockGroup[_ColID()[j]]);
+	hyperword_t *pDsts[MaxK];
+	for (int i = 0; i < count; i++)
+		pDsts[i] = (hyperword_t*)(lpBlockGroup[RowID[first+i]]);
+	GF256Mul::gf256multsum(
+					pDsts, count,
+					pSrcs, nCols,
+					_Ops<GF256Mul>(first),
+					BlockSize/sizeof(Element),
+					kernels,
+					bNonTemporal
+					);
+}
+
+// Hint that the cache line at p will soon be read (and written).
+#if defined(__GNUC__)
+#define	PREFETCH(p)	__builtin_prefetch((p), 1)
+#elif defined(SIMD_INTRINSICS)
+#define	PREFETCH(p)	_mm_prefetch((const char*)(p), _MM_HINT_T0)
 #else
-			for (int offset = 0; offset < BlockSize; offset += sizeof(Element)) {
-				mGF2ops(i, j).gf2multadd(
-								(hyperword_t*)(lpBlockGroup[row]+offset),
-								(hyperword_t*)(lpBlockGroup[col]+offset)
-								);
-			}
+#define	PREFETCH(p)
 #endif
-		}
+
+// Prefetch the first PrefetchDistance bytes of the blocks a Rebuild() will
+// read and write, ahead of the call.  The kernels prefetch the rest of the
+// streams once started.
+void
+CodingMatrix::Prefetch(UCHAR **lpBlockGroup, INT lWhichBlock, UINT BlockSize) const
+{
+	const unsigned nBytes = PrefetchDistance < BlockSize ? PrefetchDistance : BlockSize;
+	int first;
+	const int count = _Rows(lWhichBlock, first);
+	for (unsigned b = 0; b < nBytes; b += CacheLine) {
+		for (unsigned j = 0; j < nCols; j++)
+			PREFETCH(lpBlockGroup[_ColID()[j]] + b);
+		for (int i = 0; i < count; i++)
+			PREFETCH(lpBlockGroup[RowID[first+i]] + b);
 	}
 }
 
+// Return the Elements per tile such that the tiles of nBlocks blocks take
+// half of the L2 cache (the rest is left to the application).
+unsigned
+CodingMatrix::TileElements(unsigned nBlocks)
+{
+	const unsigned nCacheSize = CacheSize ? CacheSize : DefaultCacheSize;
+	const unsigned nMinTile = 4096/sizeof(Element);
+	const unsigned nTile = nCacheSize/2/nBlocks/sizeof(Element);
+	return nTile > nMinTile ? nTile : nMinTile;
+}
+
 void 
 CodingMatrix::EncodeDelta(UINT lDeltaIndex, const UCHAR* lpDeltaBlock,
 						  const UCHAR* lpEccBlockOld, UCHAR* lpEccBlockNew,
-						  UINT BlockSize) const
+						  UINT BlockSize, const GF2Kernels& kernels,
+						  bool bNonTemporal) const
 {
+	if (bNonTemporal && lpEccBlockNew != lpEccBlockOld) {
+		// new = 1*old + m*delta in one pass, so the new block is only ever
+		// written (around the cache).
+		const hyperword_t *pSrcs[2] = {
+			(const hyperword_t*)lpEccBlockOld, (const hyperword_t*)lpDeltaBlock
+		};
+		hyperword_t *pDst = (hyperword_t*)lpEccBlockNew;
+		const GF2Mul Mul[2] = { GF2Mul(1u), _Ops<GF2Mul>(0)[lDeltaIndex] };
+		GF2Mul::gf2multsum(&pDst, 1, pSrcs, 2, Mul,
+						   BlockSize/sizeof(Element), kernels, true);
+		return;
+	}
+	::memcpy(lpEccBlockNew, lpEccBlockOld, BlockSize);
+	_Ops<GF2Mul>(0)[lDeltaIndex].gf2multadd(
+							(hyperword_t*)lpEccBlockNew,
+							(hyperword_t*)lpDeltaBlock,
+							BlockSize/sizeof(Element),
+							kernels
+							);
+}
+
+void 
+CodingMatrix::EncodeDelta(UINT lDeltaIndex, const UCHAR* lpDeltaBlock,
+						  const UCHAR* lpEccBlockOld, UCHAR* lpEccBlockNew,
+						  UINT BlockSize, const GF256Kernels& kernels,
+						  bool bNonTemporal) const
+{
+	if (bNonTemporal && lpEccBlockNew != lpEccBlockOld) {
+		const hyperword_t *pSrcs[2] = {
+			(const hyperword_t*)lpEccBlockOld, (const hyperword_t*)lpDeltaBlock
+		};
+		hyperword_t *pDst = (hyperword_t*)lpEccBlockNew;
+		const GF256Mul Mul[2] = { GF256Mul(1u), _Ops<GF256Mul>(0)[lDeltaIndex] };
+		GF256Mul::gf256multsum(&pDst, 1, pSrcs, 2, Mul,
+							   BlockSize/sizeof(Element), kernels, true);
+		return;
+	}
 	::memcpy(lpEccBlockNew, lpEccBlockOld, BlockSize);
-	mGF2ops(0, lDeltaIndex).gf2multadd(
+	_Ops<GF256Mul>(0)[lDeltaIndex].gf256multadd(
 							(hyperword_t*)lpEccBlockNew,
 							(hyperword_t*)lpDeltaBlock,
-							BlockSize/sizeof(Element)
+							BlockSize/sizeof(Element),
+							kernels
 							);
 }
 
@@ -28,6 +28,12 @@
  Abstract:
 	Interface for the CodingMatrix class.
 
+	A CodingMatrix lives in a slot of a chunk of its CodingTable:  the
+	class is the header of the slot, followed by the ColID of its columns and
+	then by its nRows x nCols multipliers, row by row (those of GF2Mul, or of
+	GF256Mul for a HOLOSTOR_FLAG_GF256 session, one byte each).  Size() rounds
+	the slot up to whole cache lines.
+
 --****************************************************************************/
 
 #ifndef HOLOSTOR_HOLOSTORLIB_CODINGMATRIX_HPP_
@@ -42,28 +48,52 @@
 //
 #include "TypesGF.hpp"
 #include "GF2Mul.hpp"
+#include "GF256Mul.hpp"
 
 namespace HoloStor {
 
 class CodingMatrix {
 private:
 	UCHAR nRows;				// number of rows to recover
+	UCHAR nCols;				// number of columns (the Data blocks)
 	UCHAR RowID[MaxK];			// row numbers to recover
-	UCHAR ColID[MaxN];			// col numbers used for recovery
-	// coding with multiplication operations in GF(2) representation
-	matrix<GF2Mul> mGF2ops;
-public:
-	// constructor
-	CodingMatrix() : nRows(0) {}
 	//
-	bool CodingMatrixInit(Tuple faults, IDA& mCoding);
-	void Rebuild(UCHAR **lpBlockGroup, INT lWhichBlock, UINT BlockSize) const;
+	// col numbers used for recovery (one per column)
+	UCHAR *_ColID() { return (UCHAR*)(this + 1); }
+	const UCHAR *_ColID() const { return (const UCHAR*)(this + 1); }
+	// coding with multiplication operations in GF(2) representation (GF2Mul),
+	// or, for a HOLOSTOR_FLAG_GF256 session, in GF(2**8) (GF256Mul)
+	template <class Mul> const Mul *_Ops(unsigned row) const {
+		return (const Mul*)(_ColID() + nCols + row*nCols);
+	}
+	//
+	template <class gf, class Mul>
+	bool _Init(Tuple faults, const IDAT<gf>& generator);
+	int _Rows(INT lWhichBlock, int& first) const;
+	static unsigned TileElements(unsigned nBlocks);
+public:
+	enum { CacheLine = 64 };
+	// The bytes of the arena slot of a matrix of nRows rows of nCols
+	static unsigned Size(unsigned nRows, unsigned nCols) {
+		const unsigned size = sizeof(CodingMatrix) + nCols + nRows*nCols;
+		return (size + CacheLine-1) & ~(CacheLine-1);
+	}
+	// Each builds the matrix in place, in a slot of Size() bytes.
+	bool CodingMatrixInit(Tuple faults, const IDA& generator);
+	bool CodingMatrixInit(Tuple faults, const IDA256& generator);
+	void Rebuild(UCHAR **lpBlockGroup, INT lWhichBlock, UINT BlockSize,
+		const GF2Kernels& kernels, bool bNonTemporal = false) const;
+	void Rebuild(UCHAR **lpBlockGroup, INT lWhichBlock, UINT BlockSize,
+		const GF256Kernels& kernels, bool bNonTemporal = false) const;
+	void Prefetch(UCHAR **lpBlockGroup, INT lWhichBlock, UINT BlockSize) const;
+	void EncodeDelta(UINT lDeltaIndex, const UCHAR* lpDeltaBlock,
+		const UCHAR* lpEccBlockOld, UCHAR* lpEccBlockNew, UINT BlockSize,
+		const GF2Kernels& kernels, bool bNonTemporal = false) const;
 	void EncodeDelta(UINT lDeltaIndex, const UCHAR* lpDeltaBlock,
-		const UCHAR* lpEccBlockOld, UCHAR* lpEccBlockNew, UINT BlockSize) const;
+		const UCHAR* lpEccBlockOld, UCHAR* lpEccBlockNew, UINT BlockSize,
+		const GF256Kernels& kernels, bool bNonTemporal = false) const;
 	//
 	static unsigned MinBlockSize() { return sizeof(Element); }
-	//
-	NEWOPERATORS
 };
 
 } // namespace HoloStor
@@ -28,7 +28,15 @@
  Abstract:
 	Implementation of the CodingTable class.  CodingTable is a container for
 	the CodingMatrix class.  The primary requirement is fast lookup given a
-	uInvalidMask.
+	uInvalidMask, which _Index() ranks among the combinations of as many
+	blocks.
+
+	The matrices are built by CodingTableInit(), or, for a HOLOSTOR_FLAG_LAZY
+	session, by the first lookup() of their faults.  A lazily built matrix is
+	published with a compare-and-swap of its state, so that concurrent lookups
+	need no lock.  The matrices are built in place, in slots that are
+	allocated a chunk at a time as the matrices are built, and that the index
+	finds through the chunk index of their faults.
 	
 --****************************************************************************/
 
@@ -37,182 +45,370 @@
 #include "MathUtils.hpp"
 #include "CombinIter.hpp"
 #include "IDA.hpp"
+#include "GF2Mul256.hpp"
+#include "Interlocked.h"
 //
 #include <assert.h>		// for ANSI assert()
+#include <string.h>		// for ANSI memset(), memcpy()
 
 namespace HoloStor {
 
 //
-// Calculate a table index based on a bit-mask of invalid blocks.  Bits within Mask
-// are numbered 1 (LSB) thru M (MSB).  M is the same as the Blocks argument. Suppose 
-// bits A0, A1, A2 are on where A0 > A1 > A2.  Then the index returned is 
-//					A2*(Blocks)**2 + A1*(Blocks)**1 + A0.
-// The problem is similar to converting BCD (base M) to binary.
+// The index of the matrix of a Tuple of e invalid blocks, numbered 0 thru M-1
+// and in decreasing order (as drawn by CombinIter):  its rank in the
+// combinatorial number system, C(A0,e) + C(A1,e-1) + ... for blocks A0 > A1 >
+// ..., after the matrices of fewer blocks.  The ranks of the C(M,e)
+// combinations of e blocks are 0 thru C(M,e)-1, so that the index is dense:
+// the table has no more entries than matrices, and the binomial coefficients
+// it takes (pBinomial) are a few hundred bytes.
 //
 // Properties:
-//	+ 0 returned implies 0 bits on.
-//	+ returned value > _MaxHash(n,k) implies more than k bits on.
+//	+ BadIndex returned implies no blocks, too many or a block beyond the stripe.
 //
-#if defined(_MSC_VER)
-#pragma warning(push)
-#pragma warning(disable:4035)		// no return value
-UINT32
-Mask2Index(
-            UINT32 Mask,		// Bit mask of invalid blocks
-            UINT32 Blocks		// Number of blocks
-            )
+CodingIndex
+CodingTable::_Index(const Tuple& faults) const
 {
-	__asm {
-			mov		ecx, Mask
-			xor		eax, eax
-A:
-			cmp		ecx, 0				// Stop when no more bits are on
-			jz		B
-			imul	eax, Blocks			// Scale index by # of blocks
-			bsf		edx, ecx			// Find the lowest on bit
-			btr		ecx, edx			// Turn off the bit
-			lea		eax, [edx+eax+1]	// Add the bit # + 1 to index
-			jmp		A
-B:
+	const unsigned e = faults.getDim();
+	if (e == 0 || e > nEccBlocks || faults(0) >= nTotalBlocks)
+		return BadIndex;
+	CodingIndex index = nFirst[e];
+	const CodingIndex *pRow = &pBinomial[(e-1)*nTotalBlocks];	// C(x,e)
+	for (unsigned i = 0; i < e; i++, pRow -= nTotalBlocks) {
+		assert(i == 0 || faults(i) < faults(i-1));			// decreasing
+		index += pRow[faults(i)];
 	}
+	assert(index < nMatrices);
+	return index;
 }
-#pragma warning(pop)
-#elif defined(__GNUC__)			// XXX - works for -O2 but not for -O3
-UINT32
-Mask2Index(
-            UINT32 Mask,		// Bit mask of invalid blocks
-            UINT32 Blocks		// Number of blocks
-            )
-{
-	UINT32 sum;
-
-	__asm__ __volatile__(
-		"movl	%1,%%ecx\n\t"
-		"xorl	%%eax,%%eax\n"
-		"0:\n\t"
-		"cmpl	$0,%%ecx\n\t"
-		"jz		0f\n\t"
-		"imull	%2,%%eax\n\t"
-		"bsfl	%%ecx,%%edx\n\t"
-		"btrl	%%edx,%%ecx\n\t"
-		"leal	1(%%edx,%%eax),%%eax\n\t"
-		"jmp	0b\n"
-		"0:"
-		:"=a" (sum) : "m" (Mask), "m" (Blocks) : "ecx","edx"
-	);
-	return sum;
-}
-#else // !defined(_MSC_VER) && !defined(__GNUC__)
-UINT32
-Mask2Index(
-            UINT32 Mask,		// Bit mask of invalid blocks
-            UINT32 Blocks		// Number of blocks
-            )
-{
-	UINT32 sum = 0;
-	for (int index = 0; index < Blocks; index++)
-		if (Mask & (1<<index)) {
-			sum *= Blocks;
-			sum += index+1;
-		}
-	return sum;
-}
-#endif // defined(_MSC_VER)
 
-// When there are k bits on, Mask2Index() returns sum from i=0 to k-1 a[i]*M**i
-// where M=n+k and a[i] is the bit position number.  Bit position numbers are 1..M
-// and ordered such that a[0] > a[1] > a[2] ...  The returned value is maximal
-// for a[0]=M, a[1]=M-1, ...
+// The number of recovery matrices, the sum over i from 1 to k of C(n+k,i), or
+// some number above MaxMatrices when that is exceeded (without overflow).
 unsigned
-CodingTable::_MaxHash(unsigned n, unsigned k)
+CodingTable::_MatrixCount(unsigned n, unsigned k)
 {
 	const unsigned M = n + k;
-	unsigned factor = 1;
 	unsigned sum = 0;
-	for (unsigned i = 0; i < k; i++) {
-		sum += (M - i)*factor;
-		factor *= M;
+	unsigned c = 1;							// C(M,i)
+	for (unsigned i = 1; i <= k; i++) {
+		c = c * (M - i + 1) / i;			// exact
+		sum += c;
+		if (sum > MaxMatrices)
+			break;
 	}
 	return sum;
 }
 
-unsigned
-CodingTable::_MatrixCount(unsigned n, unsigned k)
+void
+CodingTable::_cleanup()
 {
-	unsigned sum = 0;
-	for (unsigned i = 1; i <= k; i++)
-		sum += HoloStor::combinations(n+k, i);
-	return sum;
+	if (pArena == NULL)
+		return;
+	for (unsigned i = 1; i <= nEccBlocks; i++)
+		for (unsigned j = _ChunkCount(i); j-- > 0; )
+			if (pChunks[i][j] != NULL)
+				HoloStor_TableFree(pChunks[i][j]);	// the matrices need no destruction
+	HoloStor_TableFree(pArena);
+	pArena = NULL;
 }
 
-void
-CodingTable::_cleanup()
+// Allocate the chunk of the slot of the matrix, unless already done.  Threads
+// may race to allocate the same chunk:  the first to publish it wins and the
+// others free theirs.
+int
+CodingTable::_Chunk(CodingIndex index, unsigned nFaults) const
+{
+	const CodingIndex i = index - nFirst[nFaults];
+	UCHAR * volatile *ppChunk = &pChunks[nFaults][i >> nChunkShift[nFaults]];
+	if (*ppChunk != NULL)
+		return HOLOSTOR_STATUS_SUCCESS;
+	const CodingIndex first = i & ~((1u << nChunkShift[nFaults]) - 1);
+	const CodingIndex count = nFirst[nFaults+1] - nFirst[nFaults] - first;
+	const unsigned nSlots = count < (1u << nChunkShift[nFaults]) ?
+		count : (1u << nChunkShift[nFaults]);			// the last may be short
+	UCHAR *pChunk = (UCHAR*)HoloStor_TableAlloc(nSlots*nSlotSize[nFaults] +
+		CodingMatrix::CacheLine-1);
+	if (pChunk == NULL)
+		return HOLOSTOR_STATUS_NO_MEMORY;
+	if (InterlockedCompareExchangePointer((PVOID volatile*)ppChunk, pChunk, NULL) != NULL)
+		HoloStor_TableFree(pChunk);						// lost the race
+	return HOLOSTOR_STATUS_SUCCESS;
+}
+
+//
+// Build the matrix of the faults in a scratch slot of its own, copy it into
+// its slot and publish it with a compare-and-swap of its state.  Threads may
+// race to build the same matrix, none waiting for another:  each that still
+// finds it Empty copies its own in, and the first to publish it wins.  The
+// copies are the same byte for byte (the scratch slot is zeroed first), so
+// that a copy made after the matrix is Built does not change it.
+//
+int
+CodingTable::_Build(const Tuple& faults, CodingIndex index) const
 {
-	if (pHashTable != NULL)
-		HoloStor_TableFree(pHashTable);	// instead of:  delete [] pHashTable;
-	pHashTable = NULL;
-	if (pCodeTable != NULL)
-		delete [] pCodeTable;
-	pCodeTable = NULL;
+	const unsigned nFaults = faults.getDim();
+	const int status = _Chunk(index, nFaults);
+	if (status != HOLOSTOR_STATUS_SUCCESS)
+		return status;
+	UCHAR *pScratch = (UCHAR*)HoloStor_QuickAlloc(nSlotSize[nFaults] +
+		CodingMatrix::CacheLine-1);
+	if (pScratch == NULL)
+		return HOLOSTOR_STATUS_NO_MEMORY;
+	CodingMatrix *pMatrix = (CodingMatrix*)(((UINT_PTR)pScratch +
+		CodingMatrix::CacheLine-1) & ~(UINT_PTR)(CodingMatrix::CacheLine-1));
+	::memset(pMatrix, 0, nSlotSize[nFaults]);
+	const bool bOK = bGF256 ? pMatrix->CodingMatrixInit(faults, generator256)
+							: pMatrix->CodingMatrixInit(faults, generator);
+	if (bOK && pState[index] == Empty) {
+		::memcpy(_Slot(index, nFaults), pMatrix, nSlotSize[nFaults]);
+		// The locked operation orders the matrix before its state.
+		InterlockedCompareExchange8(&pState[index], Built, Empty);
+	}
+	HoloStor_QuickFree(pScratch);
+	return bOK ? HOLOSTOR_STATUS_SUCCESS : HOLOSTOR_STATUS_NO_MEMORY;
 }
 
+// Check the configuration of a session against the limits of the table,
+// which CodingTableInit() imposes as well.
 int
-CodingTable::CodingTableInit(const HOLOSTOR_CFG *pCfg)
+CodingTable::CheckConfig(const HOLOSTOR_CFG *pCfg, unsigned flags)
 {
 	if (pCfg->BlockSize < CodingMatrix::MinBlockSize())
 		return HOLOSTOR_STATUS_BAD_CONFIGURATION;
 	const unsigned n = pCfg->DataBlocks;
 	const unsigned k = pCfg->EccBlocks;
-	if (n < MinN || n > MaxN || k < MinK || k > MaxK)	// impose limits before too late
+	if ((flags & HOLOSTOR_FLAG_BITSLICED) &&
+		pCfg->BlockSize % GF2Mul256::SliceSize() != 0)		// whole slices only
 		return HOLOSTOR_STATUS_BAD_CONFIGURATION;
-	IDA generator;
-	if ( !generator.IDAInit(n, k) )
-		return HOLOSTOR_STATUS_BAD_CONFIGURATION;			// unsupported combination of n and k
+	if (n < MinN || k < MinK || k > MaxK)				// impose limits before too late
+		return HOLOSTOR_STATUS_BAD_CONFIGURATION;
+	if ((flags & HOLOSTOR_FLAG_GF256) ? n + k > MaxBlocks : n > MaxN)
+		return HOLOSTOR_STATUS_BAD_CONFIGURATION;
+	// The table grows as C(n+k,k) (hence the limit for wide stripes).
+	if (_MatrixCount(n, k) > MaxMatrices)
+		return HOLOSTOR_STATUS_BAD_CONFIGURATION;
+	return HOLOSTOR_STATUS_SUCCESS;
+}
+
+int
+CodingTable::CodingTableInit(const HOLOSTOR_CFG *pCfg, unsigned flags)
+{
+	const int status = CheckConfig(pCfg, flags);
+	if (status != HOLOSTOR_STATUS_SUCCESS)
+		return status;
+	const unsigned n = pCfg->DataBlocks;
+	const unsigned k = pCfg->EccBlocks;
+	const bool bIsGF256 = (flags & HOLOSTOR_FLAG_GF256) != 0;
 	//
 	_cleanup();
+	const bool bMinXor = (flags & HOLOSTOR_FLAG_MINXOR) != 0;
+	if ( bIsGF256 ? !generator256.IDAInit(n, k, bMinXor) : !generator.IDAInit(n, k, bMinXor) )
+		return HOLOSTOR_STATUS_BAD_CONFIGURATION;			// unsupported combination of n and k
+	bGF256 = bIsGF256;
 	nTotalBlocks = n + k;
+	nEccBlocks = k;
 	//
 	nMatrices = _MatrixCount(n, k);
-	pCodeTable = new CodingMatrix[nMatrices];			// uses HoloStor_TableAlloc()
-	WORKAROUND1(pCodeTable);							// XXX - GCC 3.3.1 bug workaround
-	if (pCodeTable == NULL)
-		return HOLOSTOR_STATUS_NO_MEMORY;
-	nHashValues = _MaxHash(n, k) + 1;					// k needs to be limited here
-	// OK to bypass operator new[] since CodingIndex is a primitive type.
-	//		pHashTable = new CodingIndex[nHashValues];
-	pHashTable =
-		(CodingIndex*)HoloStor_TableAlloc(sizeof(CodingIndex)*nHashValues);
-	if (pHashTable == NULL)
+	// The matrices of i faults follow those of i-1 faults in the index, and
+	// have chunks of as many slots as fit in ChunkBytes (at least one).
+	unsigned nChunks = 0;
+	CodingIndex c = 1;
+	nFirst[1] = 0;
+	for (unsigned i = 1; i <= k; i++) {
+		c = c * (nTotalBlocks - i + 1) / i;				// C(M,i)
+		nFirst[i+1] = nFirst[i] + c;
+		nSlotSize[i] = CodingMatrix::Size(i, n);
+		nChunkShift[i] = 0;
+		while ((nSlotSize[i] << (nChunkShift[i] + 1)) <= ChunkBytes)
+			nChunkShift[i]++;
+		nChunks += _ChunkCount(i);
+	}
+	const unsigned nBytes = sizeof(UCHAR*)*nChunks +
+		sizeof(CodingIndex)*k*nTotalBlocks + nMatrices;
+	pArena = (UCHAR*)HoloStor_TableAlloc(nBytes);
+	if (pArena == NULL)
 		return HOLOSTOR_STATUS_NO_MEMORY;
-	for (unsigned i = 0; i < nHashValues; i++)
-		pHashTable[i] = BadHash;
-	//
-	unsigned index = 0;
-	for (unsigned nFaults = 1; nFaults <= k; nFaults++) {
+	UCHAR * volatile *pChunk = (UCHAR * volatile *)pArena;
+	for (unsigned i = 1; i <= k; i++) {
+		pChunks[i] = pChunk;
+		for (unsigned j = _ChunkCount(i); j > 0; j--)
+			*pChunk++ = NULL;
+	}
+	pBinomial = (CodingIndex*)pChunk;
+	pState = (volatile UCHAR*)(pBinomial + k*nTotalBlocks);
+	for (unsigned i = 0; i < nMatrices; i++)
+		pState[i] = Empty;
+	// Row i-1 is C(x,i) for x from 0 to M-1, none above C(M-1,k) < nMatrices.
+	for (unsigned x = 0; x < nTotalBlocks; x++) {
+		c = 1;											// C(x,i)
+		for (unsigned i = 1; i <= k; i++) {
+			c = i > x ? 0 : c * (x - i + 1) / i;		// exact
+			pBinomial[(i-1)*nTotalBlocks + x] = c;
+		}
+	}
+	// A HOLOSTOR_FLAG_LAZY session builds the recovery matrices as the faults
+	// are seen, all but the matrix of Encode() (the ECC blocks as faults).
+	if ((flags & HOLOSTOR_FLAG_LAZY) == 0)
+		return Warmup(k);
+	Tuple ecc;
+	ecc.setDim(k);
+	for (unsigned i = 0; i < k; i++)
+		ecc(i) = nTotalBlocks-1-i;
+	const CodingMatrix *pMatrix;
+	return lookup(ecc, &pMatrix);
+}
+
+//
+// Build the matrices of every combination of up to nFaults faults (up to the
+// ECC blocks), those of single faults first.  With a HOLOSTOR_FLAG_LAZY session,
+// Warmup(1) is a cheap way to be ready for the first failure of a stripe.
+//
+int
+CodingTable::Warmup(unsigned nFaults) const
+{
+	if (nFaults > nEccBlocks)
+		nFaults = nEccBlocks;
+	for (unsigned i = 1; i <= nFaults; i++) {
 		CombinIter iter;
-		if ( !iter.CombinIterInit(nTotalBlocks, nFaults) )
+		if ( !iter.CombinIterInit(nTotalBlocks, i) )
 			return HOLOSTOR_STATUS_BAD_CONFIGURATION;	// XXX - shouldn't happen
 		Tuple ktuple;
 		while ( iter.Draw(ktuple) ) {
-			if ( !pCodeTable[index].CodingMatrixInit(ktuple, generator) )
-				return HOLOSTOR_STATUS_NO_MEMORY;
-			UINT32 hash = Mask2Index(ktuple.mask(), nTotalBlocks);
-			assert(hash < nHashValues && index < nMatrices);
-			pHashTable[hash] = index++;
+			const CodingMatrix *pMatrix;
+			const int status = lookup(ktuple, &pMatrix);
+			if (status != HOLOSTOR_STATUS_SUCCESS)
+				return status;
 		}
 	}
 	return HOLOSTOR_STATUS_SUCCESS;
 }
 
-CodingMatrix *
-CodingTable::lookup(UINT32 uInvalidMask) const
+// The matrix that recovers the faults, built if need be.  Wait-free once built,
+// when it touches the state of the matrix, the pointer to its chunk and the
+// one or two cache lines of its slot.
+int
+CodingTable::lookup(const Tuple& faults, const CodingMatrix **ppMatrix) const
+{
+	const CodingIndex index = _Index(faults);
+	if (index == BadIndex)
+		return HOLOSTOR_STATUS_TOO_MANY_BAD_BLOCKS;	// too many faults to recover
+	if (pState[index] != Built) {
+		const int status = _Build(faults, index);
+		if (status != HOLOSTOR_STATUS_SUCCESS)
+			return status;
+	}
+	*ppMatrix = _Slot(index, faults.getDim());
+	return HOLOSTOR_STATUS_SUCCESS;
+}
+
+//
+// The CodingTableCache is a list of the tables in use, each with the count of
+// the sessions that use it.  The list is short (a table per configuration in
+// use) and held under a spin lock only to search and change it:  a table is
+// built and warmed up outside of the lock.
+//
+void
+CodingTableCache::_lock()
+{
+	while (InterlockedCompareExchange32(&m_lock, 1, 0) != 0)
+		;								// spin
+}
+
+void
+CodingTableCache::_unlock()
+{
+	InterlockedExchangeAdd32(&m_lock, (UINT32)-1);
+}
+
+// The table of the configuration, shared with the sessions of the same
+// DataBlocks, EccBlocks and encoding matrix, and built if there are none.
+// Each acquire() that succeeds must be followed by a release() of the table.
+int
+CodingTableCache::acquire(const HOLOSTOR_CFG *pCfg, unsigned flags,
+						  const CodingTable **ppTable)
+{
+	int status = CodingTable::CheckConfig(pCfg, flags);	// the BlockSize is not shared
+	if (status != HOLOSTOR_STATUS_SUCCESS)
+		return status;
+	const unsigned key = flags & KeyFlags;
+	Entry *pEntry = _acquire(pCfg->DataBlocks, pCfg->EccBlocks, key);
+	if (pEntry == NULL) {
+		Entry *pNew = new Entry;
+		if (pNew == NULL)
+			return HOLOSTOR_STATUS_NO_MEMORY;
+		// Build the table lazily, to warm it up below once it is shared.
+		status = pNew->table.CodingTableInit(pCfg, flags | HOLOSTOR_FLAG_LAZY);
+		if (status != HOLOSTOR_STATUS_SUCCESS) {
+			delete pNew;
+			return status;
+		}
+		pNew->n = pCfg->DataBlocks;
+		pNew->k = pCfg->EccBlocks;
+		pNew->flags = key;
+		pNew->nRefs = 1;
+		_lock();
+		// Another session may have added the same table meanwhile.
+		pEntry = _find(pNew->n, pNew->k, pNew->flags);
+		if (pEntry != NULL)
+			pEntry->nRefs++;
+		else {
+			pNew->pNext = m_pHead;
+			m_pHead = pEntry = pNew;
+			pNew = NULL;
+		}
+		_unlock();
+		if (pNew != NULL)
+			delete pNew;								// lost the race
+	}
+	if ((flags & HOLOSTOR_FLAG_LAZY) == 0) {
+		status = pEntry->table.Warmup(pCfg->EccBlocks);	// if not done already
+		if (status != HOLOSTOR_STATUS_SUCCESS) {
+			release(&pEntry->table);
+			return status;
+		}
+	}
+	*ppTable = &pEntry->table;
+	return HOLOSTOR_STATUS_SUCCESS;
+}
+
+void
+CodingTableCache::release(const CodingTable *pTable)
+{
+	Entry *pFree = NULL;
+	_lock();
+	for (Entry **ppEntry = &m_pHead; *ppEntry != NULL; ppEntry = &(*ppEntry)->pNext) {
+		if (&(*ppEntry)->table != pTable)
+			continue;
+		if (--(*ppEntry)->nRefs == 0) {				// the last session of it
+			pFree = *ppEntry;
+			*ppEntry = pFree->pNext;
+		}
+		break;
+	}
+	_unlock();
+	if (pFree != NULL)
+		delete pFree;
+}
+
+// The entry of the configuration, with a reference added, or NULL if none.
+CodingTableCache::Entry *
+CodingTableCache::_acquire(unsigned n, unsigned k, unsigned flags)
+{
+	_lock();
+	Entry *pEntry = _find(n, k, flags);
+	if (pEntry != NULL)
+		pEntry->nRefs++;
+	_unlock();
+	return pEntry;
+}
+
+// Called with the lock held.
+CodingTableCache::Entry *
+CodingTableCache::_find(unsigned n, unsigned k, unsigned flags) const
 {
-	UINT32 hash = Mask2Index(uInvalidMask, nTotalBlocks);
-	if (hash == 0 || hash >= nHashValues)
-		return NULL;				// either none or too many faults to recover
-	unsigned index = pHashTable[hash];
-	assert(index != BadHash && index < nMatrices);
-	return &pCodeTable[index];
+	for (Entry *pEntry = m_pHead; pEntry != NULL; pEntry = pEntry->pNext)
+		if (pEntry->n == n && pEntry->k == k && pEntry->flags == flags)
+			return pEntry;
+	return NULL;
 }
 
 } // namespace HoloStor
@@ -38,31 +38,96 @@
 #include "Types.h"
 //
 #include "CodingMatrix.hpp"
+#include "IDA.hpp"
 
 namespace HoloStor {
 
 class CodingTable {
 private:
-	unsigned nTotalBlocks;
-	unsigned nMatrices, nHashValues;
-	CodingIndex *pHashTable;		// find a matrix by uInvalidMask
-	CodingMatrix *pCodeTable;		// array of actual coding matrices
-	//
-	static const CodingIndex BadHash = ~0;	// unused hash value
+	unsigned nTotalBlocks, nEccBlocks;
+	unsigned nMatrices;
+	CodingIndex nFirst[MaxK+2];		// index of the first matrix of i faults
+	unsigned nSlotSize[MaxK+1];		// bytes of a matrix of i faults
+	unsigned nChunkShift[MaxK+1];	// log2 of the slots of a chunk of them
+	// The slots of the matrices of i faults are allocated a chunk at a time,
+	// as the first matrix of the chunk is built, so that a HOLOSTOR_FLAG_LAZY
+	// table holds only the chunks of the faults seen.  pChunks[i] indexes the
+	// chunks (NULL until allocated), each cache line aligned on access.
+	enum { ChunkBytes = 16384 };
+	UCHAR * volatile *pChunks[MaxK+1];
+	// One allocation holds the chunk indexes, the binomial coefficients of
+	// _Index() and the states of the matrices.
+	UCHAR *pArena;
+	CodingIndex *pBinomial;			// C(x,i) at [(i-1)*nTotalBlocks + x]
+	// The coding matrices are each built on first lookup() unless already built
+	// by CodingTableInit() or Warmup(), as its state tells.
+	volatile UCHAR *pState;
+	enum { Empty, Built };
+	bool bGF256;
+	IDA generator;					// generates the matrices of a GF(2**4) session
+	IDA256 generator256;			// or of a HOLOSTOR_FLAG_GF256 session
 	//
 	void _cleanup();				// deallocate memory
+	unsigned _ChunkCount(unsigned nFaults) const {
+		return (nFirst[nFaults+1] - nFirst[nFaults] + (1u << nChunkShift[nFaults]) - 1)
+			>> nChunkShift[nFaults];
+	}
+	CodingMatrix *_Slot(CodingIndex index, unsigned nFaults) const {
+		const CodingIndex i = index - nFirst[nFaults];
+		const UINT_PTR chunk = (UINT_PTR)pChunks[nFaults][i >> nChunkShift[nFaults]];
+		return (CodingMatrix*)(((chunk + CodingMatrix::CacheLine-1) &
+			~(UINT_PTR)(CodingMatrix::CacheLine-1)) +
+			(i & ((1u << nChunkShift[nFaults]) - 1))*nSlotSize[nFaults]);
+	}
+	int _Chunk(CodingIndex index, unsigned nFaults) const;
+	int _Build(const Tuple& faults, CodingIndex index) const;
 public:
 	// constructor
-	CodingTable() : pHashTable(NULL), pCodeTable(NULL) {}
+	CodingTable() : pArena(NULL) {}
 	// destructor
 	~CodingTable() { _cleanup(); }
 	//
-	int CodingTableInit(const HOLOSTOR_CFG *pCfg);
-	CodingMatrix *lookup(UINT32 uInvalidMask) const;
+	int CodingTableInit(const HOLOSTOR_CFG *pCfg, unsigned flags);	// HOLOSTOR_FLAG_*
+	static int CheckConfig(const HOLOSTOR_CFG *pCfg, unsigned flags);
+	int lookup(const Tuple& faults,				// faults as drawn by CombinIter
+		const CodingMatrix **ppMatrix) const;
+	int Warmup(unsigned nFaults) const;			// build those of up to nFaults
 	//
+	static const CodingIndex BadIndex = ~0;	// of no matrix
+	CodingIndex _Index(const Tuple& faults) const;			// XXX - public for access by UnitTest
 	static unsigned _MatrixCount(unsigned n, unsigned k);	// count recovery matrices
-	static unsigned _MaxHash(unsigned n, unsigned k);		// maximum hash value
 };
 
+// The CodingTables in use, shared by the sessions of the same configuration
+// (but for the BlockSize and the options of the kernels).  CodingTableCache
+// must be an aggregate for the same reason as SessionTable.
+
+class CodingTableCache {
+public:
+	enum {								// the HOLOSTOR_FLAG_* that change a table
+		KeyFlags = HOLOSTOR_FLAG_GF256|HOLOSTOR_FLAG_MINXOR
+	};
+	struct Entry {
+		CodingTable table;
+		unsigned n, k, flags;			// the key
+		unsigned nRefs;					// sessions using the table
+		Entry *pNext;
+		//
+		NEWOPERATORS
+	};
+	Entry *m_pHead;
+	volatile UINT32 m_lock;
+	//
+	int acquire(const HOLOSTOR_CFG *pCfg, unsigned flags, const CodingTable **ppTable);
+	void release(const CodingTable *pTable);
+private:
+	void _lock();
+	void _unlock();
+	Entry *_acquire(unsigned n, unsigned k, unsigned flags);
+	Entry *_find(unsigned n, unsigned k, unsigned flags) const;
+};
+
+extern CodingTableCache codingTables;
+
 } // namespace HoloStor
 #endif	// HOLOSTOR_HOLOSTORLIB_CODINGTABLE_HPP_
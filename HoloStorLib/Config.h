@@ -36,22 +36,59 @@ enum CpuTypes {
 	CPU_STD =  0u,		// CPU supports only standard 32-bit instructions
 	CPU_MMX =  1u,		// CPU supports MMX (64-bit) instructions
 	CPU_SSE2 = 2u,		// CPU supports SSE2 (128-bit) instructions
+	CPU_AVX2 = 3u,		// CPU (and OS) supports AVX2 (256-bit) instructions
+	CPU_AVX512 = 4u,	// CPU (and OS) supports AVX-512F (512-bit) instructions
 	CPU_UNKNOWN = ~0u	// CPU support is unknown
 };
 
+enum CpuFeatureBits {		// features that a CpuTypes value does not imply
+	CPU_FEATURE_SSSE3 = 1u<<0,		// PSHUFB (128-bit)
+	CPU_FEATURE_AVX512BW = 1u<<1	// VPSHUFB (512-bit), with CPU_AVX512
+};
+
 namespace HoloStor {
 extern unsigned CpuType;
+extern unsigned CpuFeatures;	// CPU_FEATURE_* bits (valid with CpuType)
+extern unsigned CacheSize;		// bytes of L2 cache per core (0 if unknown)
+extern unsigned PrefetchDistance;	// bytes the kernels prefetch ahead (0 for none)
+extern unsigned Threads;			// of the worker pool (1 for none)
 }
 
 #define	HYPERWORD_SIZE	4		// Longs (32-bit) per hyperword (1,2 or 4)
 #define	ELEMENT_WIDTH	4		// Hyperwords per element - Do not change!
 
-const unsigned MaxSessions = 20;	// maximum simultaneous open sessions
+// Code written with SIMD intrinsics is compiled function by function for the
+// instruction set it needs (SIMD_TARGET) and selected at run time by CpuType.
+// Builds that may not touch the vector registers (-mno-sse2, e.g. the Linux
+// kernel target) go without, as do compilers before C++14 (for the constexpr
+// of XorSchedule.hpp).
+#if defined(__GNUC__) && defined(__SSE2__) && __cplusplus >= 201402L && \
+	(__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define	SIMD_INTRINSICS	1
+#define	SIMD_TARGET(isa)	__attribute__((target(isa)))
+#define	SIMD_INLINE			inline __attribute__((always_inline))
+#elif defined(_MSC_VER) && _MSC_VER >= 1910
+#define	SIMD_INTRINSICS	1
+#define	SIMD_TARGET(isa)
+#define	SIMD_INLINE			__forceinline
+#endif
+
+const unsigned MaxSessions = 1u<<16;	// maximum simultaneous open sessions
 //
 const unsigned MinK = 1;		// minimum  ECC nodes supported by the library
-const unsigned MaxK = 4;		// maximum  ECC nodes supported by the library
+const unsigned MaxK = 8;		// maximum  ECC nodes supported by the library
 const unsigned MinN = 1;		// minimum Data nodes supported by the library
 const unsigned MaxN = 16;		// maximum Data nodes supported by the library
+const unsigned MaxBlocks = 255;	// maximum Data+ECC nodes of a GF(2**8) session
+const unsigned MaxMatrices = 1u<<20;	// limits the CodingTable of wide stripes
+//
+const unsigned MinTiledBlockSize = 65536;	// smaller blocks are not tiled
+const unsigned DefaultCacheSize = 256*1024;	// if CPUID does not tell
+const unsigned DefaultPrefetchDistance = 256;	// see HoloStor_SetPrefetch()
+const unsigned MaxPrefetchDistance = 4096;
+const unsigned MinTaskSize = 65536;	// bytes of each block per task of the pool
+const unsigned MaxQueueEntries = 1u<<14;	// calls in flight per session
+const unsigned AsyncThreads = 2;	// run the calls submitted asynchronously
 
 // Workaround for GCC 3.3.1 (i686-pc-cygwin) / 3.3.2 (i686-pc-linux-gnu) bug -
 // if CLASS::operator new[](size_t) returns 0, then ptr = new CLASS[n]
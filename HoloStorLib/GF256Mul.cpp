@@ -0,0 +1,405 @@
+/*  Copyright (C) 2003-2011 Thomas P. Scott and Myron Zimmerman
+
+    Thomas P. Scott <tpscott@alum.mit.edu>
+    Myron Zimmerman <MyronZimmerman@alum.mit.edu>
+
+    This file is part of HoloStor.
+
+    HoloStor is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3 of the License.
+
+    HoloStor is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with HoloStor.  If not, see <http://www.gnu.org/licenses/>.
+
+    Parts of HoloStor are protected by US Patent 7,472,334, the use of
+    which is granted in accordance to the terms of GPLv3.
+*/
+/*****************************************************************************
+
+ Module Name:
+	GF256Mul.cpp
+
+ Abstract:
+	Implementation of class GF256Mul.
+
+	A byte b is multiplied by c as c*(b&15) ^ c*(b&0xF0), two lookups in
+	16-entry tables of the products of c.  PSHUFB performs 16 (32 or 64 with
+	AVX2 or AVX-512) such lookups in one instruction.
+
+--****************************************************************************/
+
+#include "GF256Mul.hpp"
+
+#include <string.h>		// for ANSI memset()
+#include <assert.h>		// for ANSI assert()
+#ifdef	SIMD_INTRINSICS
+#if __GNUC__ >= 11		// for _mm512_undefined_epi32() of the AVX-512 intrinsics
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+#endif
+
+namespace HoloStor {
+
+// The products of each multiplier c with the 16 values of a nibble:
+// Split[c].lo[x] is c*x and Split[c].hi[x] is c*(x<<4).
+static struct {
+	unsigned char lo[16];
+	unsigned char hi[16];
+} Split[256];
+static bool bSplitInit = false;
+
+// Fill in Split[] (idempotent, so a race between sessions is harmless).
+static void
+SplitInit()
+{
+	for (unsigned c = 0; c < 256; c++)
+		for (unsigned x = 0; x < 16; x++) {
+			Split[c].lo[x] = (GF256(c) * GF256(x)).regular();
+			Split[c].hi[x] = (GF256(c) * GF256(x<<4)).regular();
+		}
+	bSplitInit = true;
+}
+
+static void
+STD_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, unsigned nValue)
+{
+	if (nValue == 0)
+		return;
+	const unsigned char *lo = Split[nValue].lo;
+	const unsigned char *hi = Split[nValue].hi;
+	UCHAR *d = (UCHAR*)pDst;
+	const UCHAR *s = (const UCHAR*)pSrc;
+	for (unsigned i = 0; i < nElements*sizeof(Element); i++)
+		d[i] ^= lo[s[i]&0xF] ^ hi[s[i]>>4];
+}
+
+#ifdef	SIMD_INTRINSICS
+// The sources are prefetched PrefetchDistance bytes ahead, though not
+// beyond their end, as by the kernels of GF2Mul.  With bNT set the
+// destinations are written with streaming stores.  The destinations are
+// accumulated in registers for up to RowBlock of them at a time, R (a
+// template parameter) in each pass.
+const unsigned RowBlock = 4;
+
+#define	PREFETCH_SRC(p)	(!bAhead ? (void)0 :		\
+	bNT ? _mm_prefetch((const char*)(p)+nAhead, _MM_HINT_NTA) :	\
+		  _mm_prefetch((const char*)(p)+nAhead, _MM_HINT_T0))
+
+// c*s for the 16 bytes of s, given the tables of c.
+SIMD_TARGET("ssse3") static SIMD_INLINE __m128i
+mul16(__m128i s, __m128i lo, __m128i hi, __m128i mask)
+{
+	return _mm_xor_si128(_mm_shuffle_epi8(lo, _mm_and_si128(s, mask)),
+		_mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi64(s, 4), mask)));
+}
+
+SIMD_TARGET("ssse3") static void
+SSSE3_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, unsigned nValue)
+{
+	if (nValue == 0)
+		return;
+	const __m128i lo = _mm_loadu_si128((const __m128i*)Split[nValue].lo);
+	const __m128i hi = _mm_loadu_si128((const __m128i*)Split[nValue].hi);
+	const __m128i mask = _mm_set1_epi8(0xF);
+	__m128i *q = (__m128i*)pDst;
+	const __m128i *p = (const __m128i*)pSrc;
+	for (unsigned i = 0; i < nElements*ELEMENT_WIDTH; i += 2) {
+		const __m128i s0 = _mm_load_si128(p+i), s1 = _mm_load_si128(p+i+1);
+		_mm_store_si128(q+i,   _mm_xor_si128(_mm_load_si128(q+i),   mul16(s0, lo, hi, mask)));
+		_mm_store_si128(q+i+1, _mm_xor_si128(_mm_load_si128(q+i+1), mul16(s1, lo, hi, mask)));
+	}
+}
+
+// Half an Element (two registers) of each destination at a time.
+template <unsigned R> SIMD_TARGET("ssse3") static SIMD_INLINE void
+multsum16(hyperword_t * const *ppDst, const hyperword_t * const *ppSrc,
+		  unsigned nSrc, const unsigned char *pValue, unsigned nElements,
+		  unsigned nAhead, bool bNT)
+{
+#define	STORE(q,v)	(bNT ? _mm_stream_si128(q, v) : _mm_store_si128(q, v))
+	const __m128i mask = _mm_set1_epi8(0xF);
+	for (unsigned i = 0; i < nElements*ELEMENT_WIDTH; i += 2) {
+		const bool bAhead = nAhead != 0 && (i&(ELEMENT_WIDTH-1)) == 0 &&
+			i*sizeof(hyperword_t)+nAhead < nElements*sizeof(Element);
+		__m128i d[R][2];
+		for (unsigned r = 0; r < R; r++)
+			d[r][0] = d[r][1] = _mm_setzero_si128();
+		for (unsigned j = 0; j < nSrc; j++) {
+			const __m128i *p = (const __m128i*)ppSrc[j] + i;
+			const __m128i s0 = _mm_load_si128(p), s1 = _mm_load_si128(p+1);
+			PREFETCH_SRC(p);
+			for (unsigned r = 0; r < R; r++) {
+				const unsigned c = pValue[r*nSrc+j];
+				const __m128i lo = _mm_loadu_si128((const __m128i*)Split[c].lo);
+				const __m128i hi = _mm_loadu_si128((const __m128i*)Split[c].hi);
+				d[r][0] = _mm_xor_si128(d[r][0], mul16(s0, lo, hi, mask));
+				d[r][1] = _mm_xor_si128(d[r][1], mul16(s1, lo, hi, mask));
+			}
+		}
+		for (unsigned r = 0; r < R; r++) {
+			__m128i *q = (__m128i*)ppDst[r] + i;
+			STORE(q,   d[r][0]);
+			STORE(q+1, d[r][1]);
+		}
+	}
+#undef	STORE
+}
+
+SIMD_TARGET("ssse3") static void
+SSSE3_multsum(hyperword_t * const *ppDst, unsigned nDst,
+			  const hyperword_t * const *ppSrc, unsigned nSrc,
+			  const unsigned char *pValue, unsigned nElements, bool bNT)
+{
+	const unsigned nAhead = PrefetchDistance;
+	for (unsigned r = 0; r < nDst; r += RowBlock) {
+		switch (nDst-r < RowBlock ? nDst-r : RowBlock) {
+		case 1: multsum16<1>( ppDst+r, ppSrc, nSrc, pValue+r*nSrc, nElements, nAhead, bNT); break;
+		case 2: multsum16<2>( ppDst+r, ppSrc, nSrc, pValue+r*nSrc, nElements, nAhead, bNT); break;
+		case 3: multsum16<3>( ppDst+r, ppSrc, nSrc, pValue+r*nSrc, nElements, nAhead, bNT); break;
+		case 4: multsum16<4>( ppDst+r, ppSrc, nSrc, pValue+r*nSrc, nElements, nAhead, bNT); break;
+		}
+	}
+	if (bNT)
+		_mm_sfence();		// order the streaming stores before later stores
+}
+
+// The AVX2 method looks up 32 bytes at a time, the tables of c being in both
+// 128-bit lanes.  The blocks are only 16-byte aligned, so the loads and
+// stores are unaligned (and streamed 16 bytes at a time).
+SIMD_TARGET("avx2") static SIMD_INLINE __m256i
+mul32(__m256i s, __m256i lo, __m256i hi, __m256i mask)
+{
+	return _mm256_xor_si256(_mm256_shuffle_epi8(lo, _mm256_and_si256(s, mask)),
+		_mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi64(s, 4), mask)));
+}
+
+#define	TABLE32(t)	_mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(t)))
+
+SIMD_TARGET("avx2") static void
+AVX2_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, unsigned nValue)
+{
+	if (nValue == 0)
+		return;
+	const __m256i lo = TABLE32(Split[nValue].lo);
+	const __m256i hi = TABLE32(Split[nValue].hi);
+	const __m256i mask = _mm256_set1_epi8(0xF);
+	__m256i *q = (__m256i*)pDst;
+	const __m256i *p = (const __m256i*)pSrc;
+	for (unsigned i = 0; i < nElements*2; i += 2) {
+		const __m256i s0 = _mm256_loadu_si256(p+i), s1 = _mm256_loadu_si256(p+i+1);
+		_mm256_storeu_si256(q+i,   _mm256_xor_si256(_mm256_loadu_si256(q+i),   mul32(s0, lo, hi, mask)));
+		_mm256_storeu_si256(q+i+1, _mm256_xor_si256(_mm256_loadu_si256(q+i+1), mul32(s1, lo, hi, mask)));
+	}
+}
+
+// An Element (two registers) of each destination at a time.
+template <unsigned R> SIMD_TARGET("avx2") static SIMD_INLINE void
+multsum32(hyperword_t * const *ppDst, const hyperword_t * const *ppSrc,
+		  unsigned nSrc, const unsigned char *pValue, unsigned nElements,
+		  unsigned nAhead, bool bNT)
+{
+	const __m256i mask = _mm256_set1_epi8(0xF);
+	for (unsigned e = 0; e < nElements; e++) {
+		const bool bAhead = nAhead != 0 && e*sizeof(Element)+nAhead < nElements*sizeof(Element);
+		__m256i d[R][2];
+		for (unsigned r = 0; r < R; r++)
+			d[r][0] = d[r][1] = _mm256_setzero_si256();
+		for (unsigned j = 0; j < nSrc; j++) {
+			const __m256i *p = (const __m256i*)(ppSrc[j] + e*ELEMENT_WIDTH);
+			const __m256i s0 = _mm256_loadu_si256(p), s1 = _mm256_loadu_si256(p+1);
+			PREFETCH_SRC(p);
+			for (unsigned r = 0; r < R; r++) {
+				const unsigned c = pValue[r*nSrc+j];
+				const __m256i lo = TABLE32(Split[c].lo);
+				const __m256i hi = TABLE32(Split[c].hi);
+				d[r][0] = _mm256_xor_si256(d[r][0], mul32(s0, lo, hi, mask));
+				d[r][1] = _mm256_xor_si256(d[r][1], mul32(s1, lo, hi, mask));
+			}
+		}
+		for (unsigned r = 0; r < R; r++) {
+			__m256i *q = (__m256i*)(ppDst[r] + e*ELEMENT_WIDTH);
+			if (!bNT) {
+				_mm256_storeu_si256(q,   d[r][0]);
+				_mm256_storeu_si256(q+1, d[r][1]);
+				continue;
+			}
+			__m128i *q16 = (__m128i*)q;
+			_mm_stream_si128(q16,   _mm256_castsi256_si128(d[r][0]));
+			_mm_stream_si128(q16+1, _mm256_extracti128_si256(d[r][0], 1));
+			_mm_stream_si128(q16+2, _mm256_castsi256_si128(d[r][1]));
+			_mm_stream_si128(q16+3, _mm256_extracti128_si256(d[r][1], 1));
+		}
+	}
+}
+
+SIMD_TARGET("avx2") static void
+AVX2_multsum(hyperword_t * const *ppDst, unsigned nDst,
+			 const hyperword_t * const *ppSrc, unsigned nSrc,
+			 const unsigned char *pValue, unsigned nElements, bool bNT)
+{
+	const unsigned nAhead = PrefetchDistance;
+	for (unsigned r = 0; r < nDst; r += RowBlock) {
+		switch (nDst-r < RowBlock ? nDst-r : RowBlock) {
+		case 1: multsum32<1>( ppDst+r, ppSrc, nSrc, pValue+r*nSrc, nElements, nAhead, bNT); break;
+		case 2: multsum32<2>( ppDst+r, ppSrc, nSrc, pValue+r*nSrc, nElements, nAhead, bNT); break;
+		case 3: multsum32<3>( ppDst+r, ppSrc, nSrc, pValue+r*nSrc, nElements, nAhead, bNT); break;
+		case 4: multsum32<4>( ppDst+r, ppSrc, nSrc, pValue+r*nSrc, nElements, nAhead, bNT); break;
+		}
+	}
+	if (bNT)
+		_mm_sfence();		// order the streaming stores before later stores
+}
+
+// The AVX-512 method (which needs AVX-512BW) looks up a whole Element at a
+// time.
+SIMD_TARGET("avx512f,avx512bw") static SIMD_INLINE __m512i
+mul64(__m512i s, __m512i lo, __m512i hi, __m512i mask)
+{
+	return _mm512_xor_si512(_mm512_shuffle_epi8(lo, _mm512_and_si512(s, mask)),
+		_mm512_shuffle_epi8(hi, _mm512_and_si512(_mm512_srli_epi64(s, 4), mask)));
+}
+
+#define	TABLE64(t)	_mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)(t)))
+
+SIMD_TARGET("avx512f,avx512bw") static void
+AVX512_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, unsigned nValue)
+{
+	if (nValue == 0)
+		return;
+	const __m512i lo = TABLE64(Split[nValue].lo);
+	const __m512i hi = TABLE64(Split[nValue].hi);
+	const __m512i mask = _mm512_set1_epi8(0xF);
+	__m512i *q = (__m512i*)pDst;
+	const __m512i *p = (const __m512i*)pSrc;
+	for (unsigned e = 0; e < nElements; e++)
+		_mm512_storeu_si512(q+e, _mm512_xor_si512(_mm512_loadu_si512(q+e),
+			mul64(_mm512_loadu_si512(p+e), lo, hi, mask)));
+}
+
+template <unsigned R> SIMD_TARGET("avx512f,avx512bw") static SIMD_INLINE void
+multsum64(hyperword_t * const *ppDst, const hyperword_t * const *ppSrc,
+		  unsigned nSrc, const unsigned char *pValue, unsigned nElements,
+		  unsigned nAhead, bool bNT)
+{
+	const __m512i mask = _mm512_set1_epi8(0xF);
+	for (unsigned e = 0; e < nElements; e++) {
+		const bool bAhead = nAhead != 0 && e*sizeof(Element)+nAhead < nElements*sizeof(Element);
+		__m512i d[R];
+		for (unsigned r = 0; r < R; r++)
+			d[r] = _mm512_setzero_si512();
+		for (unsigned j = 0; j < nSrc; j++) {
+			const __m512i *p = (const __m512i*)(ppSrc[j] + e*ELEMENT_WIDTH);
+			const __m512i s = _mm512_loadu_si512(p);
+			PREFETCH_SRC(p);
+			for (unsigned r = 0; r < R; r++) {
+				const unsigned c = pValue[r*nSrc+j];
+				d[r] = _mm512_xor_si512(d[r],
+					mul64(s, TABLE64(Split[c].lo), TABLE64(Split[c].hi), mask));
+			}
+		}
+		for (unsigned r = 0; r < R; r++) {
+			__m512i *q = (__m512i*)(ppDst[r] + e*ELEMENT_WIDTH);
+			if (!bNT) {
+				_mm512_storeu_si512(q, d[r]);
+				continue;
+			}
+			__m128i *q16 = (__m128i*)q;
+			_mm_stream_si128(q16,   _mm512_extracti32x4_epi32(d[r], 0));
+			_mm_stream_si128(q16+1, _mm512_extracti32x4_epi32(d[r], 1));
+			_mm_stream_si128(q16+2, _mm512_extracti32x4_epi32(d[r], 2));
+			_mm_stream_si128(q16+3, _mm512_extracti32x4_epi32(d[r], 3));
+		}
+	}
+}
+
+SIMD_TARGET("avx512f,avx512bw") static void
+AVX512_multsum(hyperword_t * const *ppDst, unsigned nDst,
+			   const hyperword_t * const *ppSrc, unsigned nSrc,
+			   const unsigned char *pValue, unsigned nElements, bool bNT)
+{
+	const unsigned nAhead = PrefetchDistance;
+	for (unsigned r = 0; r < nDst; r += RowBlock) {
+		switch (nDst-r < RowBlock ? nDst-r : RowBlock) {
+		case 1: multsum64<1>( ppDst+r, ppSrc, nSrc, pValue+r*nSrc, nElements, nAhead, bNT); break;
+		case 2: multsum64<2>( ppDst+r, ppSrc, nSrc, pValue+r*nSrc, nElements, nAhead, bNT); break;
+		case 3: multsum64<3>( ppDst+r, ppSrc, nSrc, pValue+r*nSrc, nElements, nAhead, bNT); break;
+		case 4: multsum64<4>( ppDst+r, ppSrc, nSrc, pValue+r*nSrc, nElements, nAhead, bNT); break;
+		}
+	}
+	if (bNT)
+		_mm_sfence();		// order the streaming stores before later stores
+}
+#endif	// SIMD_INTRINSICS
+
+// The kernels of each method, indexed by CpuTypes value.  There is no MMX
+// kernel, and builds without intrinsics have only the STD kernel.
+static const GF256Kernels
+MethodKernels[CPU_AVX512+1] = {
+	{ CPU_STD,		STD_multadd,	0 },
+	{ CPU_MMX,		STD_multadd,	0 },
+#ifdef	SIMD_INTRINSICS
+	{ CPU_SSE2,		SSSE3_multadd,	SSSE3_multsum },
+	{ CPU_AVX2,		AVX2_multadd,	AVX2_multsum },
+	{ CPU_AVX512,	AVX512_multadd,	AVX512_multsum },
+#else
+	{ CPU_SSE2,		STD_multadd,	0 },
+	{ CPU_AVX2,		STD_multadd,	0 },
+	{ CPU_AVX512,	STD_multadd,	0 },
+#endif
+};
+
+// The SSE2 method needs SSSE3 as well (which every AVX2 CPU has) and the
+// AVX-512 method needs AVX-512BW.
+const GF256Kernels&
+GF256Mul::Kernels(unsigned method)
+{
+	if (!bSplitInit)
+		SplitInit();
+	if (method > CPU_AVX512)		// i.e. CPU_UNKNOWN
+		method = CPU_STD;
+	if (method == CPU_AVX512 && !(CpuFeatures & CPU_FEATURE_AVX512BW))
+		method = CPU_AVX2;
+	if (method == CPU_SSE2 && !(CpuFeatures & CPU_FEATURE_SSSE3))
+		method = CPU_STD;
+	return MethodKernels[method];
+}
+
+void
+GF256Mul::gf256multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements,
+					   const GF256Kernels& kernels) const
+{
+	kernels.multadd(pDst, pSrc, nElements, m_value);
+}
+
+// As GF2Mul::gf2multsum(): row r of the multipliers (from pMul[r*nSrc])
+// produces ppDst[r], reading each source once for all the destinations.
+//
+void
+GF256Mul::gf256multsum(hyperword_t * const *ppDst, unsigned nDst,
+					   const hyperword_t * const *ppSrc, unsigned nSrc,
+					   const GF256Mul *pMul, unsigned nElements, const GF256Kernels& kernels,
+					   bool bNonTemporal)
+{
+	assert(nDst <= MaxK && nSrc <= MaxBlocks);
+	assert(sizeof(GF256Mul) == 1);	// so that pMul is an array of values
+	const unsigned char *pValue = &pMul->m_value;
+	if (kernels.multsum) {
+		kernels.multsum( ppDst, nDst, ppSrc, nSrc, pValue, nElements, bNonTemporal);
+		return;
+	}
+	// No fused kernel - accumulate in memory (and in the cache).
+	for (unsigned r = 0; r < nDst; r++) {
+		::memset(ppDst[r], 0, nElements*sizeof(Element));
+		for (unsigned j = 0; j < nSrc; j++)
+			kernels.multadd(ppDst[r], ppSrc[j], nElements, pValue[r*nSrc+j]);
+	}
+}
+
+} // namespace HoloStor
@@ -0,0 +1,91 @@
+/*  Copyright (C) 2003-2011 Thomas P. Scott and Myron Zimmerman
+
+    Thomas P. Scott <tpscott@alum.mit.edu>
+    Myron Zimmerman <MyronZimmerman@alum.mit.edu>
+
+    This file is part of HoloStor.
+
+    HoloStor is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3 of the License.
+
+    HoloStor is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with HoloStor.  If not, see <http://www.gnu.org/licenses/>.
+
+    Parts of HoloStor are protected by US Patent 7,472,334, the use of
+    which is granted in accordance to the terms of GPLv3.
+*/
+/*****************************************************************************
+
+ Module Name:
+	GF256Mul.hpp
+
+ Abstract:
+	Interface to class GF256Mul.
+
+	This class implements multiply (& add) operations in the GF(2**8)
+	extension field of HOLOSTOR_FLAG_GF256 sessions.  Unlike GF2Mul, the
+	blocks are in the standard layout: each byte is an element of the field.
+	A byte is multiplied by looking up the products of its two nibbles, which
+	the SIMD methods do for a whole register at a time (PSHUFB).
+
+--****************************************************************************/
+#ifndef	HOLOSTOR_HOLOSTORLIB_GF256MUL_HPP_
+#define HOLOSTOR_HOLOSTORLIB_GF256MUL_HPP_
+
+#include "HoloStor.h"
+#include "Config.h"
+#include "Types.h"
+//
+#include "TypesGF.hpp"
+//
+#include <assert.h>		// for ANSI assert()
+
+namespace HoloStor {
+
+// The kernels of one method, as for GF2Mul.  Blocks are still processed in
+// units of sizeof(Element) bytes.
+struct GF256Kernels {
+	unsigned method;
+	void (*multadd)(hyperword_t *pDst, const hyperword_t *pSrc,
+		unsigned nElements, unsigned nValue);
+	void (*multsum)(hyperword_t * const *ppDst, unsigned nDst,			// NULL
+		const hyperword_t * const *ppSrc, unsigned nSrc,				// if the
+		const unsigned char *pValue, unsigned nElements, bool bNT);	// method has none
+};
+
+class GF256Mul {
+private:
+	unsigned char m_value;
+public:
+	// constructors
+	GF256Mul() : m_value(0) {}
+	GF256Mul(const GF256& x)	: m_value(x.regular()) {}
+	GF256Mul(const unsigned v)	: m_value(v) { assert(v < 256); }
+	// copy constructors
+	GF256Mul(const GF256Mul& rhs) : m_value(rhs.m_value) {}
+	// copy assignment
+	GF256Mul operator=(const GF256Mul rhs) {
+		m_value = rhs.m_value;
+		return *this;
+	}
+	//
+	void gf256multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements,
+		const GF256Kernels& kernels) const;
+	static void gf256multsum(hyperword_t * const *ppDst, unsigned nDst,
+		const hyperword_t * const *ppSrc, unsigned nSrc,
+		const GF256Mul *pMul, unsigned nElements, const GF256Kernels& kernels,
+		bool bNonTemporal = false);
+	//
+	static const GF256Kernels& Kernels(unsigned method);
+	//
+	NEWOPERATORS
+};
+
+} // namespace HoloStor
+#endif	// HOLOSTOR_HOLOSTORLIB_GF256MUL_HPP_
@@ -41,6 +41,10 @@
 #include <iostream>
 #endif
 #include <assert.h>		// for ANSI assert()
+#ifdef	SIMD_INTRINSICS
+#include <immintrin.h>
+#include "XorSchedule.hpp"
+#endif
 
 #if ELEMENT_WIDTH != 4
 #error Invalid ELEMENT_WIDTH constant (must be 4)
@@ -77,31 +81,252 @@ GF2Mul::multOp(gfQ x)
 // Element consists of hyperword_t[ELEMENT_WIDTH].
 //
 void
+AVX512_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, unsigned nIndex);
+void
+AVX2_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, unsigned nIndex);
+void
 SSE2_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, unsigned nIndex);
 void
  MMX_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, unsigned nIndex);
 void
  STD_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, unsigned nIndex);
 
+#if defined(SIMD_INTRINSICS) && HYPERWORD_SIZE == 4
 void
-GF2Mul::gf2multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements) const
-{
-	switch (CpuType) {
+AVX512_multsum(hyperword_t * const *ppDst, unsigned nDst,
+			   const hyperword_t * const *ppSrc, unsigned nSrc,
+			   const unsigned char *pIndex, unsigned nElements, bool bNT);
+void
+AVX2_multsum(hyperword_t * const *ppDst, unsigned nDst,
+			 const hyperword_t * const *ppSrc, unsigned nSrc,
+			 const unsigned char *pIndex, unsigned nElements, bool bNT);
+void
+SSE2_multsum(hyperword_t * const *ppDst, unsigned nDst,
+			 const hyperword_t * const *ppSrc, unsigned nSrc,
+			 const unsigned char *pIndex, unsigned nElements, bool bNT);
+#endif
+
+// The kernels of each method, indexed by CpuTypes value.  Methods without a
+// kernel of their own (in this build) use those of a lesser method.
+static const GF2Kernels
+MethodKernels[CPU_AVX512+1] = {
+	{ CPU_STD,		STD_multadd,	0 },
 #if HYPERWORD_SIZE == 4
-	case CPU_SSE2:
-		SSE2_multadd( pDst, pSrc, nElements, m_index);
-		break;
-	case CPU_MMX:
-		 MMX_multadd( pDst, pSrc, nElements, m_index);
-		break;
+	{ CPU_MMX,		MMX_multadd,	0 },
+#ifdef	SIMD_INTRINSICS
+	{ CPU_SSE2,		SSE2_multadd,	SSE2_multsum },
+	{ CPU_AVX2,		AVX2_multadd,	AVX2_multsum },
+	{ CPU_AVX512,	AVX512_multadd,	AVX512_multsum },
+#else
+	{ CPU_SSE2,		SSE2_multadd,	0 },
+	{ CPU_AVX2,		AVX2_multadd,	0 },
+	{ CPU_AVX512,	AVX512_multadd,	0 },
 #endif
-	case CPU_STD:
-	default:
-		 STD_multadd( pDst, pSrc, nElements, m_index);
-		break;
+#else	// HYPERWORD_SIZE != 4
+	{ CPU_MMX,		STD_multadd,	0 },
+	{ CPU_SSE2,		STD_multadd,	0 },
+	{ CPU_AVX2,		STD_multadd,	0 },
+	{ CPU_AVX512,	STD_multadd,	0 },
+#endif
+};
+
+const GF2Kernels&
+GF2Mul::Kernels(unsigned method)
+{
+	if (method > CPU_AVX512)		// i.e. CPU_UNKNOWN
+		method = CPU_STD;
+	return MethodKernels[method];
+}
+
+// Hint that the Element at p will soon be read (and written).
+#if defined(__GNUC__)
+#define	PREFETCH(p)	__builtin_prefetch((p), 1)
+#elif defined(SIMD_INTRINSICS)
+#define	PREFETCH(p)	_mm_prefetch((const char*)(p), _MM_HINT_T0)
+#else
+#define	PREFETCH(p)
+#endif
+
+// The prefetching variant (PrefetchDistance != 0) runs the kernel over
+// chunks of PrefetchChunk Elements, each preceded by prefetches of the
+// Elements of pSrc and pDst PrefetchDistance bytes ahead of the chunk.
+// When a Rebuild or Decode walks many source blocks in turn, the hardware
+// prefetcher would otherwise have to pick up every stream anew.
+const unsigned PrefetchChunk = 16;
+
+void
+GF2Mul::gf2multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements,
+				   const GF2Kernels& kernels) const
+{
+	const unsigned nAhead = PrefetchDistance/sizeof(Element);	// in Elements
+	if (nAhead == 0 || m_index == 0 || nElements <= PrefetchChunk) {
+		kernels.multadd( pDst, pSrc, nElements, m_index);
+		return;
+	}
+	for (unsigned e = 0; e < nElements; e += PrefetchChunk) {
+		const unsigned n = nElements-e < PrefetchChunk ? nElements-e : PrefetchChunk;
+		// Stay within the buffers: touch Elements [e+nAhead, e+n+nAhead).
+		for (unsigned i = e+nAhead; i < e+n+nAhead && i < nElements; i++) {
+			PREFETCH(pSrc + i*ELEMENT_WIDTH);
+			PREFETCH(pDst + i*ELEMENT_WIDTH);
+		}
+		kernels.multadd( pDst + e*ELEMENT_WIDTH, pSrc + e*ELEMENT_WIDTH, n, m_index);
+	}
+}
+
+#ifdef	SIMD_INTRINSICS
+// The SIMD methods multiply-add by the XOR schedules of XorSchedule.hpp.
+// Each method has a loop per multiplier (V, a template parameter) so that
+// the schedule is straight-line code the compiler can allocate registers for
+// and schedule.  Builds without intrinsics (the kernel target, older MSVC)
+// use the assembler versions further below.
+//
+// The SSE2 method does N Elements at a time.  Their XOR chains are independent,
+// so on x86-64, where the second Element can have xmm8-xmm15 to itself, they
+// overlap in the pipeline.  (32-bit code has only xmm0-xmm7.)
+#if defined(__x86_64__) || defined(_M_X64)
+const unsigned SSE2Interleave = 2;
+#else
+const unsigned SSE2Interleave = 1;
+#endif
+
+template <unsigned V, unsigned N> SIMD_TARGET("sse2") static SIMD_INLINE void
+multaddN(hyperword_t *pDst, const hyperword_t *pSrc)
+{
+	__m128i *q = (__m128i*)pDst;
+	const __m128i *p = (const __m128i*)pSrc;
+	__m128i d[N][ELEMENT_WIDTH], s[N][ELEMENT_WIDTH];
+	for (unsigned k = 0; k < N; k++)
+		for (unsigned i = 0; i < ELEMENT_WIDTH; i++) {
+			d[k][i] = _mm_load_si128(q + k*ELEMENT_WIDTH+i);
+			s[k][i] = _mm_load_si128(p + k*ELEMENT_WIDTH+i);
+		}
+	for (unsigned k = 0; k < N; k++)
+		XorMultAdd<V>(d[k], s[k]);
+	for (unsigned k = 0; k < N; k++)
+		for (unsigned i = 0; i < ELEMENT_WIDTH; i++)
+			_mm_store_si128(q + k*ELEMENT_WIDTH+i, d[k][i]);
+}
+
+template <unsigned V> SIMD_TARGET("sse2") static SIMD_INLINE void
+multadd1(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements)
+{
+	unsigned e = 0;
+	for (; e+SSE2Interleave <= nElements; e += SSE2Interleave)
+		multaddN<V, SSE2Interleave>( pDst + e*ELEMENT_WIDTH, pSrc + e*ELEMENT_WIDTH);
+	for (; e < nElements; e++)
+		multaddN<V, 1>( pDst + e*ELEMENT_WIDTH, pSrc + e*ELEMENT_WIDTH);
+}
+
+SIMD_TARGET("sse2") void
+SSE2_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, unsigned nIndex)
+{
+	if (nIndex == 0)
+		return;
+	switch (nIndex) {
+#define	CASE(V)	case V: multadd1<V>( pDst, pSrc, nElements); break;
+	XOR_SCHEDULE_CASES(CASE)
+#undef	CASE
 	}
 }
 
+// The AVX2 method processes Elements in pairs: hyperword i of two adjacent
+// Elements is gathered into the low and high lanes of a ymm register so the
+// storage layout is identical to the SSE2 method.  An odd trailing Element
+// is done as by SSE2_multadd().
+template <unsigned V> SIMD_TARGET("avx2") static SIMD_INLINE void
+multadd2(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements)
+{
+#define	LOAD2(p,i)	_mm256_inserti128_si256(_mm256_castsi128_si256(	\
+						_mm_load_si128((p)+(i))), _mm_load_si128((p)+ELEMENT_WIDTH+(i)), 1)
+	const unsigned nPairs = nElements>>1;
+	for (unsigned e = 0; e < 2*nPairs; e += 2) {
+		__m128i *q = (__m128i*)(pDst + e*ELEMENT_WIDTH);
+		const __m128i *p = (const __m128i*)(pSrc + e*ELEMENT_WIDTH);
+		__m256i d[ELEMENT_WIDTH], s[ELEMENT_WIDTH];
+		for (unsigned i = 0; i < ELEMENT_WIDTH; i++) {
+			d[i] = LOAD2(q, i);
+			s[i] = LOAD2(p, i);
+		}
+		XorMultAdd<V>(d, s);
+		for (unsigned i = 0; i < ELEMENT_WIDTH; i++) {
+			_mm_store_si128(q+i, _mm256_castsi256_si128(d[i]));
+			_mm_store_si128(q+ELEMENT_WIDTH+i, _mm256_extracti128_si256(d[i], 1));
+		}
+	}
+#undef	LOAD2
+	_mm256_zeroupper();
+	if (nElements & 1)
+		multadd1<V>( pDst + 2*nPairs*ELEMENT_WIDTH, pSrc + 2*nPairs*ELEMENT_WIDTH, 1);
+}
+
+SIMD_TARGET("avx2") void
+AVX2_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, unsigned nIndex)
+{
+	if (nIndex == 0)
+		return;
+	switch (nIndex) {
+#define	CASE(V)	case V: multadd2<V>( pDst, pSrc, nElements); break;
+	XOR_SCHEDULE_CASES(CASE)
+#undef	CASE
+	}
+}
+
+// The AVX2 code compiled for AVX-512VL, where the compiler folds pairs of
+// XORs into one VPTERNLOG.
+SIMD_TARGET("avx2,avx512f,avx512vl") void
+AVX512_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, unsigned nIndex)
+{
+	if (nIndex == 0)
+		return;
+	switch (nIndex) {
+#define	CASE(V)	case V: multadd2<V>( pDst, pSrc, nElements); break;
+	XOR_SCHEDULE_CASES(CASE)
+#undef	CASE
+	}
+}
+
+#if defined(__GNUC__) || defined(_M_IX86)	// no __m64 in 64-bit MSVC
+template <unsigned V> SIMD_TARGET("mmx") static SIMD_INLINE void
+multadd64(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements)
+{
+	// Each hyperword is done as two halves: the low halves of the Element,
+	// then the high halves.
+	for (unsigned e = 0; e < 2*nElements; e++) {
+		__m64 *q = (__m64*)(pDst + (e>>1)*ELEMENT_WIDTH) + (e&1);
+		const __m64 *p = (const __m64*)(pSrc + (e>>1)*ELEMENT_WIDTH) + (e&1);
+		__m64 d[ELEMENT_WIDTH], s[ELEMENT_WIDTH];
+		for (unsigned i = 0; i < ELEMENT_WIDTH; i++) {
+			d[i] = q[2*i];
+			s[i] = p[2*i];
+		}
+		XorMultAdd<V>(d, s);
+		for (unsigned i = 0; i < ELEMENT_WIDTH; i++)
+			q[2*i] = d[i];
+	}
+}
+
+SIMD_TARGET("mmx") void
+MMX_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, unsigned nIndex)
+{
+	if (nIndex == 0)
+		return;
+	switch (nIndex) {
+#define	CASE(V)	case V: multadd64<V>( pDst, pSrc, nElements); break;
+	XOR_SCHEDULE_CASES(CASE)
+#undef	CASE
+	}
+	_mm_empty();
+}
+#else
+void
+MMX_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, unsigned nIndex)
+{
+	STD_multadd( pDst, pSrc, nElements, nIndex);
+}
+#endif
+
+#else	// !SIMD_INTRINSICS
 void
 SSE2_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, unsigned nIndex)
 {
@@ -567,6 +792,337 @@ SSE2_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, uns
 #endif	// _MSC_VER
 }
 
+// The AVX2 method processes Elements in pairs: hyperword i of two adjacent
+// Elements is gathered into the low and high lanes of a ymm register so the
+// storage layout (and so the code) is identical to the SSE2 method.  An odd
+// trailing Element is handed to SSE2_multadd().
+void
+AVX2_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, unsigned nIndex)
+{
+#if _MSC_VER	// MSFT inline assembler does not support AVX2 instructions.
+	SSE2_multadd( pDst, pSrc, nElements, nIndex);	// so pass this case on to SSE2
+#else	// !_MSC_VER (GCC)
+	const unsigned nPairs = nElements >> 1;
+	if (nElements & 1)
+		SSE2_multadd( pDst + 2*nPairs*ELEMENT_WIDTH,
+					  pSrc + 2*nPairs*ELEMENT_WIDTH, 1, nIndex);
+	if (nPairs == 0)
+		return;
+#undef ASM_PROLOGUE
+#undef ASM_EPILOGUE
+// Uses the EAX, EDX, LOAD_REGS and BUMP_REGS macros defined for SSE2_multadd().
+#ifdef __SSE__
+# define XMM_CLOBBERS(...)	, __VA_ARGS__
+#else	// -mno-sse (kernel target): xmm registers are unknown to the compiler
+# define XMM_CLOBBERS(...)
+#endif
+#define	ASM_PROLOGUE(label)	__asm__ __volatile__(	\
+	LOAD_REGS				\
+	"0:\n\t"				\
+	"vmovdqa	  (" EAX "),%%xmm0\n\t"		\
+	"vmovdqa	16(" EAX "),%%xmm1\n\t"		\
+	"vmovdqa	32(" EAX "),%%xmm2\n\t"		\
+	"vmovdqa	48(" EAX "),%%xmm3\n\t"		\
+	"vinserti128	$1, 64(" EAX "),%%ymm0,%%ymm0\n\t"	\
+	"vinserti128	$1, 80(" EAX "),%%ymm1,%%ymm1\n\t"	\
+	"vinserti128	$1, 96(" EAX "),%%ymm2,%%ymm2\n\t"	\
+	"vinserti128	$1,112(" EAX "),%%ymm3,%%ymm3\n\t"	\
+	"vmovdqa	  (" EDX "),%%xmm4\n\t"		\
+	"vmovdqa	16(" EDX "),%%xmm5\n\t"		\
+	"vmovdqa	32(" EDX "),%%xmm6\n\t"		\
+	"vmovdqa	48(" EDX "),%%xmm7\n\t"		\
+	"vinserti128	$1, 64(" EDX "),%%ymm4,%%ymm4\n\t"	\
+	"vinserti128	$1, 80(" EDX "),%%ymm5,%%ymm5\n\t"	\
+	"vinserti128	$1, 96(" EDX "),%%ymm6,%%ymm6\n\t"	\
+	"vinserti128	$1,112(" EDX "),%%ymm7,%%ymm7\n\t"
+
+#define	ASM_EPILOGUE(label)			\
+	"vmovdqa	%%xmm0,  (" EAX ")\n\t"		\
+	"vmovdqa	%%xmm1,16(" EAX ")\n\t"		\
+	"vmovdqa	%%xmm2,32(" EAX ")\n\t"		\
+	"vmovdqa	%%xmm3,48(" EAX ")\n\t"		\
+	"vextracti128	$1,%%ymm0, 64(" EAX ")\n\t"	\
+	"vextracti128	$1,%%ymm1, 80(" EAX ")\n\t"	\
+	"vextracti128	$1,%%ymm2, 96(" EAX ")\n\t"	\
+	"vextracti128	$1,%%ymm3,112(" EAX ")\n\t"	\
+	BUMP_REGS("$128")			\
+	"decl	%%ecx\n\t"			\
+	"jnz	0b\n\t"	/* body exceeds the reach of loop */	\
+	"vzeroupper"				\
+	: : "m" (pDst), "m" (pSrc), "m" (nPairs)	\
+	: "eax", "ecx", "edx", "memory"		\
+	  XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3",	\
+	  "xmm4", "xmm5", "xmm6", "xmm7") );
+
+	switch (nIndex) {
+	case 0:
+		return;
+	case 1:
+		ASM_PROLOGUE(L1)
+		"vpxor	%%ymm4,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm5,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm6,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm7,%%ymm3,%%ymm3\n\t"
+		ASM_EPILOGUE(L1)
+		break;
+	case 2:
+		ASM_PROLOGUE(L2)
+		"vpxor	%%ymm7,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm4,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm7,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm5,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm6,%%ymm3,%%ymm3\n\t"
+		ASM_EPILOGUE(L2)
+		break;
+	case 3:
+		ASM_PROLOGUE(L3)
+		"vpxor	%%ymm4,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm7,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm4,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm5,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm7,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm5,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm6,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm6,%%ymm3,%%ymm3\n\t"
+		"vpxor	%%ymm7,%%ymm3,%%ymm3\n\t"
+		ASM_EPILOGUE(L3)
+		break;
+	case 4:
+		ASM_PROLOGUE(L4)
+		"vpxor	%%ymm6,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm6,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm7,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm4,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm7,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm5,%%ymm3,%%ymm3\n\t"
+		ASM_EPILOGUE(L4)
+		break;
+	case 5:
+		ASM_PROLOGUE(L5)
+		"vpxor	%%ymm4,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm6,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm5,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm6,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm7,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm4,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm6,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm7,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm5,%%ymm3,%%ymm3\n\t"
+		"vpxor	%%ymm7,%%ymm3,%%ymm3\n\t"
+		ASM_EPILOGUE(L5)
+		break;
+	case 6:
+		ASM_PROLOGUE(L6)
+		"vpxor	%%ymm6,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm7,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm4,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm6,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm4,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm5,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm7,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm5,%%ymm3,%%ymm3\n\t"
+		"vpxor	%%ymm6,%%ymm3,%%ymm3\n\t"
+		ASM_EPILOGUE(L6)
+		break;
+	case 7:
+		ASM_PROLOGUE(L7)
+		"vpxor	%%ymm4,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm6,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm7,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm4,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm5,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm6,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm4,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm5,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm6,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm7,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm5,%%ymm3,%%ymm3\n\t"
+		"vpxor	%%ymm6,%%ymm3,%%ymm3\n\t"
+		"vpxor	%%ymm7,%%ymm3,%%ymm3\n\t"
+		ASM_EPILOGUE(L7)
+		break;
+	case 8:
+		ASM_PROLOGUE(L8)
+		"vpxor	%%ymm5,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm5,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm6,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm6,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm7,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm4,%%ymm3,%%ymm3\n\t"
+		"vpxor	%%ymm7,%%ymm3,%%ymm3\n\t"
+		ASM_EPILOGUE(L8)
+		break;
+	case 9:
+		ASM_PROLOGUE(L9)
+		"vpxor	%%ymm4,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm5,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm6,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm7,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm4,%%ymm3,%%ymm3\n\t"
+		ASM_EPILOGUE(L9)
+		break;
+	case 10:
+		ASM_PROLOGUE(L10)
+		"vpxor	%%ymm5,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm7,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm4,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm5,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm6,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm7,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm5,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm6,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm7,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm4,%%ymm3,%%ymm3\n\t"
+		"vpxor	%%ymm6,%%ymm3,%%ymm3\n\t"
+		"vpxor	%%ymm7,%%ymm3,%%ymm3\n\t"
+		ASM_EPILOGUE(L10)
+		break;
+	case 11:
+		ASM_PROLOGUE(L11)
+		"vpxor	%%ymm4,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm5,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm7,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm4,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm6,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm7,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm5,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm7,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm4,%%ymm3,%%ymm3\n\t"
+		"vpxor	%%ymm6,%%ymm3,%%ymm3\n\t"
+		ASM_EPILOGUE(L11)
+		break;
+	case 12:
+		ASM_PROLOGUE(L12)
+		"vpxor	%%ymm5,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm6,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm5,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm7,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm4,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm6,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm4,%%ymm3,%%ymm3\n\t"
+		"vpxor	%%ymm5,%%ymm3,%%ymm3\n\t"
+		"vpxor	%%ymm7,%%ymm3,%%ymm3\n\t"
+		ASM_EPILOGUE(L12)
+		break;
+	case 13:
+		ASM_PROLOGUE(L13)
+		"vpxor	%%ymm4,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm5,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm6,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm7,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm4,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm4,%%ymm3,%%ymm3\n\t"
+		"vpxor	%%ymm5,%%ymm3,%%ymm3\n\t"
+		ASM_EPILOGUE(L13)
+		break;
+	case 14:
+		ASM_PROLOGUE(L14)
+		"vpxor	%%ymm5,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm6,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm7,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm4,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm5,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm4,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm5,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm6,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm4,%%ymm3,%%ymm3\n\t"
+		"vpxor	%%ymm5,%%ymm3,%%ymm3\n\t"
+		"vpxor	%%ymm6,%%ymm3,%%ymm3\n\t"
+		"vpxor	%%ymm7,%%ymm3,%%ymm3\n\t"
+		ASM_EPILOGUE(L14)
+		break;
+	case 15:
+		ASM_PROLOGUE(L15)
+		"vpxor	%%ymm4,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm5,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm6,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm7,%%ymm0,%%ymm0\n\t"
+		"vpxor	%%ymm4,%%ymm1,%%ymm1\n\t"
+		"vpxor	%%ymm4,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm5,%%ymm2,%%ymm2\n\t"
+		"vpxor	%%ymm4,%%ymm3,%%ymm3\n\t"
+		"vpxor	%%ymm5,%%ymm3,%%ymm3\n\t"
+		"vpxor	%%ymm6,%%ymm3,%%ymm3\n\t"
+		ASM_EPILOGUE(L15)
+		break;
+	}
+#endif	// _MSC_VER
+}
+
+// The AVX-512 method holds a whole Element in a zmm register, hyperword i in
+// 128-bit lane i.  Rather than XOR hyperwords one pair at a time, the 4x4
+// GF(2) multiplication matrix is split into its 4 (wrapped) diagonals: the
+// source rotated by s lanes is XOR-ed into those destination lanes where
+// diagonal s of the matrix is 1.  The rotations are zero-masked by opmask and
+// VPTERNLOG folds two of them into one instruction, so every multiplier costs
+// the same 6 operations per Element no matter how many XORs its matrix has.
+//
+// AVX512_Masks[v][s] is the qword opmask of diagonal s for multiplier v,
+// (matrix element (i,(i+s)%4) set => bits 2i and 2i+1 set) as output by
+// GF2Mul::dump() with AVX512_MASKS defined.
+static const unsigned char
+AVX512_Masks[16][4] = {
+	{ 0x00, 0x00, 0x00, 0x00 },	// 0
+	{ 0xFF, 0x00, 0x00, 0x00 },	// 1
+	{ 0x00, 0x00, 0x0C, 0xFF },	// 2
+	{ 0xFF, 0x00, 0x0C, 0xFF },	// 3
+	{ 0x00, 0x3C, 0xFF, 0x00 },	// 4
+	{ 0xFF, 0x3C, 0xFF, 0x00 },	// 5
+	{ 0x00, 0x3C, 0xF3, 0xFF },	// 6
+	{ 0xFF, 0x3C, 0xF3, 0xFF },	// 7
+	{ 0xFC, 0xFF, 0x00, 0x00 },	// 8
+	{ 0x03, 0xFF, 0x00, 0x00 },	// 9
+	{ 0xFC, 0xFF, 0x0C, 0xFF },	// 10
+	{ 0x03, 0xFF, 0x0C, 0xFF },	// 11
+	{ 0xFC, 0xC3, 0xFF, 0x00 },	// 12
+	{ 0x03, 0xC3, 0xFF, 0x00 },	// 13
+	{ 0xFC, 0xC3, 0xF3, 0xFF },	// 14
+	{ 0x03, 0xC3, 0xF3, 0xFF },	// 15
+};
+
+void
+AVX512_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, unsigned nIndex)
+{
+#if _MSC_VER	// MSFT inline assembler does not support AVX-512 instructions.
+	AVX2_multadd( pDst, pSrc, nElements, nIndex);	// so pass this case on to AVX2
+#else	// !_MSC_VER (GCC)
+	if (nIndex == 0)
+		return;
+	const unsigned short m0 = AVX512_Masks[nIndex][0];	// kmovw operands
+	const unsigned short m1 = AVX512_Masks[nIndex][1];
+	const unsigned short m2 = AVX512_Masks[nIndex][2];
+	const unsigned short m3 = AVX512_Masks[nIndex][3];
+	// Uses the EAX, EDX, LOAD_REGS and BUMP_REGS macros defined for SSE2_multadd().
+	// Opmask k4 selects the unrotated diagonal and k1..k3 the rotations by
+	// 1..3 lanes (VSHUFI64X2 immediates 0x39, 0x4E and 0x93).
+	__asm__ __volatile__(
+		LOAD_REGS
+		"kmovw	%3,%%k4\n\t"
+		"kmovw	%4,%%k1\n\t"
+		"kmovw	%5,%%k2\n\t"
+		"kmovw	%6,%%k3\n\t"
+		"0:\n\t"
+		"vmovdqu64	(" EAX "),%%zmm0\n\t"
+		"vmovdqu64	(" EDX "),%%zmm1\n\t"
+		"vshufi64x2	$0x39,%%zmm1,%%zmm1,%%zmm2%{%%k1%}%{z%}\n\t"
+		"vshufi64x2	$0x4E,%%zmm1,%%zmm1,%%zmm3%{%%k2%}%{z%}\n\t"
+		"vshufi64x2	$0x93,%%zmm1,%%zmm1,%%zmm4%{%%k3%}%{z%}\n\t"
+		"vpxorq	%%zmm1,%%zmm0,%%zmm0%{%%k4%}\n\t"
+		"vpternlogq	$0x96,%%zmm3,%%zmm2,%%zmm0\n\t"	// zmm0 ^= zmm2 ^ zmm3
+		"vpxorq	%%zmm4,%%zmm0,%%zmm0\n\t"
+		"vmovdqu64	%%zmm0,(" EAX ")\n\t"
+		BUMP_REGS("$64")
+		"decl	%%ecx\n\t"
+		"jnz	0b\n\t"
+		"vzeroupper"
+		: : "m" (pDst), "m" (pSrc), "m" (nElements),
+			"m" (m0), "m" (m1), "m" (m2), "m" (m3)
+		: "eax", "ecx", "edx", "memory"
+		  XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3", "xmm4") );
+		// k1-k4 are not known to (so not used by) the compiler
+#endif	// _MSC_VER
+}
+
 void
 MMX_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, unsigned nIndex)
 {
@@ -1023,6 +1579,7 @@ MMX_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, unsi
 	__asm__ __volatile__("emms");
 #endif	// _MSC_VER
 }
+#endif	// SIMD_INTRINSICS
 
 void
 STD_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned  nElements, unsigned nIndex)
@@ -1210,8 +1767,217 @@ STD_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned  nElements, uns
 		}
 		pDst += ELEMENT_WIDTH; pSrc += ELEMENT_WIDTH;
 	} while (--nElements > 0);
+#undef	XOR
+#undef	XOR_BODY
 }
 
+// Multiply the Element(s) located at each ppSrc[j] by the scalar pMul[j] and
+// store the sum of the nSrc products at ppDst[0].  Likewise for each of the
+// nDst destinations: row r of the multipliers (from pMul[r*nSrc]) produces
+// ppDst[r].  Unlike a memset() followed by nDst*nSrc calls of gf2multadd(),
+// which read every source nDst times and every destination nSrc times, the
+// sums are accumulated in registers one Element at a time: each source
+// Element is loaded once for all destinations and each destination Element
+// is written once.  With bNonTemporal set, the destinations are written
+// around the cache (by the SIMD methods only).
+//
+void
+GF2Mul::gf2multsum(hyperword_t * const *ppDst, unsigned nDst,
+				   const hyperword_t * const *ppSrc, unsigned nSrc,
+				   const GF2Mul *pMul, unsigned nElements, const GF2Kernels& kernels,
+				   bool bNonTemporal)
+{
+	assert(nDst <= MaxK && nSrc <= MaxN);
+	// Sources with a zero multiplier in every row add nothing - do not even
+	// read them.  The multipliers of the others go to Index[r*MaxN+j].
+	const hyperword_t *pSrcs[MaxN];
+	unsigned char Index[MaxK*MaxN];
+	unsigned n = 0;
+	for (unsigned j = 0; j < nSrc; j++) {
+		bool bUsed = false;
+		for (unsigned r = 0; r < nDst; r++)
+			bUsed = bUsed || pMul[r*nSrc+j].m_index != 0;
+		if (!bUsed)
+			continue;
+		for (unsigned r = 0; r < nDst; r++)
+			Index[r*MaxN+n] = pMul[r*nSrc+j].m_index;
+		pSrcs[n++] = ppSrc[j];
+	}
+	if (kernels.multsum) {
+		kernels.multsum( ppDst, nDst, pSrcs, n, Index, nElements, bNonTemporal);
+		return;
+	}
+	// No fused kernel - accumulate in memory (and in the cache).
+	for (unsigned r = 0; r < nDst; r++) {
+		::memset(ppDst[r], 0, nElements*sizeof(Element));
+		for (unsigned j = 0; j < n; j++)
+			GF2Mul(Index[r*MaxN+j]).gf2multadd(ppDst[r], pSrcs[j], nElements, kernels);
+	}
+}
+
+#ifdef	SIMD_INTRINSICS
+// The fused kernels hold the destination Elements in registers, so the
+// multiplier of every (destination, source) pair is a branch per Element.
+// The branches repeat with period nDst*nSrc and are well predicted.  Up to
+// RowBlock destinations are accumulated together (R of them, a template
+// parameter so that the accumulators are registers, not an array); more are
+// done in further passes.
+//
+// The sources are prefetched nAhead Elements (PrefetchDistance bytes) ahead,
+// though not beyond their end (nor at all if nAhead is 0).  With bNT set the
+// destinations are written with streaming stores, which bypass the cache, and
+// the sources are prefetched with the NTA hint, which keeps them out of the
+// outer caches.
+const unsigned RowBlock = 4;
+
+#define	PREFETCH_SRC(p)	(!bAhead ? (void)0 :		\
+	bNT ? _mm_prefetch((const char*)((p)+nAhead*ELEMENT_WIDTH), _MM_HINT_NTA) :	\
+		  _mm_prefetch((const char*)((p)+nAhead*ELEMENT_WIDTH), _MM_HINT_T0))
+
+template <unsigned R> SIMD_TARGET("sse2") static SIMD_INLINE void
+multsum1(hyperword_t * const *ppDst, const hyperword_t * const *ppSrc,
+		 unsigned nSrc, const unsigned char *pIndex, unsigned nElements,
+		 unsigned nAhead, bool bNT)
+{
+#define	STORE(q,v)	(bNT ? _mm_stream_si128(q, v) : _mm_store_si128(q, v))
+	for (unsigned e = 0; e < nElements; e++) {
+		const bool bAhead = nAhead != 0 && e+nAhead < nElements;
+		__m128i d[R][ELEMENT_WIDTH];
+		for (unsigned r = 0; r < R; r++)
+			d[r][0] = d[r][1] = d[r][2] = d[r][3] = _mm_setzero_si128();
+		for (unsigned j = 0; j < nSrc; j++) {
+			const __m128i *p = (const __m128i*)(ppSrc[j] + e*ELEMENT_WIDTH);
+			__m128i s[ELEMENT_WIDTH];
+			for (unsigned i = 0; i < ELEMENT_WIDTH; i++)
+				s[i] = _mm_load_si128(p+i);
+			PREFETCH_SRC(p);
+			for (unsigned r = 0; r < R; r++)
+				XorMultAdd(pIndex[r*MaxN+j], d[r], s);
+		}
+		for (unsigned r = 0; r < R; r++) {
+			__m128i *q = (__m128i*)(ppDst[r] + e*ELEMENT_WIDTH);
+			STORE(q+0, d[r][0]);
+			STORE(q+1, d[r][1]);
+			STORE(q+2, d[r][2]);
+			STORE(q+3, d[r][3]);
+		}
+	}
+#undef	STORE
+}
+
+SIMD_TARGET("sse2") void
+SSE2_multsum(hyperword_t * const *ppDst, unsigned nDst,
+			 const hyperword_t * const *ppSrc, unsigned nSrc,
+			 const unsigned char *pIndex, unsigned nElements, bool bNT)
+{
+	const unsigned nAhead = PrefetchDistance/sizeof(Element);
+	for (unsigned r = 0; r < nDst; r += RowBlock) {
+		switch (nDst-r < RowBlock ? nDst-r : RowBlock) {
+		case 1: multsum1<1>( ppDst+r, ppSrc, nSrc, pIndex+r*MaxN, nElements, nAhead, bNT); break;
+		case 2: multsum1<2>( ppDst+r, ppSrc, nSrc, pIndex+r*MaxN, nElements, nAhead, bNT); break;
+		case 3: multsum1<3>( ppDst+r, ppSrc, nSrc, pIndex+r*MaxN, nElements, nAhead, bNT); break;
+		case 4: multsum1<4>( ppDst+r, ppSrc, nSrc, pIndex+r*MaxN, nElements, nAhead, bNT); break;
+		}
+	}
+	if (bNT)
+		_mm_sfence();		// order the streaming stores before later stores
+}
+
+// As AVX2_multadd(), hyperword i of two adjacent Elements shares a ymm register.
+// Shared by the AVX2 and AVX-512 methods.
+template <unsigned R> SIMD_TARGET("avx2") static SIMD_INLINE void
+multsum2(hyperword_t * const *ppDst, const hyperword_t * const *ppSrc,
+		 unsigned nSrc, const unsigned char *pIndex, unsigned nElements,
+		 unsigned nAhead, bool bNT)
+{
+#define	LOAD2(p,i)	_mm256_inserti128_si256(_mm256_castsi128_si256(	\
+						_mm_load_si128((p)+(i))), _mm_load_si128((p)+ELEMENT_WIDTH+(i)), 1)
+#define	STORE(q,v)	(bNT ? _mm_stream_si128(q, v) : _mm_store_si128(q, v))
+#define	STORE2(q,i,v)	(STORE((q)+(i), _mm256_castsi256_si128(v)),	\
+						 STORE((q)+ELEMENT_WIDTH+(i), _mm256_extracti128_si256(v, 1)))
+	const unsigned nPairs = nElements>>1;
+	for (unsigned e = 0; e < 2*nPairs; e += 2) {
+		const bool bAhead = nAhead != 0 && e+nAhead+1 < nElements;
+		__m256i d[R][ELEMENT_WIDTH];
+		for (unsigned r = 0; r < R; r++)
+			d[r][0] = d[r][1] = d[r][2] = d[r][3] = _mm256_setzero_si256();
+		for (unsigned j = 0; j < nSrc; j++) {
+			const __m128i *p = (const __m128i*)(ppSrc[j] + e*ELEMENT_WIDTH);
+			__m256i s[ELEMENT_WIDTH];
+			for (unsigned i = 0; i < ELEMENT_WIDTH; i++)
+				s[i] = LOAD2(p, i);
+			PREFETCH_SRC(p);
+			PREFETCH_SRC(p+ELEMENT_WIDTH);
+			for (unsigned r = 0; r < R; r++)
+				XorMultAdd(pIndex[r*MaxN+j], d[r], s);
+		}
+		for (unsigned r = 0; r < R; r++) {
+			__m128i *q = (__m128i*)(ppDst[r] + e*ELEMENT_WIDTH);
+			STORE2(q, 0, d[r][0]);
+			STORE2(q, 1, d[r][1]);
+			STORE2(q, 2, d[r][2]);
+			STORE2(q, 3, d[r][3]);
+		}
+	}
+#undef	LOAD2
+#undef	STORE2
+#undef	STORE
+	_mm256_zeroupper();
+	if (nElements & 1) {		// an odd trailing Element
+		const unsigned offset = 2*nPairs*ELEMENT_WIDTH;
+		hyperword_t *pDsts[R];
+		const hyperword_t *pSrcs[MaxN];
+		for (unsigned r = 0; r < R; r++)
+			pDsts[r] = ppDst[r] + offset;
+		for (unsigned j = 0; j < nSrc; j++)
+			pSrcs[j] = ppSrc[j] + offset;
+		multsum1<R>( pDsts, pSrcs, nSrc, pIndex, 1, nAhead, bNT);
+	}
+}
+
+SIMD_TARGET("avx2") void
+AVX2_multsum(hyperword_t * const *ppDst, unsigned nDst,
+			 const hyperword_t * const *ppSrc, unsigned nSrc,
+			 const unsigned char *pIndex, unsigned nElements, bool bNT)
+{
+	const unsigned nAhead = PrefetchDistance/sizeof(Element);
+	for (unsigned r = 0; r < nDst; r += RowBlock) {
+		switch (nDst-r < RowBlock ? nDst-r : RowBlock) {
+		case 1: multsum2<1>( ppDst+r, ppSrc, nSrc, pIndex+r*MaxN, nElements, nAhead, bNT); break;
+		case 2: multsum2<2>( ppDst+r, ppSrc, nSrc, pIndex+r*MaxN, nElements, nAhead, bNT); break;
+		case 3: multsum2<3>( ppDst+r, ppSrc, nSrc, pIndex+r*MaxN, nElements, nAhead, bNT); break;
+		case 4: multsum2<4>( ppDst+r, ppSrc, nSrc, pIndex+r*MaxN, nElements, nAhead, bNT); break;
+		}
+	}
+	if (bNT)
+		_mm_sfence();		// order the streaming stores before later stores
+}
+
+// The diagonal scheme of AVX512_multadd() does not pay here: its rotations
+// and the opmask loads for every source compete for the one shuffle port.
+// Instead the AVX2 code is compiled for AVX-512VL, where the compiler folds
+// pairs of XORs into one VPTERNLOG and the 32 ymm registers hold the
+// accumulators of all RowBlock destinations.
+SIMD_TARGET("avx2,avx512f,avx512vl") void
+AVX512_multsum(hyperword_t * const *ppDst, unsigned nDst,
+			   const hyperword_t * const *ppSrc, unsigned nSrc,
+			   const unsigned char *pIndex, unsigned nElements, bool bNT)
+{
+	const unsigned nAhead = PrefetchDistance/sizeof(Element);
+	for (unsigned r = 0; r < nDst; r += RowBlock) {
+		switch (nDst-r < RowBlock ? nDst-r : RowBlock) {
+		case 1: multsum2<1>( ppDst+r, ppSrc, nSrc, pIndex+r*MaxN, nElements, nAhead, bNT); break;
+		case 2: multsum2<2>( ppDst+r, ppSrc, nSrc, pIndex+r*MaxN, nElements, nAhead, bNT); break;
+		case 3: multsum2<3>( ppDst+r, ppSrc, nSrc, pIndex+r*MaxN, nElements, nAhead, bNT); break;
+		case 4: multsum2<4>( ppDst+r, ppSrc, nSrc, pIndex+r*MaxN, nElements, nAhead, bNT); break;
+		}
+	}
+	if (bNT)
+		_mm_sfence();		// order the streaming stores before later stores
+}
+#undef	PREFETCH_SRC
+#endif	// SIMD_INTRINSICS
+
 // Dump out the operations described by the 4x4 GF(2) multiplication matrices as code.
 void
 GF2Mul::dump()
@@ -1224,10 +1990,27 @@ GF2Mul::dump()
 #define GCC_MMX
 //#define MSC_SSE2
 //#define GCC_SSE2
+//#define GCC_AVX2
+//#define AVX512_MASKS
 
 	using namespace std;
 	matrix<gf2> mop;
 	cout << "** Begin GF2Mul::dump() **" << endl;
+#ifdef	AVX512_MASKS
+	for (unsigned int v = 0; v < gfQ::order; v++) {
+		mop = multOp(gfQ(v));
+		cout << "	{";
+		for (unsigned s = 0; s < mop.cols(); s++) {
+			unsigned mask = 0;
+			for (unsigned i = 0; i < mop.rows(); i++)
+				if (mop(i,(i+s)%mop.cols()).regular() == 1)
+					mask |= 3<<(2*i);
+			cout << (s ? ", " : " ") << "0x" << hex << uppercase
+				 << (mask>>4) << (mask&0xF) << nouppercase << dec;
+		}
+		cout << " },	// " << v << endl;
+	}
+#else	// !AVX512_MASKS
 	for (unsigned int v = 0; v < gfQ::order; v++) {
 		mop = multOp(gfQ(v));
 		cout << "	case " << v << ":" << endl;
@@ -1253,6 +2036,9 @@ GF2Mul::dump()
 #endif
 #ifdef GCC_SSE2
 		cout << "		\"pxor	%%xmm" << j+4 << ",%%xmm" << i << "\\n\\t\"" << endl;
+#endif
+#ifdef GCC_AVX2
+		cout << "		\"vpxor	%%ymm" << j+4 << ",%%ymm" << i << ",%%ymm" << i << "\\n\\t\"" << endl;
 #endif
 			}
 #ifndef	C_STD
@@ -1260,6 +2046,7 @@ GF2Mul::dump()
 #endif
 		cout << "		break;" << endl;
 	}
+#endif	// AVX512_MASKS
 	cout << "** End GF2Mul::dump() **" << endl;
 #endif
 }
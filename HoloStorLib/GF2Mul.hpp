@@ -49,6 +49,17 @@
 
 namespace HoloStor {
 
+// The kernels of one method (a CpuTypes value), resolved once per Session by
+// GF2Mul::Kernels() rather than on every call.
+struct GF2Kernels {
+	unsigned method;
+	void (*multadd)(hyperword_t *pDst, const hyperword_t *pSrc,
+		unsigned nElements, unsigned nIndex);
+	void (*multsum)(hyperword_t * const *ppDst, unsigned nDst,			// NULL
+		const hyperword_t * const *ppSrc, unsigned nSrc,				// if the
+		const unsigned char *pIndex, unsigned nElements, bool bNT);	// method has none
+};
+
 class GF2Mul {
 	typedef gfp<2> gf2;
 private:
@@ -69,7 +80,17 @@ public:
 		return *this;
 	}
 	//
-	void gf2multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements = 1) const;
+	void gf2multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements,
+		const GF2Kernels& kernels) const;
+	void gf2multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements = 1) const {
+		gf2multadd(pDst, pSrc, nElements, Kernels(CpuType));
+	}
+	static void gf2multsum(hyperword_t * const *ppDst, unsigned nDst,
+		const hyperword_t * const *ppSrc, unsigned nSrc,
+		const GF2Mul *pMul, unsigned nElements, const GF2Kernels& kernels,
+		bool bNonTemporal = false);
+	//
+	static const GF2Kernels& Kernels(unsigned method);
 	//
 	static void dump();
 	//
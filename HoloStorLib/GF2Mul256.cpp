@@ -0,0 +1,309 @@
+/*  Copyright (C) 2003-2011 Thomas P. Scott and Myron Zimmerman
+
+    Thomas P. Scott <tpscott@alum.mit.edu>
+    Myron Zimmerman <MyronZimmerman@alum.mit.edu>
+
+    This file is part of HoloStor.
+
+    HoloStor is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3 of the License.
+
+    HoloStor is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with HoloStor.  If not, see <http://www.gnu.org/licenses/>.
+
+    Parts of HoloStor are protected by US Patent 7,472,334, the use of
+    which is granted in accordance to the terms of GPLv3.
+*/
+/*****************************************************************************
+
+ Module Name:
+	GF2Mul256.cpp
+
+ Abstract:
+	Implementation of class GF2Mul256.
+
+	Multiplication by v is the 8x8 matrix over GF(2) whose column j is v*2**j:
+	bit plane i of the product is the XOR of those bit planes j of the
+	source where the matrix has a 1.  The SIMD methods use the XOR schedules
+	of XorSchedule.hpp for each of the 256 multipliers, on registers that
+	hold a part of every bit plane (16, 32 or 64 bytes of each), so every
+	method works at its full register width on the same layout.
+
+--****************************************************************************/
+
+#include "GF2Mul256.hpp"
+
+#include <string.h>		// for ANSI memset(), memcpy()
+#include <assert.h>		// for ANSI assert()
+#ifdef	SIMD_INTRINSICS
+#include <immintrin.h>
+#include "XorSchedule.hpp"
+#endif
+
+namespace HoloStor {
+
+const unsigned BitPlanes = GF2Mul256::BitPlanes;
+
+// Rows[v][i] has bit j on if bit plane j of the source is XOR-ed into bit
+// plane i of the destination, when multiplying by v.
+static unsigned char Rows[256][BitPlanes];
+static bool bRowsInit = false;
+
+// Fill in Rows[] (idempotent, so a race between sessions is harmless).
+static void
+RowsInit()
+{
+	for (unsigned v = 0; v < 256; v++) {
+		::memset(Rows[v], 0, sizeof(Rows[v]));
+		for (unsigned j = 0; j < BitPlanes; j++) {
+			const unsigned u = (GF256(v) * GF256(1u<<j)).regular();
+			for (unsigned i = 0; i < BitPlanes; i++)
+				if (u>>i & 1)
+					Rows[v][i] |= 1u<<j;
+		}
+	}
+	bRowsInit = true;
+}
+
+// Multiply the slices of nElements Elements (a multiple of BitPlanes) at
+// pSrc by v and add them to those at pDst.
+static void
+STD_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, unsigned nValue)
+{
+	if (nValue == 0)
+		return;
+	const unsigned char *row = Rows[nValue];
+	const unsigned nWords = sizeof(Element)/sizeof(UINT32);
+	for (unsigned e = 0; e+BitPlanes <= nElements; e += BitPlanes) {
+		UINT32 *d = (UINT32*)((Element*)pDst + e);
+		const UINT32 *s = (const UINT32*)((const Element*)pSrc + e);
+		for (unsigned i = 0; i < BitPlanes; i++)
+			for (unsigned j = 0; j < BitPlanes; j++) {
+				if ((row[i]>>j & 1) == 0)
+					continue;
+				for (unsigned w = 0; w < nWords; w++)
+					d[i*nWords+w] ^= s[j*nWords+w];
+			}
+	}
+}
+
+#if defined(SIMD_INTRINSICS) && HYPERWORD_SIZE == 4
+// Each method has a loop per multiplier (V, a template parameter) so that
+// the schedule is straight-line code, as in GF2Mul.  Register k of bit plane
+// i is at (T*)(Element i of the slice) + k.  The blocks are only 16-byte
+// aligned, so the AVX2 and AVX-512 loads and stores are unaligned.
+template <unsigned V> SIMD_TARGET("sse2") static void
+multadd16(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements)
+{
+	for (unsigned e = 0; e+BitPlanes <= nElements; e += BitPlanes)
+		for (unsigned k = 0; k < ELEMENT_WIDTH; k++) {
+			__m128i *q = (__m128i*)(pDst + e*ELEMENT_WIDTH) + k;
+			const __m128i *p = (const __m128i*)(pSrc + e*ELEMENT_WIDTH) + k;
+			__m128i d[BitPlanes], s[BitPlanes];
+			for (unsigned i = 0; i < BitPlanes; i++) {
+				d[i] = _mm_load_si128(q + i*ELEMENT_WIDTH);
+				s[i] = _mm_load_si128(p + i*ELEMENT_WIDTH);
+			}
+			XorMultAdd<V, BitPlanes>(d, s);
+			for (unsigned i = 0; i < BitPlanes; i++)
+				_mm_store_si128(q + i*ELEMENT_WIDTH, d[i]);
+		}
+}
+
+// SSE2_Multadd[v] multiply-adds by v.
+static void (* const SSE2_Multadd[256])(hyperword_t *, const hyperword_t *, unsigned) = {
+#define	CASE(V)	multadd16<V>,
+	XOR_SCHEDULE_CASES256(CASE)
+#undef	CASE
+};
+
+SIMD_TARGET("sse2") static void
+SSE2_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, unsigned nValue)
+{
+	if (nValue == 0)
+		return;
+	SSE2_Multadd[nValue]( pDst, pSrc, nElements);
+}
+
+template <unsigned V> SIMD_TARGET("avx2") static void
+multadd32(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements)
+{
+	for (unsigned e = 0; e+BitPlanes <= nElements; e += BitPlanes)
+		for (unsigned k = 0; k < 2; k++) {
+			__m256i *q = (__m256i*)(pDst + e*ELEMENT_WIDTH) + k;
+			const __m256i *p = (const __m256i*)(pSrc + e*ELEMENT_WIDTH) + k;
+			__m256i d[BitPlanes], s[BitPlanes];
+			for (unsigned i = 0; i < BitPlanes; i++) {
+				d[i] = _mm256_loadu_si256(q + 2*i);
+				s[i] = _mm256_loadu_si256(p + 2*i);
+			}
+			XorMultAdd<V, BitPlanes>(d, s);
+			for (unsigned i = 0; i < BitPlanes; i++)
+				_mm256_storeu_si256(q + 2*i, d[i]);
+		}
+}
+
+// AVX2_Multadd[v] multiply-adds by v.
+static void (* const AVX2_Multadd[256])(hyperword_t *, const hyperword_t *, unsigned) = {
+#define	CASE(V)	multadd32<V>,
+	XOR_SCHEDULE_CASES256(CASE)
+#undef	CASE
+};
+
+SIMD_TARGET("avx2") static void
+AVX2_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, unsigned nValue)
+{
+	if (nValue == 0)
+		return;
+	AVX2_Multadd[nValue]( pDst, pSrc, nElements);
+	_mm256_zeroupper();
+}
+
+// A whole bit plane per register, where the compiler folds pairs of XORs
+// into one VPTERNLOG.
+template <unsigned V> SIMD_TARGET("avx512f") static void
+multadd64(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements)
+{
+	for (unsigned e = 0; e+BitPlanes <= nElements; e += BitPlanes) {
+		__m512i *q = (__m512i*)(pDst + e*ELEMENT_WIDTH);
+		const __m512i *p = (const __m512i*)(pSrc + e*ELEMENT_WIDTH);
+		__m512i d[BitPlanes], s[BitPlanes];
+		for (unsigned i = 0; i < BitPlanes; i++) {
+			d[i] = _mm512_loadu_si512(q + i);
+			s[i] = _mm512_loadu_si512(p + i);
+		}
+		XorMultAdd<V, BitPlanes>(d, s);
+		for (unsigned i = 0; i < BitPlanes; i++)
+			_mm512_storeu_si512(q + i, d[i]);
+	}
+}
+
+// AVX512_Multadd[v] multiply-adds by v.
+static void (* const AVX512_Multadd[256])(hyperword_t *, const hyperword_t *, unsigned) = {
+#define	CASE(V)	multadd64<V>,
+	XOR_SCHEDULE_CASES256(CASE)
+#undef	CASE
+};
+
+SIMD_TARGET("avx512f") static void
+AVX512_multadd(hyperword_t *pDst, const hyperword_t *pSrc, unsigned nElements, unsigned nValue)
+{
+	if (nValue == 0)
+		return;
+	AVX512_Multadd[nValue]( pDst, pSrc, nElements);
+	_mm256_zeroupper();
+}
+
+// The fused kernel cannot hold the destinations in registers across the
+// sources as GF2Mul does: the 256 schedules for each of them would be
+// megabytes of code.  Instead the destinations are accumulated a chunk of
+// ChunkElements at a time in a buffer on the stack (which stays in the L1
+// cache), with one multadd() per destination and source, and then copied
+// out - with streaming stores if bNT is set.  Each chunk of a source is
+// still read from memory once for all the destinations, and the next
+// PrefetchDistance bytes of it are prefetched meanwhile.
+const unsigned RowBlock = 4;
+const unsigned ChunkElements = 4*BitPlanes;
+
+SIMD_TARGET("sse2") static void
+multsumChunked(void (*multadd)(hyperword_t *pDst, const hyperword_t *pSrc,
+								unsigned nElements, unsigned nValue),
+			   hyperword_t * const *ppDst, unsigned nDst,
+			   const hyperword_t * const *ppSrc, unsigned nSrc,
+			   const unsigned char *pValue, unsigned nElements, bool bNT)
+{
+	const unsigned nWords = ChunkElements*ELEMENT_WIDTH;	// __m128i per chunk
+	__m128i acc[RowBlock][nWords];
+	for (unsigned r0 = 0; r0 < nDst; r0 += RowBlock) {
+		const unsigned R = nDst-r0 < RowBlock ? nDst-r0 : RowBlock;
+		for (unsigned e = 0; e < nElements; e += ChunkElements) {
+			const unsigned n = nElements-e < ChunkElements ? nElements-e : ChunkElements;
+			const unsigned offset = e*ELEMENT_WIDTH;
+			::memset(acc, 0, sizeof(acc[0])*R);
+			for (unsigned j = 0; j < nSrc; j++) {
+				const char *p = (const char*)(ppSrc[j] + offset);
+				for (unsigned r = 0; r < R; r++)
+					multadd((hyperword_t*)acc[r], ppSrc[j] + offset, n,
+							pValue[(r0+r)*nSrc+j]);
+				// Prefetch up to PrefetchDistance bytes beyond this chunk.
+				const unsigned nLeft = (nElements-e-n)*sizeof(Element);
+				const unsigned nAhead = PrefetchDistance < nLeft ? PrefetchDistance : nLeft;
+				for (unsigned b = 0; b < nAhead; b += sizeof(Element))
+					if (bNT)
+						_mm_prefetch(p + n*sizeof(Element) + b, _MM_HINT_NTA);
+					else
+						_mm_prefetch(p + n*sizeof(Element) + b, _MM_HINT_T0);
+			}
+			for (unsigned r = 0; r < R; r++) {
+				__m128i *q = (__m128i*)(ppDst[r0+r] + offset);
+				for (unsigned w = 0; w < n*ELEMENT_WIDTH; w++)
+					if (bNT)
+						_mm_stream_si128(q+w, acc[r][w]);
+					else
+						_mm_store_si128(q+w, acc[r][w]);
+			}
+		}
+	}
+	if (bNT)
+		_mm_sfence();		// order the streaming stores before later stores
+}
+
+static void
+SSE2_multsum(hyperword_t * const *ppDst, unsigned nDst,
+			 const hyperword_t * const *ppSrc, unsigned nSrc,
+			 const unsigned char *pValue, unsigned nElements, bool bNT)
+{
+	multsumChunked(SSE2_multadd, ppDst, nDst, ppSrc, nSrc, pValue, nElements, bNT);
+}
+
+static void
+AVX2_multsum(hyperword_t * const *ppDst, unsigned nDst,
+			 const hyperword_t * const *ppSrc, unsigned nSrc,
+			 const unsigned char *pValue, unsigned nElements, bool bNT)
+{
+	multsumChunked(AVX2_multadd, ppDst, nDst, ppSrc, nSrc, pValue, nElements, bNT);
+}
+
+static void
+AVX512_multsum(hyperword_t * const *ppDst, unsigned nDst,
+			   const hyperword_t * const *ppSrc, unsigned nSrc,
+			   const unsigned char *pValue, unsigned nElements, bool bNT)
+{
+	multsumChunked(AVX512_multadd, ppDst, nDst, ppSrc, nSrc, pValue, nElements, bNT);
+}
+#endif	// SIMD_INTRINSICS && HYPERWORD_SIZE == 4
+
+// The kernels of each method, indexed by CpuTypes value.  There is no MMX
+// kernel, and builds without intrinsics have only the STD kernel.
+static const GF256Kernels
+MethodKernels[CPU_AVX512+1] = {
+	{ CPU_STD,		STD_multadd,	0 },
+	{ CPU_MMX,		STD_multadd,	0 },
+#if defined(SIMD_INTRINSICS) && HYPERWORD_SIZE == 4
+	{ CPU_SSE2,		SSE2_multadd,	SSE2_multsum },
+	{ CPU_AVX2,		AVX2_multadd,	AVX2_multsum },
+	{ CPU_AVX512,	AVX512_multadd,	AVX512_multsum },
+#else
+	{ CPU_SSE2,		STD_multadd,	0 },
+	{ CPU_AVX2,		STD_multadd,	0 },
+	{ CPU_AVX512,	STD_multadd,	0 },
+#endif
+};
+
+const GF256Kernels&
+GF2Mul256::Kernels(unsigned method)
+{
+	if (!bRowsInit)
+		RowsInit();
+	if (method > CPU_AVX512)		// i.e. CPU_UNKNOWN
+		method = CPU_STD;
+	return MethodKernels[method];
+}
+
+} // namespace HoloStor
@@ -0,0 +1,59 @@
+/*  Copyright (C) 2003-2011 Thomas P. Scott and Myron Zimmerman
+
+    Thomas P. Scott <tpscott@alum.mit.edu>
+    Myron Zimmerman <MyronZimmerman@alum.mit.edu>
+
+    This file is part of HoloStor.
+
+    HoloStor is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3 of the License.
+
+    HoloStor is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with HoloStor.  If not, see <http://www.gnu.org/licenses/>.
+
+    Parts of HoloStor are protected by US Patent 7,472,334, the use of
+    which is granted in accordance to the terms of GPLv3.
+*/
+/*****************************************************************************
+
+ Module Name:
+	GF2Mul256.hpp
+
+ Abstract:
+	Interface to class GF2Mul256.
+
+	This class provides the kernels of HOLOSTOR_FLAG_GF256 sessions that
+	also have HOLOSTOR_FLAG_BITSLICED.  As in GF2Mul, multiplication by a
+	scalar is done with operations in GF(2) on whole hyperwords, here on
+	the 8 bit planes of a slice: bit i of the 8*sizeof(Element) symbols of
+	a slice is Element i of the slice.  The multipliers are those of class
+	GF256Mul, so a CodingMatrix serves both layouts.
+
+--****************************************************************************/
+#ifndef	HOLOSTOR_HOLOSTORLIB_GF2MUL256_HPP_
+#define HOLOSTOR_HOLOSTORLIB_GF2MUL256_HPP_
+
+#include "HoloStor.h"
+#include "Config.h"
+#include "Types.h"
+//
+#include "GF256Mul.hpp"
+
+namespace HoloStor {
+
+class GF2Mul256 {
+public:
+	enum { BitPlanes = 8 };				// Elements per slice
+	//
+	static unsigned SliceSize() { return BitPlanes*sizeof(Element); }
+	static const GF256Kernels& Kernels(unsigned method);
+};
+
+} // namespace HoloStor
+#endif	// HOLOSTOR_HOLOSTORLIB_GF2MUL256_HPP_
@@ -32,6 +32,7 @@
 # Compile options
 #	NDEBUG - disables ANSI assert(3)
 #	_DEBUG - enables HoloStor debug #ifdef's (using std::cout)
+#	__KERNEL__ - Linux kernel target (no worker threads or eventfds)
 #
 SHELL = /bin/sh
 
@@ -47,15 +48,20 @@ MOD = HoloStorMod.o
 CORE = \
 	Tuple.o \
 	GF16.o \
+	GF256.o \
 	CombinIter.o \
 	MathUtils.o \
 	Session.o \
 	main.o \
 	IDA.o \
 	GF2Mul.o \
+	GF256Mul.o \
+	GF2Mul256.o \
 	CodingTable.o \
 	SessionTable.o \
-	CodingMatrix.o
+	CodingMatrix.o \
+	Queue.o \
+	Workers.o
 
 # Core plus porting layer.
 OBJECTS = $(CORE) \
@@ -78,7 +84,7 @@ endif
 # Target-specific variables
 kernel: OPT= -Os
 kernel: GFLAG= -g
-kernel: CFG += -DNDEBUG
+kernel: CFG += -DNDEBUG -D__KERNEL__
 # Common -f and -m compile options.
 kernel: CFG += -fconserve-stack -fno-asynchronous-unwind-tables -fno-common \
 	-fno-delete-null-pointer-checks -fomit-frame-pointer \
@@ -39,86 +39,402 @@
 
 namespace HoloStor {
 
-bool 
-IDA::IDAInit(unsigned n, unsigned k)
+// CauchySearch chooses the ECC rows of an encoding matrix for the fewest XORs.
+//
+// The ECC rows are a parity row and nRows rows of the Cauchy matrix 1/(x[i] +
+// y[j]), for distinct values x[i] and y[j] of the field, with row i scaled by
+// a[i] and column j by b[j] (the parity row being b[j]).  Any such choice makes
+// every n rows of the encoding matrix independent.  The cost of a choice is the
+// weight (see Weight()) of the ECC rows plus that of the rows which recover a
+// single lost Data block d from the parity block, the most common decode:
+// b[j]/b[d] for each other Data block j and 1/b[d] for the parity block.
+//
+// The search starts from the matrix of EncodeMatrix() and takes every move that
+// lowers the cost: replacing an x or a y by an unused value, exchanging an x with
+// a y, or changing a b[j], the best a[i] being found for each.  The search is
+// deterministic, as it must be: the matrix defines the contents of the ECC
+// blocks.  Its work is bounded by MaxWork weight terms, which cuts short the
+// search of wide GF(2**8) stripes.
+template <class gf>
+class CauchySearch {
+	enum { MaxOrder = 256, MaxWork = 1u<<24 };
+	unsigned m_n;							// Data blocks
+	unsigned m_nRows;						// Cauchy rows
+	unsigned m_work;						// weight terms evaluated so far
+	unsigned char m_weight[MaxOrder];		// Weight() of each value
+	unsigned char m_x[MaxOrder], m_y[MaxOrder];
+	unsigned char m_a[MaxOrder], m_b[MaxOrder];
+	gf m_c[MaxOrder];						// a Cauchy row before its scaling
+	//
+	unsigned _RowCost(unsigned i, unsigned char& a);
+	unsigned _Cost();
+	unsigned char *_Find(unsigned v);
+public:
+	CauchySearch(unsigned n, unsigned nRows);
+	void Search();
+	void Fill(matrix<gf>& A);
+	static unsigned Weight(const gf& v);
+	//
+	NEWOPERATORS
+};
+
+// The weight of v, the ones of multiplication by v as a matrix over GF(2).  It is
+// the number of XORs to multiply-add by v in a bit-sliced layout (1 takes the
+// fewest, one per bit).
+template <class gf> unsigned
+CauchySearch<gf>::Weight(const gf& v)
+{
+	unsigned w = 0;
+	for (unsigned j = 0; j < gf::degree; j++)
+		for (unsigned u = (v * gf(1u<<j)).regular(); u != 0; u >>= 1)
+			w += u & 1;
+	return w;
+}
+
+template <class gf>
+CauchySearch<gf>::CauchySearch(unsigned n, unsigned nRows)
+	: m_n(n), m_nRows(nRows), m_work(0)
+{
+	assert(gf::order <= MaxOrder && n + nRows <= gf::order);
+	for (unsigned v = 0; v < gf::order; v++)
+		m_weight[v] = Weight(gf(v));
+	for (unsigned i = 0; i < nRows; i++) {
+		m_x[i] = i;							// as EncodeMatrix()
+		m_a[i] = 1;
+	}
+	for (unsigned j = 0; j < n; j++) {
+		m_y[j] = j + nRows;
+		m_b[j] = 1;
+	}
+}
+
+// The weight of Cauchy row i with its best scale, returned in a.
+template <class gf> unsigned
+CauchySearch<gf>::_RowCost(unsigned i, unsigned char& a)
+{
+	for (unsigned j = 0; j < m_n; j++)
+		m_c[j] = gf(m_b[j]) / (gf(m_x[i]) + gf(m_y[j]));
+	unsigned best = ~0u;
+	for (unsigned s = 1; s < gf::order; s++) {
+		unsigned w = 0;
+		for (unsigned j = 0; j < m_n && w < best; j++)
+			w += m_weight[(gf(s) * m_c[j]).regular()];
+		if (w < best) {
+			best = w;
+			a = s;
+		}
+	}
+	return best;
+}
+
+// The cost of the current x, y and b (and the best a, which it sets).
+template <class gf> unsigned
+CauchySearch<gf>::_Cost()
+{
+	m_work += m_nRows * (gf::order - 1) * m_n + m_n * m_n;
+	unsigned cost = 0;
+	for (unsigned d = 0; d < m_n; d++) {
+		cost += m_weight[m_b[d]];							// parity row
+		cost += m_weight[(gf(1) / gf(m_b[d])).regular()];	// decode of Data block d
+		for (unsigned j = 0; j < m_n; j++)
+			if (j != d)
+				cost += m_weight[(gf(m_b[j]) / gf(m_b[d])).regular()];
+	}
+	for (unsigned i = 0; i < m_nRows; i++)
+		cost += _RowCost(i, m_a[i]);
+	return cost;
+}
+
+// The x or y that has value v (NULL if none).
+template <class gf> unsigned char *
+CauchySearch<gf>::_Find(unsigned v)
+{
+	for (unsigned i = 0; i < m_nRows; i++)
+		if (m_x[i] == v)
+			return &m_x[i];
+	for (unsigned j = 0; j < m_n; j++)
+		if (m_y[j] == v)
+			return &m_y[j];
+	return NULL;
+}
+
+template <class gf> void
+CauchySearch<gf>::Search()
+{
+	unsigned cost = _Cost();
+	for (bool bImproved = true; bImproved; ) {
+		bImproved = false;
+		// Move the x and y values.
+		for (unsigned p = 0; p < m_nRows + m_n; p++) {
+			const bool bX = p < m_nRows;
+			unsigned char *pU = bX ? &m_x[p] : &m_y[p - m_nRows];
+			for (unsigned v = 0; v < gf::order && m_work < MaxWork; v++) {
+				unsigned char *pV = _Find(v);
+				if (pV == pU || (pV != NULL && (pV >= m_x && pV < m_x + m_nRows) == bX))
+					continue;						// itself or on the same side
+				const unsigned char u = *pU;
+				*pU = v;
+				if (pV != NULL)
+					*pV = u;						// exchange an x with a y
+				const unsigned c = _Cost();
+				if (c < cost) {
+					cost = c;
+					bImproved = true;
+					continue;
+				}
+				*pU = u;
+				if (pV != NULL)
+					*pV = v;
+			}
+		}
+		// Scale the columns.
+		for (unsigned j = 0; j < m_n; j++) {
+			unsigned char best = m_b[j];
+			for (unsigned v = 1; v < gf::order && m_work < MaxWork; v++) {
+				if (v == best)
+					continue;
+				m_b[j] = v;
+				const unsigned c = _Cost();
+				if (c < cost) {
+					cost = c;
+					best = v;
+					bImproved = true;
+				}
+			}
+			m_b[j] = best;
+		}
+	}
+}
+
+// Fill in the MxN encoding matrix A.
+template <class gf> void
+CauchySearch<gf>::Fill(matrix<gf>& A)
+{
+	(void)_Cost();								// the a of the final choice
+	for (unsigned i = 0; i < A.rows(); i++) {
+		for (unsigned j = 0; j < m_n; j++) {
+			if (i < m_n)
+				A(i,j) = (i==j)?1:0;			// systematic
+			else if (i == m_n)
+				A(i,j) = m_b[j];				// parity
+			else {								// Cauchy rows
+				const unsigned r = i - m_n - 1;
+				gf z = gf(m_a[r]) * gf(m_b[j]) / (gf(m_x[r]) + gf(m_y[j]));
+				A(i,j) = z;
+			}
+		}
+	}
+}
+
+template <class gf> bool 
+IDAT<gf>::IDAInit(unsigned n, unsigned k, bool bMinXor)
 {
-	if (n + k > gfQ::order + 1)
+	if (n + k > gf::order + 1)
 		return false;
-	m_mEncode = EncodeMatrix(n+k, n);	// this can be nil if out of memory
+	m_mEncode = EncodeMatrix(n+k, n, bMinXor);	// this can be nil if out of memory
+	return true;
+}
+
+//
+// Build the matrix that recovers the faults (row i for block faults(i)) from
+// the valid Data rows and the e ECC rows R, one per invalid Data block D[u].
+//
+// Only the e x e submatrix P = E(R,D) of the encoding matrix E need be
+// inverted:  with y the rows used, the Data blocks of D are Q*(y(R) +
+// E(R,S)*y(S)) where Q is the inverse of P and S are the valid Data blocks.  An
+// invalid ECC block r is E(r,S)*y(S) + E(r,D) times the Data blocks of D.  This
+// is O(k**3 + k*k*n) operations, rather than the O(n**3) of inverting the n
+// rows.
+//
+template <class gf> bool
+IDAT<gf>::_Coding(Tuple faults, const UCHAR *D, unsigned e, const UCHAR *R,
+				  matrix<gf>& mCoding) const
+{
+	const unsigned n = m_mEncode.cols();
+	UCHAR col[MaxBlocks];				// column of a valid Data block
+	for (unsigned j = 0, d = 0; j < n; j++) {
+		if (d < e && D[d] == j)
+			d++;
+		else
+			col[j] = j - d;
+	}
+
+	// X(u,) recovers Data block D[u] from the rows used.
+	matrix<gf> X;
+	if (e > 0) {
+		matrix<gf> P(e,e), Q;
+		if ( P.isNil() || !X.setDim(e,n) )
+			return false;				// out of memory
+		for (unsigned t = 0; t < e; t++)
+			for (unsigned u = 0; u < e; u++)
+				P(t,u) = m_mEncode(R[t],D[u]);
+		if ( !P.inverse(Q) )
+			return false;	// logic error (shouldn't happen) or out of memory
+		for (unsigned u = 0; u < e; u++) {
+			for (unsigned t = 0; t < e; t++)
+				X(u,n-e+t) = Q(u,t);
+			for (unsigned j = 0, d = 0; j < n; j++) {
+				if (d < e && D[d] == j) {
+					d++;
+					continue;
+				}
+				gf z = 0;
+				for (unsigned t = 0; t < e; t++)
+					z += Q(u,t) * m_mEncode(R[t],j);
+				X(u,col[j]) = z;
+			}
+		}
+	}
+	if ( !mCoding.setDim(faults.getDim(), n) )
+		return false;				// out of memory
+	for (unsigned i = 0; i < faults.getDim(); i++) {
+		const unsigned f = faults(i);
+		if (f < n) {				// a Data block
+			unsigned u = 0;
+			while (D[u] != f)
+				u++;
+			for (unsigned j = 0; j < n; j++)
+				mCoding(i,j) = X(u,j);
+			continue;
+		}
+		for (unsigned j = 0, d = 0; j < n; j++) {	// an ECC block
+			if (d < e && D[d] == j) {
+				d++;
+				continue;
+			}
+			mCoding(i,col[j]) = m_mEncode(f,j);
+		}
+		for (unsigned j = n - e; j < n; j++)
+			mCoding(i,j) = 0;
+		for (unsigned u = 0; u < e; u++) {
+			const gf a = m_mEncode(f,D[u]);
+			for (unsigned j = 0; j < n; j++)
+				mCoding(i,j) += a * X(u,j);
+		}
+	}
 	return true;
 }
 
-bool
-IDA::GenerateCoding(Tuple faults, matrixGFQ_t& mCoding, UCHAR *rowsUsed)
+//
+// Generate the matrix that recovers the faults (row i for block faults(i)) from
+// n valid rows (rowsUsed), those of the cheapest recovery.
+//
+// The rows used are the valid Data rows, each a column of the identity, which
+// cost nothing to recover themselves, followed by e ECC rows, one per invalid
+// Data block.  When more than e ECC blocks are valid, every choice of e of them
+// is tried and the one whose matrix has the least MatrixWeight() is kept: the
+// XORs of the kernels, which skip the zero coefficients and multiply-add by 1
+// (the parity row of the default matrix) with the fewest.  Ties keep the lowest
+// numbered rows.  The choice is a function of the faults alone, as the matrix
+// is built once for them and kept in the CodingTable.  There are at most
+// C(MaxK,MaxK/2) choices, and a single invalid Data block (the most common
+// decode) has at most k.
+//
+template <class gf> bool
+IDAT<gf>::GenerateCoding(Tuple faults, matrix<gf>& mCoding, UCHAR *rowsUsed) const
 {
 	const unsigned n = m_mEncode.cols();
 	const unsigned m = m_mEncode.rows();
-	// Generate the row depricated matrix corresponding to the faults.
-	// The rows are taken from the n lowest numbered valid rows.
-	unsigned iDst, iSrc;
-	matrixGFQ_t B(n,n);
-	if ( B.isNil() || m_mEncode.isNil() )
+	if ( m_mEncode.isNil() )
 		return false;					// out of memory
-	unsigned uInvalidMask = faults.mask();
-	for (iDst = 0, iSrc = 0; iSrc < m; iSrc++, uInvalidMask >>= 1) {
-		if ( uInvalidMask&1 )
+	unsigned iDst = 0;
+	unsigned e = 0;						// invalid Data blocks
+	unsigned v = 0;						// valid ECC blocks
+	UCHAR D[MaxK], V[MaxK], R[MaxK];	// invalid Data blocks, valid ECC rows, rows used
+	for (unsigned iSrc = 0; iSrc < m; iSrc++) {
+		if ( faults.isMember(iSrc) ) {
+			if (iSrc < n) {
+				if (e >= MaxK)
+					return false;		// excessive faults to recover (shouldn't happen)
+				D[e++] = iSrc;
+			}
 			continue;
-		if ( iDst >= n )
-			break;
-		// copy row
-		for (unsigned j = 0; j < n; j++)
-			B(iDst,j) = m_mEncode(iSrc,j);
-		rowsUsed[iDst] = iSrc;			// the identity of rows used
-		iDst++;
+		}
+		if (iSrc < n)
+			rowsUsed[iDst++] = iSrc;	// the identity of rows used
+		else if (v < MaxK)
+			V[v++] = iSrc;
 	}
-	if (iDst < n)
+	if (v < e)
 		return false;		// excessive faults to recover (shouldn't happen)
-	
-	// Compute the inverse, which will recover the data nodes.
-	matrixGFQ_t C;
-	if ( !B.inverse(C) )
-		return false;		// logic error (shouldn't happen) or out of memory
+
+	// Choose R, the combination c of e valid ECC rows (drawn in increasing
+	// lexicographic order) of the cheapest recovery.
+	unsigned c[MaxK];
+	for (unsigned t = 0; t < e; t++)
+		R[t] = V[c[t] = t];
+	if (e > 0 && e < v) {
+		UCHAR Try[MaxK];
+		unsigned nBest = ~0u;
+		matrix<gf> mTry;
+		for (;;) {
+			for (unsigned t = 0; t < e; t++)
+				Try[t] = V[c[t]];
+			if ( !_Coding(faults, D, e, Try, mTry) )
+				return false;			// out of memory
+			const unsigned w = MatrixWeight(mTry);
+			if (w < nBest) {
+				nBest = w;
+				for (unsigned t = 0; t < e; t++)
+					R[t] = Try[t];
+			}
+			int t = e - 1;				// the next combination
+			while (t >= 0 && c[t] == v - e + t)
+				t--;
+			if (t < 0)
+				break;
+			c[t]++;
+			for (unsigned u = t + 1; u < e; u++)
+				c[u] = c[u-1] + 1;
+		}
+	}
+	for (unsigned t = 0; t < e; t++)
+		rowsUsed[iDst++] = R[t];		// the identity of rows used
+	if ( !_Coding(faults, D, e, R, mCoding) )
+		return false;	// logic error (shouldn't happen) or out of memory
 	//
 #ifdef	_DEBUG
-	matrixGFQ_t I = C*B;
-	if ( I.isNil() )
-		return false;		// out of memory
+	// mCoding times the rows used must be the rows of the faults.
 	bool bMatrixOK = true;
-	for (unsigned i = 0; i < I.rows(); i++)
-		for (unsigned j = 0; j < I.cols(); j++)
-			if ( I(i,j).regular() != (i==j ? 1 : 0) )
+	for (unsigned i = 0; i < mCoding.rows(); i++)
+		for (unsigned j = 0; j < n; j++) {
+			gf z = 0;
+			for (unsigned t = 0; t < n; t++)
+				z += mCoding(i,t) * m_mEncode(rowsUsed[t],j);
+			if ( z.regular() != m_mEncode(faults(i),j).regular() )
 				bMatrixOK = false;
+		}
 	if (!bMatrixOK) {
 		std::cerr << "BAD Matrix inversion" << std::endl;
-		B.print("B");
-		C.print("C");
-		I.print("I");
+		faults.print("faults");
+		mCoding.print("mCoding");
 	}
-#endif
-	// Multiply by the m_mEncode to produce a matrix that will recover Data and ECC nodes.
-	mCoding = m_mEncode * C;
-	if ( mCoding.isNil() )
-		return false;				// out of memory
-#ifdef	_DEBUGx						// XXX - silenced until debug verbosity levels added
-	m_mEncode.print("**mEncode**");
-	faults.print("**faults**");
-	C.print("**inverse**");
-	mCoding.print("**coding**");
 #endif
 	return true;
 }
 
 // Return an MxN encoding matrix.  The matrix is systematic with parity and Cauchy
-// elements.
-matrixGFQ_t
-IDA::EncodeMatrix(unsigned m, unsigned n)
+// elements.  If bMinXor, the Cauchy elements are those of CauchySearch.
+template <class gf> matrix<gf>
+IDAT<gf>::EncodeMatrix(unsigned m, unsigned n, bool bMinXor)
 {
-	matrixGFQ_t A(m, n);
+	matrix<gf> A(m, n);
 	if ( A.isNil() )
 		return A;									// out of memory (return nil)
 	const unsigned nCauchyStart = n + 1;			// starting row index of Cauchy rows
 	const unsigned nCauchyRows = m - nCauchyStart;	// number of Cauchy rows
-	assert(n + nCauchyRows <= gfQ::order);
+	assert(n + nCauchyRows <= gf::order);
+	if (bMinXor) {
+		CauchySearch<gf> *pSearch = new CauchySearch<gf>(n, nCauchyRows);
+		if (pSearch == NULL) {
+			A.setNil();
+			return A;								// out of memory (return nil)
+		}
+		pSearch->Search();
+		pSearch->Fill(A);
+		delete pSearch;
+		return A;
+	}
 	for (unsigned i = 0; i < m; i++) {
 		for (unsigned j = 0; j < n; j++) {
 			if (i < n) 
@@ -126,11 +442,11 @@ IDA::EncodeMatrix(unsigned m, unsigned n)
 			else if (i == n)
 				A(i,j) = 1;				// parity
 			else if (i > n) {			// Cauchy rows
-				gfQ x(i - nCauchyStart);// first nCauchyRows values of gfQ are for x
-				gfQ y(j + nCauchyRows);	// next n values of gfQ are for y
+				gf x(i - nCauchyStart);	// first nCauchyRows values of gf are for x
+				gf y(j + nCauchyRows);	// next n values of gf are for y
 				// XXX - GCC 3.2 generates bogus code for this next line when >= -O1
-				// A(i,j) = gfQ(1) / (x + y);
-				gfQ z = gfQ(1) / (x + y);
+				// A(i,j) = gf(1) / (x + y);
+				gf z = gf(1) / (x + y);
 				A(i,j) = z;
 			}
 		}
@@ -138,4 +454,19 @@ IDA::EncodeMatrix(unsigned m, unsigned n)
 	return A;
 }
 
+// The weight of the matrix A.  This is the number of ones of its elements as
+// matrices over GF(2), the XORs to multiply-add by A in a bit-sliced layout.
+template <class gf> unsigned
+IDAT<gf>::MatrixWeight(const matrix<gf>& A)
+{
+	unsigned w = 0;
+	for (unsigned i = 0; i < A.rows(); i++)
+		for (unsigned j = 0; j < A.cols(); j++)
+			w += CauchySearch<gf>::Weight(A(i,j));
+	return w;
+}
+
+template class IDAT<gfQ>;
+template class IDAT<GF256>;
+
 } // namespace HoloStor
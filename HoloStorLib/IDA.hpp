@@ -26,7 +26,8 @@
 	IDA.hpp
 
  Abstract:
-	Interface to the IDA class.
+	Interface to the IDA class, a template over the field of the code (GF16
+	or, for HOLOSTOR_FLAG_GF256 sessions, GF256).
 
 --****************************************************************************/
 
@@ -42,18 +43,27 @@
 
 namespace HoloStor {
 
-class IDA {
+template <class gf>
+class IDAT {
 private:
-	matrixGFQ_t m_mEncode;
+	matrix<gf> m_mEncode;
+	//
+	bool _Coding(Tuple faults, const UCHAR* D, unsigned e, const UCHAR* R,
+		matrix<gf>& mCoding) const;
 public:
 	// constructor
-	IDA() { }
-	bool IDAInit(unsigned n, unsigned k);
-	bool GenerateCoding(Tuple faults, matrixGFQ_t& mCoding, UCHAR* rowsUsed);
-	static matrixGFQ_t EncodeMatrix(unsigned m, unsigned n);	// XXX - public for access by UnitTest
+	IDAT() { }
+	bool IDAInit(unsigned n, unsigned k, bool bMinXor = false);
+	bool GenerateCoding(Tuple faults, matrix<gf>& mCoding, UCHAR* rowsUsed) const;
+	static matrix<gf> EncodeMatrix(unsigned m, unsigned n,	// XXX - public for access by UnitTest
+		bool bMinXor = false);
+	static unsigned MatrixWeight(const matrix<gf>& A);		// XXX - public for access by UnitTest
 	//
 	NEWOPERATORS
 };
 
+typedef IDAT<gfQ> IDA;
+typedef IDAT<GF256> IDA256;
+
 } // namespace HoloStor
 #endif // HOLOSTOR_HOLOSTORLIB_IDA_HPP_
@@ -0,0 +1,223 @@
+/*  Copyright (C) 2003-2011 Thomas P. Scott and Myron Zimmerman
+
+    Thomas P. Scott <tpscott@alum.mit.edu>
+    Myron Zimmerman <MyronZimmerman@alum.mit.edu>
+
+    This file is part of HoloStor.
+
+    HoloStor is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3 of the License.
+
+    HoloStor is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with HoloStor.  If not, see <http://www.gnu.org/licenses/>.
+
+    Parts of HoloStor are protected by US Patent 7,472,334, the use of
+    which is granted in accordance to the terms of GPLv3.
+*/
+/*****************************************************************************
+
+ Module Name:
+	Interlocked.h
+
+ Abstract:
+	Atomic operations of the lock-free containers (SessionTable and the
+	recovery matrices of CodingTable), as wrappers for the x86 instructions.
+	Being LOCK-prefixed, each is also a full memory barrier.  CpuPause() is
+	for the loops that spin on them.
+
+--****************************************************************************/
+#ifndef HOLOSTOR_HOLOSTORLIB_INTERLOCKED_H_
+#define HOLOSTOR_HOLOSTORLIB_INTERLOCKED_H_
+
+#include "Types.h"
+
+namespace HoloStor {
+
+//
+// Wrapper for the CMPXCHG instruction. This performs the following as an
+// atomic operation:
+//   if (Comperand == *Destination) {
+//       *Destination = Exchange;
+//       return Comperand;
+//   } else
+//       return *Destination;
+//
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable:4035)				// no return value
+inline static PVOID 
+InterlockedCompareExchangePointer(
+  PVOID volatile* Destination,
+  PVOID Exchange,
+  PVOID Comperand)
+{
+	__asm {
+        mov ecx,Destination
+        mov eax,Comperand
+        mov edx,Exchange
+        lock cmpxchg [ecx],edx				// implicitly uses eax
+    }
+    // returns value in EAX
+}
+#pragma warning(pop)
+#else	// !_MSC_VER (GCC)
+inline static PVOID 
+InterlockedCompareExchangePointer(
+	PVOID volatile* Destination,
+	PVOID Exchange,
+	PVOID Comperand)
+{
+	PVOID	_x;
+
+#ifdef __x86_64__
+	__asm__ __volatile__(
+		"lock cmpxchgq	%2,(%3)"
+		: "=a" (_x) : "a" (Comperand), "r" (Exchange), "r" (Destination) : "memory"
+	);
+#else
+	__asm__ __volatile__(
+		"lock cmpxchgl	%2,(%3)"
+		: "=a" (_x) : "a" (Comperand), "r" (Exchange), "r" (Destination) : "memory"
+	);
+#endif
+
+	return _x;
+}
+#endif	// _MSC_VER
+
+//
+// Wrappers for the XADD and CMPXCHG instructions on 32-bit values.  The first
+// performs the following as an atomic operation:
+//   prior = *Addend;
+//   *Addend += Value;
+//   return prior;
+//
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable:4035)				// no return value
+inline static UINT32
+InterlockedExchangeAdd32(
+  UINT32 volatile* Addend,
+  UINT32 Value)
+{
+	__asm {
+        mov ecx,Addend
+        mov eax,Value
+        lock xadd [ecx],eax
+    }
+    // returns value in EAX
+}
+
+inline static UINT32
+InterlockedCompareExchange32(
+  UINT32 volatile* Destination,
+  UINT32 Exchange,
+  UINT32 Comperand)
+{
+	__asm {
+        mov ecx,Destination
+        mov eax,Comperand
+        mov edx,Exchange
+        lock cmpxchg [ecx],edx				// implicitly uses eax
+    }
+    // returns value in EAX
+}
+#pragma warning(pop)
+#else	// !_MSC_VER (GCC)
+inline static UINT32
+InterlockedExchangeAdd32(
+	UINT32 volatile* Addend,
+	UINT32 Value)
+{
+	UINT32	_x;
+
+	__asm__ __volatile__(
+		"lock xaddl	%0,(%2)"
+		: "=r" (_x) : "0" (Value), "r" (Addend) : "memory"
+	);
+	return _x;
+}
+
+inline static UINT32
+InterlockedCompareExchange32(
+	UINT32 volatile* Destination,
+	UINT32 Exchange,
+	UINT32 Comperand)
+{
+	UINT32	_x;
+
+	__asm__ __volatile__(
+		"lock cmpxchgl	%2,(%3)"
+		: "=a" (_x) : "a" (Comperand), "r" (Exchange), "r" (Destination) : "memory"
+	);
+	return _x;
+}
+#endif	// _MSC_VER
+
+//
+// As InterlockedCompareExchange32(), on an 8-bit value.
+//
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable:4035)				// no return value
+inline static UCHAR
+InterlockedCompareExchange8(
+  UCHAR volatile* Destination,
+  UCHAR Exchange,
+  UCHAR Comperand)
+{
+	__asm {
+        mov ecx,Destination
+        mov al,Comperand
+        mov dl,Exchange
+        lock cmpxchg [ecx],dl				// implicitly uses al
+    }
+    // returns value in AL
+}
+#pragma warning(pop)
+#else	// !_MSC_VER (GCC)
+inline static UCHAR
+InterlockedCompareExchange8(
+	UCHAR volatile* Destination,
+	UCHAR Exchange,
+	UCHAR Comperand)
+{
+	UCHAR	_x;
+
+	__asm__ __volatile__(
+		"lock cmpxchgb	%2,(%3)"
+		: "=a" (_x) : "a" (Comperand), "q" (Exchange), "r" (Destination) : "memory"
+	);
+	return _x;
+}
+#endif	// _MSC_VER
+
+//
+// The PAUSE instruction (REP NOP), for the body of a spin loop:  it lets the
+// other hyperthread of the core run and avoids the memory order violation on
+// leaving the loop.
+//
+#ifdef _MSC_VER
+inline static void
+CpuPause()
+{
+	__asm {
+        rep nop
+    }
+}
+#else	// !_MSC_VER (GCC)
+inline static void
+CpuPause()
+{
+	__asm__ __volatile__("rep; nop" : : : "memory");
+}
+#endif	// _MSC_VER
+
+} // namespace HoloStor
+#endif	// HOLOSTOR_HOLOSTORLIB_INTERLOCKED_H_
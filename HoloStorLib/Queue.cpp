@@ -0,0 +1,208 @@
+/*  Copyright (C) 2003-2011 Thomas P. Scott and Myron Zimmerman
+
+    Thomas P. Scott <tpscott@alum.mit.edu>
+    Myron Zimmerman <MyronZimmerman@alum.mit.edu>
+
+    This file is part of HoloStor.
+
+    HoloStor is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3 of the License.
+
+    HoloStor is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with HoloStor.  If not, see <http://www.gnu.org/licenses/>.
+
+    Parts of HoloStor are protected by US Patent 7,472,334, the use of
+    which is granted in accordance to the terms of GPLv3.
+*/
+/*****************************************************************************
+
+ Module Name:
+	Queue.cpp
+
+ Abstract:
+	Implementation of the asynchronous calls.
+
+	A HoloStor_Submit*() call takes a reference to its session and pushes
+	an AsyncRequest onto the AsyncQueue, without a lock.  A thread of the
+	pool pops it, makes the call and pushes the status onto the Ring of
+	completions of the session, signalling its eventfd.  The reference is
+	dropped last, so a session closed with calls in flight is deleted only
+	when they are done.
+
+--****************************************************************************/
+
+#include "Queue.hpp"
+#include "Session.hpp"
+#include "SessionTable.hpp"
+#include "Workers.h"
+//
+#include <assert.h>		// for ANSI assert()
+
+namespace HoloStor {
+
+SessionQueue::~SessionQueue()
+{
+	if (m_hEvent >= 0)
+		HoloStor_CloseEvent(m_hEvent);
+}
+
+int
+SessionQueue::QueueInit(unsigned nEntries)
+{
+	if (nEntries == 0 || nEntries > MaxQueueEntries)
+		return HOLOSTOR_STATUS_INVALID_PARAMETER;
+	unsigned nCells = 1;
+	while (nCells < nEntries)
+		nCells <<= 1;
+	if (!m_completions.RingInit(nCells))
+		return HOLOSTOR_STATUS_NO_MEMORY;
+	m_nEntries = nEntries;
+	m_nInFlight = 0;
+	m_hEvent = HoloStor_OpenEvent();
+	if (m_hEvent < 0)
+		return HOLOSTOR_STATUS_BAD_CONFIGURATION;	// no eventfd
+	return m_hEvent;
+}
+
+bool
+SessionQueue::reserve()
+{
+	if (InterlockedExchangeAdd32(&m_nInFlight, 1) < m_nEntries)
+		return true;
+	unreserve();
+	return false;
+}
+
+void
+SessionQueue::complete(void *lpContext, int lStatus)
+{
+	HOLOSTOR_COMPLETION completion;
+	completion.lpContext = lpContext;
+	completion.lStatus = lStatus;
+	const bool bPushed = m_completions.push(completion);
+	assert(bPushed);					// reserved
+	(void)bPushed;
+	HoloStor_SignalEvent(m_hEvent);
+}
+
+unsigned
+SessionQueue::reap(HOLOSTOR_COMPLETION *lpCompletions, unsigned nMax)
+{
+	unsigned n = 0;
+	while (n < nMax && m_completions.pop(lpCompletions[n])) {
+		unreserve();
+		n++;
+	}
+	return n;
+}
+
+int
+AsyncQueue::open()
+{
+	HoloStor_LockAsync();
+	int status = HOLOSTOR_STATUS_SUCCESS;
+	if (m_nQueues == 0) {
+		Ring<AsyncRequest*> *pRequests = new Ring<AsyncRequest*>;
+		if (pRequests == NULL || !pRequests->RingInit(MaxRequests))
+			status = HOLOSTOR_STATUS_NO_MEMORY;
+		else if (HoloStor_StartAsync(run, AsyncThreads) != 0)
+			status = HOLOSTOR_STATUS_BAD_CONFIGURATION;	// no threads
+		if (status == HOLOSTOR_STATUS_SUCCESS)
+			m_pRequests = pRequests;
+		else
+			delete pRequests;
+	}
+	if (status == HOLOSTOR_STATUS_SUCCESS)
+		m_nQueues++;
+	HoloStor_UnlockAsync();
+	return status;
+}
+
+// The last queue is closed by the release of its session, when no request
+// is in flight, and maybe by a thread of the AsyncQueue (see run()).
+void
+AsyncQueue::close()
+{
+	HoloStor_LockAsync();
+	assert(m_nQueues > 0);
+	if (--m_nQueues == 0) {
+		HoloStor_StopAsync();
+		delete m_pRequests;
+		m_pRequests = NULL;
+	}
+	HoloStor_UnlockAsync();
+}
+
+// The request is deleted here if it is not submitted.
+int
+AsyncQueue::submit(HOLOSTOR_SESSION hSession, AsyncRequest *pRequest)
+{
+	if (pRequest == NULL)
+		return HOLOSTOR_STATUS_NO_MEMORY;
+	Session *pSession = sessions.lookup(hSession);
+	if (pSession == NULL) {
+		delete pRequest;
+		return HOLOSTOR_STATUS_BAD_SESSION;
+	}
+	SessionQueue *pQueue = pSession->Queue();
+	int status = HOLOSTOR_STATUS_SUCCESS;
+	if (pQueue == NULL)
+		status = HOLOSTOR_STATUS_INVALID_PARAMETER;		// not opened
+	else if (!pQueue->reserve())
+		status = HOLOSTOR_STATUS_QUEUE_FULL;
+	else {
+		pRequest->hSession = hSession;
+		pRequest->pSession = pSession;
+		if (m_pRequests->push(pRequest)) {
+			HoloStor_PostAsync();
+			return HOLOSTOR_STATUS_SUCCESS;
+		}
+		pQueue->unreserve();
+		status = HOLOSTOR_STATUS_QUEUE_FULL;
+	}
+	sessions.release(hSession);
+	delete pRequest;
+	return status;
+}
+
+// Run by the threads of the pool once per HoloStor_PostAsync().
+void
+AsyncQueue::run()
+{
+	// There is a request for each post, but pop() fails while an earlier
+	// push() than the one of the post is still filling in its cell.
+	AsyncRequest *pRequest;
+	while (!asyncQueue.m_pRequests->pop(pRequest))
+		CpuPause();								// spin
+	const Session *pSession = pRequest->pSession;
+	int status;
+	switch (pRequest->op) {
+	case AsyncRequest::Encode:
+		status = pSession->Encode(pRequest->lpBlockGroup);
+		break;
+	case AsyncRequest::Rebuild:
+		status = pSession->Rebuild(pRequest->uInvalidBlockMask,
+					(pSession->nBlocks()+31)/32,
+					pRequest->lpBlockGroup, pRequest->lWhichBlock);
+		break;
+	default:
+		status = pSession->EncodeDelta(
+					pRequest->lDataIndex, pRequest->lpDeltaBlock,
+					pRequest->lEccIndex,  pRequest->lpEccBlockOld,
+					pRequest->lpEccBlockNew);
+		break;
+	}
+	pSession->Queue()->complete(pRequest->lpContext, status);
+	const HOLOSTOR_SESSION hSession = pRequest->hSession;
+	delete pRequest;
+	// Last, as it may delete the session and so close the AsyncQueue.
+	sessions.release(hSession);
+}
+
+} // namespace HoloStor
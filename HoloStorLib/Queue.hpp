@@ -0,0 +1,170 @@
+/*  Copyright (C) 2003-2011 Thomas P. Scott and Myron Zimmerman
+
+    Thomas P. Scott <tpscott@alum.mit.edu>
+    Myron Zimmerman <MyronZimmerman@alum.mit.edu>
+
+    This file is part of HoloStor.
+
+    HoloStor is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3 of the License.
+
+    HoloStor is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with HoloStor.  If not, see <http://www.gnu.org/licenses/>.
+
+    Parts of HoloStor are protected by US Patent 7,472,334, the use of
+    which is granted in accordance to the terms of GPLv3.
+*/
+/*****************************************************************************
+
+ Module Name:
+	Queue.hpp
+
+ Abstract:
+	Interface to the classes of the asynchronous calls:  the lock-free Ring,
+	the SessionQueue of the completions of a session and the AsyncQueue of
+	the calls submitted by all the sessions.
+
+--****************************************************************************/
+
+#ifndef HOLOSTOR_HOLOSTORLIB_QUEUE_HPP_
+#define HOLOSTOR_HOLOSTORLIB_QUEUE_HPP_
+
+#include "HoloStor.h"
+#include "Config.h"
+#include "Types.h"
+//
+#include "Interlocked.h"
+
+namespace HoloStor {
+
+// A bounded queue for any number of producers and consumers, without locks
+// (D. Vyukov's).  Cell i holds the item of position pos == i (mod nCells)
+// when its seq is pos+1, and is free for position pos when its seq is pos.
+template <class T>
+class Ring {
+private:
+	struct Cell {
+		volatile UINT32 seq;
+		T item;
+	};
+	Cell *m_pCells;
+	UINT32 m_mask;						// nCells-1
+	volatile UINT32 m_push, m_pop;		// the next positions
+public:
+	Ring() : m_pCells(NULL) {}
+	~Ring() { if (m_pCells != NULL) HoloStor_TableFree(m_pCells); }
+	// nCells must be a power of 2.
+	bool RingInit(unsigned nCells) {
+		m_pCells = (Cell*)HoloStor_TableAlloc(nCells*sizeof(Cell));
+		if (m_pCells == NULL)
+			return false;
+		for (unsigned i = 0; i < nCells; i++)
+			m_pCells[i].seq = i;
+		m_mask = nCells-1;
+		m_push = m_pop = 0;
+		return true;
+	}
+	// Each fails if the ring is full (empty).  The interlocked operations are
+	// also the barriers that order the item with the seq.
+	bool push(const T& item) {
+		for (;;) {
+			const UINT32 pos = m_push;
+			Cell& cell = m_pCells[pos & m_mask];
+			const INT32 dif = (INT32)(cell.seq - pos);
+			if (dif < 0)
+				return false;
+			if (dif == 0 && InterlockedCompareExchange32(&m_push, pos+1, pos) == pos) {
+				cell.item = item;
+				InterlockedExchangeAdd32(&cell.seq, 1);
+				return true;
+			}
+		}
+	}
+	bool pop(T& item) {
+		for (;;) {
+			const UINT32 pos = m_pop;
+			Cell& cell = m_pCells[pos & m_mask];
+			const INT32 dif = (INT32)(cell.seq - (pos+1));
+			if (dif < 0)
+				return false;
+			if (dif == 0 && InterlockedCompareExchange32(&m_pop, pos+1, pos) == pos) {
+				item = cell.item;
+				InterlockedExchangeAdd32(&cell.seq, m_mask);
+				return true;
+			}
+		}
+	}
+	//
+	NEWOPERATORS
+};
+
+// The completions of the calls a session has in flight, and the eventfd
+// signalled at each.  Calls in flight (submitted and not yet reaped) are
+// limited to the size of the Ring, so that it never overflows.
+class SessionQueue {
+private:
+	Ring<HOLOSTOR_COMPLETION> m_completions;
+	UINT32 m_nEntries;
+	volatile UINT32 m_nInFlight;
+	int m_hEvent;						// eventfd (-1 for none)
+public:
+	// constructor
+	SessionQueue() : m_hEvent(-1) {}
+	// destructor
+	~SessionQueue();
+	//
+	int QueueInit(unsigned nEntries);	// return the eventfd
+	bool reserve();						// for a call to submit
+	void unreserve() { InterlockedExchangeAdd32(&m_nInFlight, (UINT32)-1); }
+	void complete(void *lpContext, int lStatus);
+	unsigned reap(HOLOSTOR_COMPLETION *lpCompletions, unsigned nMax);
+	//
+	NEWOPERATORS
+};
+
+class Session;
+
+// A call submitted, run by a thread of the AsyncQueue.  It holds a reference
+// to the session (by way of SessionTable::lookup()).
+struct AsyncRequest {
+	enum Op { Encode, Rebuild, EncodeDelta } op;
+	HOLOSTOR_SESSION hSession;
+	Session *pSession;
+	void *lpContext;
+	UCHAR **lpBlockGroup;
+	UINT32 uInvalidBlockMask[(MaxBlocks+31)/32];	// a copy
+	INT lWhichBlock;
+	UINT lDataIndex, lEccIndex;
+	const UCHAR *lpDeltaBlock, *lpEccBlockOld;
+	UCHAR *lpEccBlockNew;
+	//
+	NEWOPERATORS
+};
+
+// The calls submitted by the sessions, run by the AsyncThreads threads of
+// Workers.c.  The Ring and the threads are there while any session has a
+// SessionQueue:  open() and close() count the queues, under the mutex of
+// HoloStor_LockAsync().
+// AsyncQueue must be an aggregate for the same reason as SessionTable.
+class AsyncQueue {
+public:
+	enum { MaxRequests = 1u<<14 };		// in flight, of all the sessions
+	Ring<AsyncRequest*> *m_pRequests;	// while m_nQueues is non-zero
+	UINT32 m_nQueues;					// guarded by HoloStor_LockAsync()
+	//
+	int open();							// for each SessionQueue
+	void close();						// when it is deleted
+	int submit(HOLOSTOR_SESSION hSession, AsyncRequest *pRequest);
+	static void run();					// run one request
+};
+
+extern AsyncQueue asyncQueue;
+
+} // namespace HoloStor
+#endif	// HOLOSTOR_HOLOSTORLIB_QUEUE_HPP_
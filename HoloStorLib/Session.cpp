@@ -31,244 +31,582 @@
 --****************************************************************************/
 
 #include "Session.hpp"
+#include "GF2Mul256.hpp"
+#include "Workers.h"
+#include "Interlocked.h"
 
 #include <string.h>		// for ANSI memset()
 #include <assert.h>		// for ANSI assert()
+#ifdef	SIMD_INTRINSICS
+#include <immintrin.h>
+#endif
 
 namespace HoloStor {
 
+// The WriteDelta() kernels: XOR count bytes (a multiple of 64) of two blocks.
+// XOR-ing is bound by memory bandwidth so SSE2 suffices for the higher methods.
+static void
+SSE2_xor(UCHAR* lpDeltaBlock, const UCHAR* lpDataBlockNew, const UCHAR* lpDataBlockOld,
+		 int count)
+{
+#ifdef	_MSC_VER
+	__asm {
+		mov		ecx,count
+		mov		ebx,lpDataBlockNew
+		mov		edx,lpDataBlockOld
+
+		// Streaming stores hurt the warm cache case, so they are used
+		// only by sessions with HOLOSTOR_FLAG_NONTEMPORAL (SSE2_xor_nt).
+		shr		ecx,6				// Divide count by 64 to get loops
+		mov		eax,lpDeltaBlock
+	L01:							// Loop XOR-ing in 64-byte chunks
+		movdqa	xmm0,[ebx]
+		movdqa	xmm1,[ebx+16]
+		movdqa	xmm2,[ebx+32]
+		movdqa	xmm3,[ebx+48]
+		movdqa	xmm4,[edx]
+		movdqa	xmm5,[edx+16]
+		movdqa	xmm6,[edx+32]
+		movdqa	xmm7,[edx+48]
+		pxor	xmm0,xmm4
+		pxor	xmm1,xmm5
+		pxor	xmm2,xmm6
+		pxor	xmm3,xmm7
+		movdqa	[eax],xmm0
+		movdqa	[eax+16],xmm1
+		movdqa	[eax+32],xmm2
+		movdqa	[eax+48],xmm3
+		add		eax,64
+		add		ebx,64
+		add		edx,64
+		loop	L01
+	}
+#else	// !_MSC_VER	(GCC)
+	count >>= 6;	// Divide count by 64 to get loops
+	do {			// Loop XOR-ing in 64-byte chunks
+		asm volatile("movdqa	%0,%%xmm0" : : "m" (lpDataBlockNew[ 0]));
+		asm volatile("movdqa	%0,%%xmm1" : : "m" (lpDataBlockNew[16]));
+		asm volatile("movdqa	%0,%%xmm2" : : "m" (lpDataBlockNew[32]));
+		asm volatile("movdqa	%0,%%xmm3" : : "m" (lpDataBlockNew[48]));
+		asm volatile("movdqa	%0,%%xmm4" : : "m" (lpDataBlockOld[ 0]));
+		asm volatile("movdqa	%0,%%xmm5" : : "m" (lpDataBlockOld[16]));
+		asm volatile("movdqa	%0,%%xmm6" : : "m" (lpDataBlockOld[32]));
+		asm volatile("movdqa	%0,%%xmm7" : : "m" (lpDataBlockOld[48]));
+		asm volatile("pxor	%xmm4,%xmm0");
+		asm volatile("pxor	%xmm5,%xmm1");
+		asm volatile("pxor	%xmm6,%xmm2");
+		asm volatile("pxor	%xmm7,%xmm3");
+		asm volatile("movdqa	%%xmm0,%0" : : "m" (lpDeltaBlock[ 0]));
+		asm volatile("movdqa	%%xmm1,%0" : : "m" (lpDeltaBlock[16]));
+		asm volatile("movdqa	%%xmm2,%0" : : "m" (lpDeltaBlock[32]));
+		asm volatile("movdqa	%%xmm3,%0" : : "m" (lpDeltaBlock[48]));
+		lpDataBlockNew += 64;
+		lpDataBlockOld += 64;
+		lpDeltaBlock += 64;
+	} while (--count);
+#endif	// _MSC_VER
+}
+
+static void
+MMX_xor(UCHAR* lpDeltaBlock, const UCHAR* lpDataBlockNew, const UCHAR* lpDataBlockOld,
+		 int count)
+{
+#ifdef	_MSC_VER
+	__asm {
+		mov		ecx,count
+		mov		ebx,lpDataBlockNew
+		mov		edx,lpDataBlockOld
+		shr		ecx,5				// Divide count by 32 to get loops
+		mov		eax,lpDeltaBlock
+	L10:							// Loop XOR-ing in 32-byte chunks
+		movq	mm0,[ebx]
+		movq	mm1,[edx]
+		pxor	mm0,mm1
+		movq	mm1,[ebx+8]
+		movq	mm2,[edx+8]
+		pxor	mm1,mm2
+		movq	mm2,[ebx+16]
+		movq	mm3,[edx+16]
+		pxor	mm2,mm3
+		movq	mm3,[ebx+24]
+		movq	mm4,[edx+24]
+		pxor	mm3,mm4
+		movq	[eax],mm0
+		movq	[eax+8],mm1
+		movq	[eax+16],mm2
+		movq	[eax+24],mm3
+		add		eax,32
+		add		ebx,32
+		add		edx,32
+		loop	L10
+		emms						// Reset MMX
+	}
+#else	// !_MSC_VER (GCC)
+	count >>= 5;	// Divide count by 32 to get loops
+	do {		// Loop XOR-ing in 32-byte chunks
+		asm volatile("movq	%0,%%mm0" : : "m" (lpDataBlockNew[ 0]));
+		asm volatile("movq	%0,%%mm1" : : "m" (lpDataBlockNew[ 8]));
+		asm volatile("movq	%0,%%mm2" : : "m" (lpDataBlockNew[16]));
+		asm volatile("movq	%0,%%mm3" : : "m" (lpDataBlockNew[24]));
+		asm volatile("movq	%0,%%mm4" : : "m" (lpDataBlockOld[ 0]));
+		asm volatile("movq	%0,%%mm5" : : "m" (lpDataBlockOld[ 8]));
+		asm volatile("movq	%0,%%mm6" : : "m" (lpDataBlockOld[16]));
+		asm volatile("movq	%0,%%mm7" : : "m" (lpDataBlockOld[24]));
+		asm volatile("pxor	%mm4,%mm0");
+		asm volatile("pxor	%mm5,%mm1");
+		asm volatile("pxor	%mm6,%mm2");
+		asm volatile("pxor	%mm7,%mm3");
+		asm volatile("movq	%%mm0,%0" : : "m" (lpDeltaBlock[ 0]));
+		asm volatile("movq	%%mm1,%0" : : "m" (lpDeltaBlock[ 8]));
+		asm volatile("movq	%%mm2,%0" : : "m" (lpDeltaBlock[16]));
+		asm volatile("movq	%%mm3,%0" : : "m" (lpDeltaBlock[24]));
+		lpDataBlockNew += 32;
+		lpDataBlockOld += 32;
+		lpDeltaBlock += 32;
+	} while (--count);
+	asm volatile("emms");	// Reset MMX
+#endif	// _MSC_VER
+}
+
+static void
+STD_xor(UCHAR* lpDeltaBlock, const UCHAR* lpDataBlockNew, const UCHAR* lpDataBlockOld,
+		 int count)
+{
+	ULONG*	dst = (ULONG*) lpDeltaBlock;
+	const ULONG* src1 = (const ULONG*) lpDataBlockNew;
+	const ULONG* src2 = (const ULONG*) lpDataBlockOld;
+
+	for ( ; count>0; count -= sizeof(ULONG))
+		*dst++ = *src1++ ^ *src2++;
+}
+
+#ifdef	SIMD_INTRINSICS
+// As SSE2_xor(), but writing the result around the cache.  The sources are
+// prefetched 512 bytes ahead with the NTA hint, which keeps them out of the
+// outer caches.
+SIMD_TARGET("sse2") static void
+SSE2_xor_nt(UCHAR* lpDeltaBlock, const UCHAR* lpDataBlockNew, const UCHAR* lpDataBlockOld,
+			int count)
+{
+	const __m128i *p1 = (const __m128i*)lpDataBlockNew;
+	const __m128i *p2 = (const __m128i*)lpDataBlockOld;
+	__m128i *q = (__m128i*)lpDeltaBlock;
+	for (count >>= 6; count > 0; count--) {	// Loop XOR-ing in 64-byte chunks
+		_mm_prefetch((const char*)(p1+32), _MM_HINT_NTA);
+		_mm_prefetch((const char*)(p2+32), _MM_HINT_NTA);
+		_mm_stream_si128(q+0, _mm_xor_si128(_mm_load_si128(p1+0), _mm_load_si128(p2+0)));
+		_mm_stream_si128(q+1, _mm_xor_si128(_mm_load_si128(p1+1), _mm_load_si128(p2+1)));
+		_mm_stream_si128(q+2, _mm_xor_si128(_mm_load_si128(p1+2), _mm_load_si128(p2+2)));
+		_mm_stream_si128(q+3, _mm_xor_si128(_mm_load_si128(p1+3), _mm_load_si128(p2+3)));
+		p1 += 4; p2 += 4; q += 4;
+	}
+	_mm_sfence();		// Flush WC buffer
+}
+#endif	// SIMD_INTRINSICS
+
 Session::Session()
 {
 	::memset(&m_config, 0, sizeof(m_config));
-	m_uAllMask = 0;
+	::memset(&m_options, 0, sizeof(m_options));
+	m_pKernels = &GF2Mul::Kernels(CPU_STD);
+	m_pKernels256 = &GF256Mul::Kernels(CPU_STD);
+	m_pXorBlocks = STD_xor;
+	m_pCodes = NULL;
+	m_pQueue = NULL;
+}
+
+Session::~Session()
+{
+	if (m_pCodes != NULL)
+		codingTables.release(m_pCodes);
+	if (m_pQueue != NULL) {
+		delete m_pQueue;
+		asyncQueue.close();
+	}
+}
+
+// Give the session its SessionQueue (once) and return its eventfd.
+int
+Session::OpenQueue(unsigned nEntries)
+{
+	if (m_pQueue != NULL)
+		return HOLOSTOR_STATUS_INVALID_PARAMETER;	// already open
+	int status = asyncQueue.open();
+	if (status != HOLOSTOR_STATUS_SUCCESS)
+		return status;
+	SessionQueue *pQueue = new SessionQueue;
+	if (pQueue == NULL)
+		status = HOLOSTOR_STATUS_NO_MEMORY;
+	else
+		status = pQueue->QueueInit(nEntries);
+	if (status >= 0 && InterlockedCompareExchangePointer((PVOID volatile*)&m_pQueue,
+			pQueue, NULL) != NULL)
+		status = HOLOSTOR_STATUS_INVALID_PARAMETER;	// lost the race
+	if (status < 0) {
+		delete pQueue;
+		asyncQueue.close();
+	}
+	return status;
 }
 
 int
-Session::SessionInit(const HOLOSTOR_CFG *lpConfiguration)
+Session::SessionInit(const HOLOSTOR_CFG *lpConfiguration,
+					 const HOLOSTOR_OPTIONS *lpOptions)
 {
 	m_config = *lpConfiguration;
+	if (lpOptions != NULL) {						// else the defaults (all 0)
+		if (lpOptions->Size < sizeof(lpOptions->Size) ||
+			lpOptions->Size > sizeof(m_options))
+			return HOLOSTOR_STATUS_BAD_CONFIGURATION;
+		::memcpy(&m_options, lpOptions, lpOptions->Size);
+	}
+	if (m_options.Flags & ~HOLOSTOR_FLAGS_VALID)
+		return HOLOSTOR_STATUS_BAD_CONFIGURATION;
+	if ((m_options.Flags & HOLOSTOR_FLAG_BITSLICED) &&
+		!(m_options.Flags & HOLOSTOR_FLAG_GF256))
+		return HOLOSTOR_STATUS_BAD_CONFIGURATION;
 	//
-	// Initialize the masks.
-	unsigned i, count;
-	m_uDataMask = 0;
-	count = m_config.DataBlocks;
-	for (i = 0; i < count; i++)
-		m_uDataMask |= (1<<i);
-	m_uEccMask = 0;
-	count += m_config.EccBlocks;
-	for (     ; i < count; i++)
-		m_uEccMask |= (1<<i);
-	m_uAllMask = m_uDataMask|m_uEccMask;
+	// Encode() rebuilds the ECC blocks, in the order of CombinIter.
+	const unsigned M = m_config.DataBlocks + m_config.EccBlocks;
+	if ( !m_tEccBlocks.setDim(m_config.EccBlocks) )
+		return HOLOSTOR_STATUS_BAD_CONFIGURATION;
+	for (unsigned i = 0; i < m_tEccBlocks.getDim() && i < MaxK; i++)	// a bound
+		m_tEccBlocks(i) = M-1-i;				// GCC sees (-Wstringop-overflow)
 	//
-	return m_codes.CodingTableInit(&m_config);
+	// Resolve the kernels of the method, which is that of the CPU unless the
+	// configuration asks for a lesser one.
+	unsigned method = CpuType;
+	if ((m_options.Flags & HOLOSTOR_FLAG_METHOD) && m_options.Method < method)
+		method = m_options.Method;
+	m_pKernels = &GF2Mul::Kernels(method);
+	if (m_options.Flags & HOLOSTOR_FLAG_BITSLICED)
+		m_pKernels256 = &GF2Mul256::Kernels(method);
+	else
+		m_pKernels256 = &GF256Mul::Kernels(method);
+	switch (m_pKernels->method)
+	{
+	case CPU_AVX512:
+	case CPU_AVX2:
+	case CPU_SSE2:
+#ifdef	SIMD_INTRINSICS
+		if (m_options.Flags & HOLOSTOR_FLAG_NONTEMPORAL) {
+			m_pXorBlocks = SSE2_xor_nt;
+			break;
+		}
+#endif	// SIMD_INTRINSICS
+		m_pXorBlocks = SSE2_xor;
+		break;
+	case CPU_MMX:
+		m_pXorBlocks = MMX_xor;
+		break;
+	default:
+		m_pXorBlocks = STD_xor;
+		break;
+	}
+	//
+	return codingTables.acquire(&m_config, m_options.Flags, &m_pCodes);
 }
 
-int
-Session::Rebuild(
-	UINT32 uInvalidBlockMask, UCHAR** lpBlockGroup, INT lWhichBlock) const
+// Return true if the blocks of the group are 16-byte aligned.
+bool
+Session::_Aligned(UCHAR** lpBlockGroup) const
 {
 	const unsigned M = m_config.DataBlocks + m_config.EccBlocks;
-	if (lWhichBlock >= (INT)M || uInvalidBlockMask > m_uAllMask)
-		return HOLOSTOR_STATUS_INVALID_PARAMETER;
 	UINT_PTR uMash = 0;
 	for (unsigned i = 0; i < M; ++i)
 		uMash |= (UINT_PTR)lpBlockGroup[i];
-	if (uMash&0xF)
+	return (uMash&0xF) == 0;
+}
+
+// Check the range of bytes lOffset thru lOffset+lLength-1 of a block, lLength 0
+// being the whole block.  Its ends must be on the boundaries of the units the
+// kernels code independently:  Elements, or slices for HOLOSTOR_FLAG_BITSLICED.
+int
+Session::_Range(UINT lOffset, UINT& lLength) const
+{
+	if (lLength == 0 && lOffset == 0)
+		lLength = m_config.BlockSize;
+	const unsigned unit = (m_options.Flags & HOLOSTOR_FLAG_BITSLICED) ?
+		GF2Mul256::SliceSize() : CodingMatrix::MinBlockSize();
+	if (lOffset % unit != 0 || lLength % unit != 0 || lLength == 0)
+		return HOLOSTOR_STATUS_INVALID_PARAMETER;
+	if (lOffset > m_config.BlockSize || lLength > m_config.BlockSize - lOffset)
+		return HOLOSTOR_STATUS_INVALID_PARAMETER;
+	return HOLOSTOR_STATUS_SUCCESS;
+}
+
+int
+Session::Encode(UCHAR** lpBlockGroup, UINT lOffset, UINT lLength) const
+{
+	if (!_Aligned(lpBlockGroup))
+		return HOLOSTOR_STATUS_MISALIGNED_BUFFER;
+	const int status = _Range(lOffset, lLength);
+	if (status != HOLOSTOR_STATUS_SUCCESS)
+		return status;
+	return _Rebuild(m_tEccBlocks, lpBlockGroup, -1, lOffset, lLength);
+}
+
+// The faults of the invalid blocks, the bits of nMaskWords words, block i
+// being bit i%32 of lpInvalidBlockMask[i/32].  Fail with
+// HOLOSTOR_STATUS_INVALID_PARAMETER for a block beyond the stripe before
+// HOLOSTOR_STATUS_TOO_MANY_BAD_BLOCKS.
+int
+Session::_Faults(
+	const UINT32* lpInvalidBlockMask, unsigned nMaskWords, Tuple& faults) const
+{
+	const unsigned M = m_config.DataBlocks + m_config.EccBlocks;
+	UCHAR Faults[MaxK];
+	unsigned nFaults = 0;
+	for (unsigned w = 0; w < nMaskWords; w++) {
+		UINT32 mask = lpInvalidBlockMask[w];
+		for (unsigned i = 32*w; mask != 0; i++, mask >>= 1) {
+			if ((mask&1) == 0)
+				continue;
+			if (i >= M)
+				return HOLOSTOR_STATUS_INVALID_PARAMETER;
+			if (nFaults < MaxK)
+				Faults[nFaults] = i;
+			nFaults++;
+		}
+	}
+	if (nFaults > m_config.EccBlocks)
+		return HOLOSTOR_STATUS_TOO_MANY_BAD_BLOCKS;
+	faults.setDim(nFaults);				// in decreasing order, like CombinIter
+	for (unsigned i = 0; i < nFaults; i++)
+		faults(i) = Faults[nFaults-1-i];
+	return HOLOSTOR_STATUS_SUCCESS;
+}
+
+int
+Session::Rebuild(
+	const UINT32* lpInvalidBlockMask, unsigned nMaskWords,
+	UCHAR** lpBlockGroup, INT lWhichBlock, UINT lOffset, UINT lLength) const
+{
+	const unsigned M = m_config.DataBlocks + m_config.EccBlocks;
+	if (lWhichBlock >= (INT)M)
+		return HOLOSTOR_STATUS_INVALID_PARAMETER;
+	int status = _Range(lOffset, lLength);
+	if (status != HOLOSTOR_STATUS_SUCCESS)
+		return status;
+	Tuple faults;
+	status = _Faults(lpInvalidBlockMask, nMaskWords, faults);
+	if (status == HOLOSTOR_STATUS_INVALID_PARAMETER)
+		return status;
+	if (!_Aligned(lpBlockGroup))
 		return HOLOSTOR_STATUS_MISALIGNED_BUFFER;
 	//
-	if (uInvalidBlockMask == 0)			// XXX - shouldn't need to special case
+	if (status != HOLOSTOR_STATUS_SUCCESS)
+		return status;
+	if (faults.getDim() == 0)			// XXX - shouldn't need to special case
 		return HOLOSTOR_STATUS_SUCCESS;
-	const CodingMatrix *cmPtr = m_codes.lookup(uInvalidBlockMask);
-	if (cmPtr == NULL)
-		return HOLOSTOR_STATUS_TOO_MANY_BAD_BLOCKS;
-	cmPtr->Rebuild(lpBlockGroup, lWhichBlock, m_config.BlockSize);
+	return _Rebuild(faults, lpBlockGroup, lWhichBlock, lOffset, lLength);
+}
+
+// Rebuild the bytes lOffset thru lOffset+lLength-1 (a checked _Range()) of the
+// faults, as if those were the blocks.
+int
+Session::_Rebuild(
+	const Tuple& faults, UCHAR** lpBlockGroup, INT lWhichBlock,
+	UINT lOffset, UINT lLength) const
+{
+	const CodingMatrix *cmPtr;
+	const int status = m_pCodes->lookup(faults, &cmPtr);
+	if (status != HOLOSTOR_STATUS_SUCCESS)
+		return status;
+	_Code(cmPtr, lpBlockGroup, lWhichBlock, lOffset, lLength);
+	return HOLOSTOR_STATUS_SUCCESS;
+}
+
+// A range of the blocks to code by a task of the worker pool.
+struct Session::CodeTask {
+	const Session *pSession;
+	const CodingMatrix *cmPtr;
+	UCHAR** lpBlockGroup;
+	INT lWhichBlock;
+	UINT lOffset, lLength;				// of all the tasks
+	UINT lTaskLength;					// of each (but the last)
+};
+
+void
+Session::_CodeTask(void *pContext, unsigned i)
+{
+	const CodeTask& task = *(const CodeTask*)pContext;
+	const UINT lStart = i*task.lTaskLength;
+	const UINT lLeft = task.lLength - lStart;
+	task.pSession->_CodeRange(task.cmPtr, task.lpBlockGroup, task.lWhichBlock,
+		task.lOffset + lStart, lLeft < task.lTaskLength ? lLeft : task.lTaskLength);
+}
+
+// Large blocks are split into ranges of at least MinTaskSize bytes, coded by
+// the threads of the pool (see HoloStor_SetThreads()).  Each range is of whole
+// units of _Range(), so the threads code disjoint bytes.
+void
+Session::_Code(const CodingMatrix *cmPtr, UCHAR** lpBlockGroup, INT lWhichBlock,
+			   UINT lOffset, UINT lLength) const
+{
+	unsigned nTasks = lLength/MinTaskSize;
+	if (nTasks > Threads)
+		nTasks = Threads;
+	if (nTasks <= 1) {
+		_CodeRange(cmPtr, lpBlockGroup, lWhichBlock, lOffset, lLength);
+		return;
+	}
+	const unsigned unit = (m_options.Flags & HOLOSTOR_FLAG_BITSLICED) ?
+		GF2Mul256::SliceSize() : CodingMatrix::MinBlockSize();
+	const UINT lUnits = lLength/unit;
+	CodeTask task = { this, cmPtr, lpBlockGroup, lWhichBlock, lOffset, lLength };
+	task.lTaskLength = (lUnits + nTasks-1)/nTasks*unit;
+	nTasks = (lLength + task.lTaskLength-1)/task.lTaskLength;
+	HoloStor_RunTasks(_CodeTask, &task, nTasks);
+}
+
+void
+Session::_CodeRange(const CodingMatrix *cmPtr, UCHAR** lpBlockGroup, INT lWhichBlock,
+					UINT lOffset, UINT lLength) const
+{
+	UCHAR* lpRange[MaxBlocks];
+	if (lOffset != 0) {
+		const unsigned M = m_config.DataBlocks + m_config.EccBlocks;
+		for (unsigned i = 0; i < M; i++)
+			lpRange[i] = lpBlockGroup[i] + lOffset;
+		lpBlockGroup = lpRange;
+	}
+	const bool bNT = (m_options.Flags & HOLOSTOR_FLAG_NONTEMPORAL) != 0;
+	if (m_options.Flags & HOLOSTOR_FLAG_GF256)
+		cmPtr->Rebuild(lpBlockGroup, lWhichBlock, lLength, *m_pKernels256, bNT);
+	else
+		cmPtr->Rebuild(lpBlockGroup, lWhichBlock, lLength, *m_pKernels, bNT);
+}
+
+// A batch is coded BatchChunk stripes at a time.  The CodingMatrix of each
+// stripe of a chunk is looked up first, then the stripes of each matrix are
+// coded back to back, the blocks of the next one prefetched while coding one
+// (so its first loads do not wait on the misses of new streams).
+int
+Session::EncodeBatch(UCHAR*** lpBlockGroups, unsigned nGroups) const
+{
+	for (unsigned s = 0; s < nGroups; s++)
+		if (!_Aligned(lpBlockGroups[s]))
+			return HOLOSTOR_STATUS_MISALIGNED_BUFFER;
+	const CodingMatrix *cmPtr;
+	const int status = m_pCodes->lookup(m_tEccBlocks, &cmPtr);
+	if (status != HOLOSTOR_STATUS_SUCCESS)
+		return status;
+	for (unsigned s = 0; s < nGroups; s++) {
+		if (s+1 < nGroups)
+			cmPtr->Prefetch(lpBlockGroups[s+1], -1, m_config.BlockSize);
+		_Code(cmPtr, lpBlockGroups[s], -1, 0, m_config.BlockSize);
+	}
+	return HOLOSTOR_STATUS_SUCCESS;
+}
+
+// Stripe s is invalid in the nMaskWords words at lpInvalidBlockMasks +
+// s*nMaskWords.  Every stripe is checked before any is coded.
+int
+Session::RebuildBatch(
+	const UINT32* lpInvalidBlockMasks, unsigned nMaskWords,
+	UCHAR*** lpBlockGroups, unsigned nGroups) const
+{
+	Tuple faults;
+	for (unsigned s = 0; s < nGroups; s++) {
+		const int status = _Faults(lpInvalidBlockMasks + s*nMaskWords, nMaskWords, faults);
+		if (status == HOLOSTOR_STATUS_INVALID_PARAMETER)
+			return status;
+		if (!_Aligned(lpBlockGroups[s]))
+			return HOLOSTOR_STATUS_MISALIGNED_BUFFER;
+		if (status != HOLOSTOR_STATUS_SUCCESS)
+			return status;
+	}
+	//
+	for (unsigned s0 = 0; s0 < nGroups; s0 += BatchChunk) {
+		const unsigned n = nGroups-s0 < BatchChunk ? nGroups-s0 : BatchChunk;
+		const CodingMatrix *cmPtrs[BatchChunk];	// NULL once coded
+		for (unsigned i = 0; i < n; i++) {
+			cmPtrs[i] = NULL;
+			_Faults(lpInvalidBlockMasks + (s0+i)*nMaskWords, nMaskWords, faults);
+			if (faults.getDim() == 0)
+				continue;						// nothing to rebuild
+			const int status = m_pCodes->lookup(faults, &cmPtrs[i]);
+			if (status != HOLOSTOR_STATUS_SUCCESS)
+				return status;
+		}
+		for (unsigned i = 0; i < n; i++) {
+			const CodingMatrix *cmPtr = cmPtrs[i];
+			if (cmPtr == NULL)
+				continue;
+			for (unsigned j = i, next; j < n; j = next) {
+				for (next = j+1; next < n && cmPtrs[next] != cmPtr; next++)
+					;
+				if (next < n)
+					cmPtr->Prefetch(lpBlockGroups[s0+next], -1, m_config.BlockSize);
+				_Code(cmPtr, lpBlockGroups[s0+j], -1, 0, m_config.BlockSize);
+				cmPtrs[j] = NULL;
+			}
+		}
+	}
 	return HOLOSTOR_STATUS_SUCCESS;
 }
 
 int
 Session::EncodeDelta(
 	UINT lDeltaIndex, const UCHAR* lpDeltaBlock,
-	UINT   lEccIndex, const UCHAR* lpEccBlockOld, UCHAR* lpEccBlockNew) const
+	UINT   lEccIndex, const UCHAR* lpEccBlockOld, UCHAR* lpEccBlockNew,
+	UINT lOffset, UINT lLength) const
 {
 	if (lDeltaIndex >= m_config.DataBlocks)
 		return HOLOSTOR_STATUS_INVALID_PARAMETER;
 	if ((UINT_PTR(lpDeltaBlock)|UINT_PTR(lpEccBlockOld)|UINT_PTR(lpEccBlockNew))&0xF)
 		return HOLOSTOR_STATUS_MISALIGNED_BUFFER;
-	const CodingMatrix *cmPtr = m_codes.lookup(1<<lEccIndex);
-	if (cmPtr == NULL)
+	if (lEccIndex >= m_config.DataBlocks + m_config.EccBlocks)
 		return HOLOSTOR_STATUS_INVALID_PARAMETER;
+	int status = _Range(lOffset, lLength);
+	if (status != HOLOSTOR_STATUS_SUCCESS)
+		return status;
+	Tuple ecc;
+	ecc.setDim(1);
+	ecc(0) = lEccIndex;
+	const CodingMatrix *cmPtr;
+	status = m_pCodes->lookup(ecc, &cmPtr);
+	if (status != HOLOSTOR_STATUS_SUCCESS)
+		return status == HOLOSTOR_STATUS_NO_MEMORY ? status
+												   : HOLOSTOR_STATUS_INVALID_PARAMETER;
+	lpDeltaBlock += lOffset;
+	lpEccBlockOld += lOffset;
+	lpEccBlockNew += lOffset;
 	//
-	cmPtr->EncodeDelta(lDeltaIndex,
-					   lpDeltaBlock,
-					   lpEccBlockOld,
-					   lpEccBlockNew,
-					   m_config.BlockSize);
+	const bool bNT = (m_options.Flags & HOLOSTOR_FLAG_NONTEMPORAL) != 0;
+	if (m_options.Flags & HOLOSTOR_FLAG_GF256)
+		cmPtr->EncodeDelta(lDeltaIndex,
+						   lpDeltaBlock,
+						   lpEccBlockOld,
+						   lpEccBlockNew,
+						   lLength,
+						   *m_pKernels256,
+						   bNT);
+	else
+		cmPtr->EncodeDelta(lDeltaIndex,
+						   lpDeltaBlock,
+						   lpEccBlockOld,
+						   lpEccBlockNew,
+						   lLength,
+						   *m_pKernels,
+						   bNT);
 	return HOLOSTOR_STATUS_SUCCESS;
 }
 
 int
 Session::WriteDelta(const UCHAR* lpDataBlockOld,
-					const UCHAR* lpDataBlockNew, UCHAR* lpDeltaBlock) const
+					const UCHAR* lpDataBlockNew, UCHAR* lpDeltaBlock,
+					UINT lOffset, UINT lLength) const
 {
 	if ((UINT_PTR(lpDataBlockOld)|UINT_PTR(lpDataBlockNew)|UINT_PTR(lpDeltaBlock))&0xF)
 		return HOLOSTOR_STATUS_MISALIGNED_BUFFER;
+	const int status = _Range(lOffset, lLength);
+	if (status != HOLOSTOR_STATUS_SUCCESS)
+		return status;
 	//
-	int count = m_config.BlockSize;
-
-	switch (CpuType)
-	{
-	case CPU_SSE2:
-#define USE_SSE2	// Do not use here because SSE2 is not faster then MMX
-#ifdef USE_SSE2
-#ifdef	_MSC_VER
-		__asm {
-			mov		ecx,count
-			mov		ebx,lpDataBlockNew
-			mov		edx,lpDataBlockOld
-
-//#define CACHE_MANAGEMENT	// Hurts warm cache case, little effect on dirty cache case
-#ifdef	CACHE_MANAGEMENT
-			mov		eax,[ebx]			// Load TLB's by touching first and
-			mov		eax,[ebx+ecx-4]		// last words of the source buffers
-			mov		eax,[edx]
-			mov		eax,[edx+ecx-4]
-			xor		eax,eax
-		L00:
-			prefetchnta	[ebx+eax]		// Prefetch source data into cache
-			prefetchnta	[edx+eax]
-			add		eax,64				// Cache Line size is 64 on SSE2 systems
-			cmp		eax,ecx
-			jl		L00
-#endif
-			shr		ecx,6				// Divide count by 64 to get loops
-			mov		eax,lpDeltaBlock
-		L01:							// Loop XOR-ing in 64-byte chunks
-			movdqa	xmm0,[ebx]
-			movdqa	xmm1,[ebx+16]
-			movdqa	xmm2,[ebx+32]
-			movdqa	xmm3,[ebx+48]
-			movdqa	xmm4,[edx]
-			movdqa	xmm5,[edx+16]
-			movdqa	xmm6,[edx+32]
-			movdqa	xmm7,[edx+48]
-			pxor	xmm0,xmm4
-			pxor	xmm1,xmm5
-			pxor	xmm2,xmm6
-			pxor	xmm3,xmm7
-#ifdef CACHE_MANAGEMENT
-			movntdq	[eax],xmm0
-			movntdq	[eax+16],xmm1
-			movntdq	[eax+32],xmm2
-			movntdq	[eax+48],xmm3
-#else
-			movdqa	[eax],xmm0
-			movdqa	[eax+16],xmm1
-			movdqa	[eax+32],xmm2
-			movdqa	[eax+48],xmm3
-#endif
-			add		eax,64
-			add		ebx,64
-			add		edx,64
-			loop	L01
-#ifdef CACHE_MANAGEMENT
-			sfence						// Flush WC buffer
-#endif
-		}
-		break;
-#else	// !_MSC_VER	(GCC)
-		count >>= 6;	// Divide count by 64 to get loops
-		do {			// Loop XOR-ing in 64-byte chunks
-			asm volatile("movdqa	%0,%%xmm0" : : "m" (lpDataBlockNew[ 0]));
-			asm volatile("movdqa	%0,%%xmm1" : : "m" (lpDataBlockNew[16]));
-			asm volatile("movdqa	%0,%%xmm2" : : "m" (lpDataBlockNew[32]));
-			asm volatile("movdqa	%0,%%xmm3" : : "m" (lpDataBlockNew[48]));
-			asm volatile("movdqa	%0,%%xmm4" : : "m" (lpDataBlockOld[ 0]));
-			asm volatile("movdqa	%0,%%xmm5" : : "m" (lpDataBlockOld[16]));
-			asm volatile("movdqa	%0,%%xmm6" : : "m" (lpDataBlockOld[32]));
-			asm volatile("movdqa	%0,%%xmm7" : : "m" (lpDataBlockOld[48]));
-			asm volatile("pxor	%xmm4,%xmm0");
-			asm volatile("pxor	%xmm5,%xmm1");
-			asm volatile("pxor	%xmm6,%xmm2");
-			asm volatile("pxor	%xmm7,%xmm3");
-			asm volatile("movdqa	%%xmm0,%0" : : "m" (lpDeltaBlock[ 0]));
-			asm volatile("movdqa	%%xmm1,%0" : : "m" (lpDeltaBlock[16]));
-			asm volatile("movdqa	%%xmm2,%0" : : "m" (lpDeltaBlock[32]));
-			asm volatile("movdqa	%%xmm3,%0" : : "m" (lpDeltaBlock[48]));
-			lpDataBlockNew += 64;
-			lpDataBlockOld += 64;
-			lpDeltaBlock += 64;
-		} while (--count);
-#endif	// _MSC_VER
-		break;
-#endif	// USE_SSE2
-
-	case CPU_MMX:
-#ifdef	_MSC_VER
-		__asm {
-			mov		ecx,count
-			mov		ebx,lpDataBlockNew
-			mov		edx,lpDataBlockOld
-			shr		ecx,5				// Divide count by 32 to get loops
-			mov		eax,lpDeltaBlock
-		L10:							// Loop XOR-ing in 32-byte chunks
-			movq	mm0,[ebx]
-			movq	mm1,[edx]
-			pxor	mm0,mm1
-			movq	mm1,[ebx+8]
-			movq	mm2,[edx+8]
-			pxor	mm1,mm2
-			movq	mm2,[ebx+16]
-			movq	mm3,[edx+16]
-			pxor	mm2,mm3
-			movq	mm3,[ebx+24]
-			movq	mm4,[edx+24]
-			pxor	mm3,mm4
-			movq	[eax],mm0
-			movq	[eax+8],mm1
-			movq	[eax+16],mm2
-			movq	[eax+24],mm3
-			add		eax,32
-			add		ebx,32
-			add		edx,32
-			loop	L10
-			emms						// Reset MMX
-		}
-#else	// !_MSC_VER (GCC)
-		count >>= 5;	// Divide count by 32 to get loops
-		do {		// Loop XOR-ing in 32-byte chunks
-			asm volatile("movq	%0,%%mm0" : : "m" (lpDataBlockNew[ 0]));
-			asm volatile("movq	%0,%%mm1" : : "m" (lpDataBlockNew[ 8]));
-			asm volatile("movq	%0,%%mm2" : : "m" (lpDataBlockNew[16]));
-			asm volatile("movq	%0,%%mm3" : : "m" (lpDataBlockNew[24]));
-			asm volatile("movq	%0,%%mm4" : : "m" (lpDataBlockOld[ 0]));
-			asm volatile("movq	%0,%%mm5" : : "m" (lpDataBlockOld[ 8]));
-			asm volatile("movq	%0,%%mm6" : : "m" (lpDataBlockOld[16]));
-			asm volatile("movq	%0,%%mm7" : : "m" (lpDataBlockOld[24]));
-			asm volatile("pxor	%mm4,%mm0");
-			asm volatile("pxor	%mm5,%mm1");
-			asm volatile("pxor	%mm6,%mm2");
-			asm volatile("pxor	%mm7,%mm3");
-			asm volatile("movq	%%mm0,%0" : : "m" (lpDeltaBlock[ 0]));
-			asm volatile("movq	%%mm1,%0" : : "m" (lpDeltaBlock[ 8]));
-			asm volatile("movq	%%mm2,%0" : : "m" (lpDeltaBlock[16]));
-			asm volatile("movq	%%mm3,%0" : : "m" (lpDeltaBlock[24]));
-			lpDataBlockNew += 32;
-			lpDataBlockOld += 32;
-			lpDeltaBlock += 32;
-		} while (--count);
-		asm volatile("emms");	// Reset MMX
-#endif	// _MSC_VER
-		break;
-
-	case CPU_STD:
-	default:
-		ULONG*	dst = (ULONG*) lpDeltaBlock;
-		ULONG* src1 = (ULONG*) lpDataBlockNew;
-		ULONG* src2 = (ULONG*) lpDataBlockOld;
-
-		for ( ; count>0; count -= sizeof(ULONG))
-			*dst++ = *src1++ ^ *src2++;
-	}
+	m_pXorBlocks(lpDeltaBlock + lOffset, lpDataBlockNew + lOffset,
+				 lpDataBlockOld + lOffset, lLength);
 	return HOLOSTOR_STATUS_SUCCESS;
 }
 
@@ -37,27 +37,64 @@
 #include "Config.h"
 #include "Types.h"
 #include "CodingTable.hpp"
+#include "Queue.hpp"
 
 namespace HoloStor {
 
 class Session {
 private:
 	HOLOSTOR_CFG m_config;
-	CodingTable m_codes;
-	UINT32 m_uAllMask;	// mask of all blocks
-	UINT32 m_uDataMask;	// mask of Data blocks
-	UINT32 m_uEccMask;	// mask of ECC blocks
+	HOLOSTOR_OPTIONS m_options;
+	const CodingTable *m_pCodes;	// shared by way of codingTables
+	Tuple m_tEccBlocks;	// the ECC blocks (as faults to rebuild)
+	// Kernels of the session's method, resolved by SessionInit()
+	const GF2Kernels *m_pKernels;
+	const GF256Kernels *m_pKernels256;	// for HOLOSTOR_FLAG_GF256
+	void (*m_pXorBlocks)(UCHAR* lpDeltaBlock, const UCHAR* lpDataBlockNew,
+						 const UCHAR* lpDataBlockOld, int count);
+	SessionQueue * volatile m_pQueue;	// of the asynchronous calls, if opened
+	//
+	bool _Aligned(UCHAR** lpBlockGroup) const;
+	int _Range(UINT lOffset, UINT& lLength) const;
+	int _Faults(const UINT32* lpInvalidBlockMask, unsigned nMaskWords,
+				Tuple& faults) const;
+	int _Rebuild(const Tuple& faults, UCHAR** lpBlockGroup, INT lWhichBlock,
+				 UINT lOffset, UINT lLength) const;
+	void _Code(const CodingMatrix *cmPtr, UCHAR** lpBlockGroup, INT lWhichBlock,
+			   UINT lOffset, UINT lLength) const;
+	void _CodeRange(const CodingMatrix *cmPtr, UCHAR** lpBlockGroup, INT lWhichBlock,
+					UINT lOffset, UINT lLength) const;
+	struct CodeTask;
+	static void _CodeTask(void *pContext, unsigned i);
+	enum { BatchChunk = 64 };		// stripes of a batch grouped by matrix
 public:
 	// constructor
 	Session();
+	// destructor
+	~Session();
 	//
-	int SessionInit(const HOLOSTOR_CFG* lpConfiguration);
-	int Rebuild(UINT32 uInvalidBlockMask, UCHAR** lpBlockGroup, INT lWhichBlock) const;
+	int SessionInit(const HOLOSTOR_CFG* lpConfiguration,
+					const HOLOSTOR_OPTIONS* lpOptions);
+	// Each codes the bytes lOffset thru lOffset+lLength-1 of the blocks only,
+	// lLength 0 (and lOffset 0) being the whole blocks.
+	int Encode(UCHAR** lpBlockGroup, UINT lOffset = 0, UINT lLength = 0) const;
+	int Rebuild(const UINT32* lpInvalidBlockMask, unsigned nMaskWords,
+				UCHAR** lpBlockGroup, INT lWhichBlock,
+				UINT lOffset = 0, UINT lLength = 0) const;
 	int EncodeDelta(unsigned lDeltaIndex, const UCHAR* lpDeltaBlock,
-					unsigned lEccIndex,   const UCHAR* lpEccBlockOld, UCHAR* lpEccBlockNew) const;
-	int WriteDelta(const UCHAR* lpDataBlockOld, const UCHAR* lpDataBlockNew, UCHAR* lpDeltaBlock) const;
+					unsigned lEccIndex,   const UCHAR* lpEccBlockOld, UCHAR* lpEccBlockNew,
+					UINT lOffset = 0, UINT lLength = 0) const;
+	int WriteDelta(const UCHAR* lpDataBlockOld, const UCHAR* lpDataBlockNew, UCHAR* lpDeltaBlock,
+				   UINT lOffset = 0, UINT lLength = 0) const;
+	// Each codes the whole blocks of nGroups stripes.
+	int EncodeBatch(UCHAR*** lpBlockGroups, unsigned nGroups) const;
+	int RebuildBatch(const UINT32* lpInvalidBlockMasks, unsigned nMaskWords,
+					 UCHAR*** lpBlockGroups, unsigned nGroups) const;
+	int OpenQueue(unsigned nEntries);
+	SessionQueue *Queue() const { return m_pQueue; }
+	int Warmup(unsigned nFaults) const { return m_pCodes->Warmup(nFaults); }
 	//
-	UINT32 uEccBlockMask() const { return m_uEccMask; }
+	unsigned nBlocks() const { return m_config.DataBlocks + m_config.EccBlocks; }
 	//
 	NEWOPERATORS
 };
@@ -29,10 +29,16 @@
 	Implementation of the SessionTable class.  SessionTable is a container for
 	the Session class.  The primary requirement for this container is fast
 	lookup. Lookup latency should also be uniform but this is not a requirement.
+	A second requirement is that a session may be closed while other threads
+	are still using it.
 	
 --****************************************************************************/
 
 #include "SessionTable.hpp"
+#include "Interlocked.h"
+//
+#include <string.h>		// for ANSI memset()
+#include <assert.h>		// for ANSI assert()
 
 namespace HoloStor {
 
@@ -41,94 +47,143 @@ namespace HoloStor {
  *	 The container could either be fixed in size or dynamically expanded. 
  * Though there are dynamic expansion algorithms, these introduce non-uniform
  * latencies or require deallocation and locking to eliminate races.  Rather
- * than increase latency with locking, the table is kept fixed in size.
+ * than increase latency with locking, the table grows by segments that are
+ * never moved or freed:  a handle is the index of its slot (and so of its
+ * segment), plus the generation of the slot.  lookup() is a single atomic add
+ * to the slot, whatever the number of sessions.  The first StaticSegments
+ * segments are part of the table, so that a program with no more sessions
+ * than they hold allocates none; the others are allocated for good (a
+ * lookup() of a stale handle may touch its slot at any time).
+ *
+ *	 A session is not deleted by remove() but by whichever thread releases the
+ * last reference to it, so that it is never deleted under a thread that has
+ * looked it up.  The generation makes the handles of a closed session invalid,
+ * even once its slot is reused (until the generation wraps, after 16384 more
+ * sessions in that slot).
  */
 
-//
-// Wrapper for the CMPXCHG instruction. This performs the following as an
-// atomic operation:
-//   if (Comperand == *Destination) {
-//       *Destination = Exchange;
-//       return Comperand;
-//   } else
-//       return *Destination;
-//
-#ifdef _MSC_VER
-#pragma warning(push)
-#pragma warning(disable:4035)				// no return value
-inline static PVOID 
-InterlockedCompareExchangePointer(
-  PVOID volatile* Destination,
-  PVOID Exchange,
-  PVOID Comperand)
+// The generation of a slot state and of a handle.
+static inline unsigned
+StateGen(UINT32 state)
 {
-	__asm {
-        mov ecx,Destination
-        mov eax,Comperand
-        mov edx,Exchange
-        lock cmpxchg [ecx],edx				// implicitly uses eax
-    }
-    // returns value in EAX
+	return state >> SessionSlot::GenShift;
 }
-#pragma warning(pop)
-#else	// !_MSC_VER (GCC)
-inline static PVOID 
-InterlockedCompareExchangePointer(
-	PVOID volatile* Destination,
-	PVOID Exchange,
-	PVOID Comperand)
+
+static inline unsigned
+HandleGen(HOLOSTOR_SESSION hSession)
 {
-	PVOID	_x;
-
-#ifdef __x86_64__
-	__asm__ __volatile__(
-		"lock cmpxchgq	%2,(%3)"
-		: "=a" (_x) : "a" (Comperand), "r" (Exchange), "r" (Destination)
-	);
-#else
-	__asm__ __volatile__(
-		"lock cmpxchgl	%2,(%3)"
-		: "=a" (_x) : "a" (Comperand), "r" (Exchange), "r" (Destination)
-	);
-#endif
-
-	return _x;
+	return (unsigned)hSession >> SessionTable::SlotBits;
 }
-#endif	// _MSC_VER
 
 HOLOSTOR_SESSION
 SessionTable::add(Session *pSession)
 {
-	for (unsigned i = 0; i < MaxSessions; i++) {
-		if (m_table[i] != NULL)
-			continue;
-		// Warning: possible race among SessionTable::add()'s claiming it.
-		PVOID prior = InterlockedCompareExchangePointer(
-							(PVOID*)&m_table[i], pSession, NULL
-					  );
-		if (prior == NULL)
-			return i;	// won the race
+	for (unsigned s = 0; s < MaxSegments; s++) {
+		Segment *pSegment = _segment(s);
+		if (pSegment == NULL) {
+			// Grow the table.
+			// Warning: possible race among SessionTable::add()'s allocating it.
+			Segment *pNew = (Segment*)HoloStor_TableAlloc(sizeof(Segment));
+			if (pNew == NULL)
+				return HOLOSTOR_STATUS_NO_MEMORY;
+			// Zeroed before it is published (the exchange is also a compiler
+			// barrier).
+			memset(pNew, 0, sizeof(Segment));
+			pSegment = (Segment*)InterlockedCompareExchangePointer(
+							(PVOID*)&m_segments[s], pNew, NULL
+					   );
+			if (pSegment == NULL)
+				pSegment = pNew;		// won the race
+			else
+				HoloStor_TableFree(pNew);
+		}
+		for (unsigned i = 0; i < SegmentSize; i++) {
+			SessionSlot *pSlot = &pSegment->slot[i];
+			if (pSlot->pSession != NULL)
+				continue;
+			// Warning: possible race among SessionTable::add()'s claiming it.
+			PVOID prior = InterlockedCompareExchangePointer(
+								(PVOID*)&pSlot->pSession, pSession, NULL
+						  );
+			if (prior != NULL)
+				continue;
+			// Won the race: open it to lookup(), with the table's reference.
+			UINT32 state = InterlockedExchangeAdd32(&pSlot->state,
+													SessionSlot::Open + 1);
+			return StateGen(state) << SlotBits | s << SegmentBits | i;
+		}
 	}
 	// No more room. 
 	return HOLOSTOR_STATUS_TOO_MANY_SESSIONS;
 }
 
-Session * 
-SessionTable::lookup(HOLOSTOR_SESSION hSession) const
+SessionSlot *
+SessionTable::_slot(HOLOSTOR_SESSION hSession)
 {
-	if (hSession < 0 || hSession >= (HOLOSTOR_SESSION)MaxSessions)
+	if (hSession < 0)
 		return NULL;
-	return m_table[hSession];
+	const unsigned i = hSession & ((1u<<SlotBits) - 1);
+	Segment *pSegment = _segment(i >> SegmentBits);
+	if (pSegment == NULL)
+		return NULL;
+	return &pSegment->slot[i & (SegmentSize - 1)];
 }
 
+// Return the session with a reference to it, which release() drops.
 Session * 
-SessionTable::remove(HOLOSTOR_SESSION hSession)
+SessionTable::lookup(HOLOSTOR_SESSION hSession)
 {
-	if (hSession < 0 || hSession >= (HOLOSTOR_SESSION)MaxSessions)
+	SessionSlot *pSlot = _slot(hSession);
+	if (pSlot == NULL)
 		return NULL;
-	Session *pSession = m_table[hSession];
-	m_table[hSession] = NULL;
-	return pSession;
+	UINT32 state = InterlockedExchangeAdd32(&pSlot->state, 1);
+	assert((state & SessionSlot::CountMask) != SessionSlot::CountMask);
+	if ((state & SessionSlot::Open) && StateGen(state) == HandleGen(hSession))
+		return pSlot->pSession;
+	_release(pSlot);				// not (or no longer) open
+	return NULL;
+}
+
+void
+SessionTable::release(HOLOSTOR_SESSION hSession)
+{
+	_release(_slot(hSession));
+}
+
+void
+SessionTable::_release(SessionSlot *pSlot)
+{
+	UINT32 state = InterlockedExchangeAdd32(&pSlot->state, (UINT32)-1) - 1;
+	if ((state & (SessionSlot::CountMask|SessionSlot::Draining)) != SessionSlot::Draining)
+		return;						// still referenced, or not closed
+	// The last reference to a closed session.  A lookup() may come between
+	// (and fail):  the release that clears Draining deletes the session.
+	if (InterlockedCompareExchange32(&pSlot->state,
+			state & ~SessionSlot::Draining, state) != state)
+		return;
+	Session *pSession = pSlot->pSession;
+	pSlot->pSession = NULL;			// free for add()
+	delete pSession;
+}
+
+bool
+SessionTable::remove(HOLOSTOR_SESSION hSession)
+{
+	SessionSlot *pSlot = _slot(hSession);
+	if (pSlot == NULL)
+		return false;
+	// Close it to lookup() and advance the generation, keeping the count.
+	for (;;) {
+		UINT32 state = pSlot->state;
+		if (!(state & SessionSlot::Open) || StateGen(state) != HandleGen(hSession))
+			return false;			// not open (or already closed)
+		UINT32 closed = (state & SessionSlot::CountMask) | SessionSlot::Draining |
+			((StateGen(state) + 1) & GenMask) << SessionSlot::GenShift;
+		if (InterlockedCompareExchange32(&pSlot->state, closed, state) == state)
+			break;
+	}
+	_release(pSlot);				// the table's reference
+	return true;
 }
 
 } // namespace HoloStor
@@ -41,18 +41,71 @@
 
 namespace HoloStor {
 
+// A slot of the SessionTable.  Its state is a reference count, a flag for an
+// open session, a flag for a closed session not yet deleted and the generation
+// of the slot (incremented at each close, to tell the handles of successive
+// sessions apart).
+struct SessionSlot {
+	Session * volatile pSession;		// non-NULL while in use
+	volatile UINT32 state;
+	//
+	enum {
+		CountMask = 0xFFFF,				// references (1 is the table's own)
+		Open = 1u<<16,
+		Draining = 1u<<17,				// closed, with references left
+		GenShift = 18					// generation in the high 14 bits
+	};
+};
+
 // SessionTable must be an aggregate since it is used as a global object
 // initialized by an initializer-list rather than by a constructor.
 
 class SessionTable {
 public:
-	Session	*m_table[MaxSessions];		// pointer to array of session pointers
+	enum {
+		SegmentBits = 8,				// slots are allocated 256 at a time
+		SegmentSize = 1u<<SegmentBits,
+		MaxSegments = MaxSessions/SegmentSize,
+		StaticSegments = 4,				// in the table itself (1024 slots)
+		SlotBits = 16,					// of a HOLOSTOR_SESSION (the rest for the
+		GenMask = (1u<<14) - 1			//   generation)
+	};
+	struct Segment {
+		SessionSlot slot[SegmentSize];
+	};
+	Segment * volatile m_segments[MaxSegments];	// allocated as the table grows
+	Segment m_static[StaticSegments];			// segments 0 thru StaticSegments-1
 	//
 	HOLOSTOR_SESSION add(Session *pSession);
-	Session *lookup(HOLOSTOR_SESSION hSession) const;	// low, uniform latency
-	Session *remove(HOLOSTOR_SESSION hSession);
+	Session *lookup(HOLOSTOR_SESSION hSession);		// wait-free, O(1)
+	void release(HOLOSTOR_SESSION hSession);		// after each lookup()
+	bool remove(HOLOSTOR_SESSION hSession);
 	//
 	NEWOPERATORS
+private:
+	Segment *_segment(unsigned s) {
+		return s < StaticSegments ? &m_static[s] : m_segments[s];
+	}
+	SessionSlot *_slot(HOLOSTOR_SESSION hSession);
+	void _release(SessionSlot *pSlot);
+};
+
+extern SessionTable sessions;
+
+// The Session of a handle for the lifetime of the SessionRef, which holds a
+// reference to it.  A session that is closed meanwhile is deleted only when
+// the last reference is released.
+class SessionRef {
+private:
+	HOLOSTOR_SESSION m_hSession;
+	Session *m_pSession;
+public:
+	SessionRef(HOLOSTOR_SESSION hSession)
+		: m_hSession(hSession), m_pSession(sessions.lookup(hSession)) {}
+	~SessionRef() { if (m_pSession != NULL) sessions.release(m_hSession); }
+	//
+	Session *operator->() const { return m_pSession; }
+	bool isNull() const { return m_pSession == NULL; }
 };
 
 } // namespace HoloStor
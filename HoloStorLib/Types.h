@@ -40,6 +40,7 @@ typedef int INT;
 typedef unsigned int UINT;
 typedef int INT32;
 typedef unsigned int UINT32;
+typedef unsigned long long UINT64;
 typedef long LONG;
 typedef unsigned long ULONG;
 typedef void* PVOID;
@@ -59,7 +60,7 @@ typedef int INT_PTR;
 #endif
 #endif
 
-typedef unsigned short	CodingIndex;	// identifies a CodingMatrix in the CodingTable
+typedef unsigned int	CodingIndex;	// identifies a CodingMatrix in the CodingTable
 typedef	unsigned char	MatrixIndex;	// index into matrices
 
 typedef struct { UINT32 basicword[HYPERWORD_SIZE]; } hyperword_t;
@@ -33,12 +33,14 @@
 #define HOLOSTOR_HOLOSTORLIB_TYPESGF_HPP_
 
 #include "GF16.hpp"
+#include "GF256.hpp"
 #include "matrix.hpp"
 
 namespace HoloStor {
 
 typedef GF16 gfQ;
 typedef matrix<gfQ> matrixGFQ_t;
+typedef matrix<GF256> matrixGF256_t;	// for HOLOSTOR_FLAG_GF256 sessions
 
 } // namespace HoloStor
 #endif	// HOLOSTOR_HOLOSTORLIB_TYPESGF_HPP_
@@ -0,0 +1,258 @@
+/*  Copyright (C) 2003-2011 Thomas P. Scott and Myron Zimmerman
+
+    Thomas P. Scott <tpscott@alum.mit.edu>
+    Myron Zimmerman <MyronZimmerman@alum.mit.edu>
+
+    This file is part of HoloStor.
+
+    HoloStor is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3 of the License.
+
+    HoloStor is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with HoloStor.  If not, see <http://www.gnu.org/licenses/>.
+
+    Parts of HoloStor are protected by US Patent 7,472,334, the use of
+    which is granted in accordance to the terms of GPLv3.
+*/
+/*****************************************************************************
+
+ Module Name:
+	Workers.c
+
+ Abstract:
+	Implementation of the pool of worker threads, with POSIX threads, and
+	of the events of the asynchronous calls, with Linux eventfds.
+
+--****************************************************************************/
+
+#include "Workers.h"
+
+#if	!defined(__KERNEL__) && !defined(_WIN32)
+#include <pthread.h>
+
+#define	MAX_THREADS		64
+//
+// The tasks of a call are handed out one at a time, under the mutex, by
+// _RunTasks() on the caller and on each worker it wakes.  One call at a time
+// has the pool (holds busy); another runs its tasks itself.
+static struct {
+	pthread_mutex_t busy;			// held by the caller of the running tasks
+	pthread_mutex_t mutex;			// guards what follows
+	pthread_cond_t wake;			// for the workers: a call or bStop
+	pthread_cond_t done;			// for the caller: the tasks are done
+	unsigned int nWorkers;
+	unsigned int generation;		// of the call (counts the calls)
+	int bStop;						// the workers are to exit
+	void (*pfnTask)(void *pContext, unsigned int i);
+	void *pContext;
+	unsigned int nTasks, nNext, nDone;
+	pthread_t workers[MAX_THREADS-1];
+} pool = {
+	PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER,
+	PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER
+};
+
+// Run the tasks of the call still to run (the mutex held).
+static void
+_RunTasks(void)
+{
+	while (pool.nNext < pool.nTasks) {
+		unsigned int i = pool.nNext++;
+		pthread_mutex_unlock(&pool.mutex);
+		pool.pfnTask(pool.pContext, i);
+		pthread_mutex_lock(&pool.mutex);
+		if (++pool.nDone == pool.nTasks)
+			pthread_cond_signal(&pool.done);
+	}
+}
+
+static void *
+_Worker(void *arg)
+{
+	unsigned int generation;
+	pthread_mutex_lock(&pool.mutex);
+	generation = pool.generation;
+	for (;;) {
+		while (pool.generation == generation && !pool.bStop)
+			pthread_cond_wait(&pool.wake, &pool.mutex);
+		if (pool.bStop)
+			break;
+		generation = pool.generation;
+		_RunTasks();
+	}
+	pthread_mutex_unlock(&pool.mutex);
+	return arg;
+}
+
+unsigned int
+HoloStor_SetWorkers(unsigned int nThreads)
+{
+	unsigned int i;
+	if (nThreads < 1)
+		nThreads = 1;
+	if (nThreads > MAX_THREADS)
+		nThreads = MAX_THREADS;
+	pthread_mutex_lock(&pool.busy);
+	// Stop the workers there are, then start those wanted.
+	pthread_mutex_lock(&pool.mutex);
+	pool.bStop = 1;
+	pthread_cond_broadcast(&pool.wake);
+	pthread_mutex_unlock(&pool.mutex);
+	for (i = 0; i < pool.nWorkers; i++)
+		pthread_join(pool.workers[i], NULL);
+	pool.bStop = 0;
+	for (pool.nWorkers = 0; pool.nWorkers < nThreads-1; pool.nWorkers++)
+		if (pthread_create(&pool.workers[pool.nWorkers], NULL, _Worker, NULL) != 0)
+			break;
+	nThreads = pool.nWorkers + 1;
+	pthread_mutex_unlock(&pool.busy);
+	return nThreads;
+}
+
+void
+HoloStor_RunTasks(void (*pfnTask)(void *pContext, unsigned int i),
+				  void *pContext, unsigned int nTasks)
+{
+	unsigned int i;
+	if (nTasks > 1 && pool.nWorkers != 0 && pthread_mutex_trylock(&pool.busy) == 0) {
+		pthread_mutex_lock(&pool.mutex);
+		pool.pfnTask = pfnTask;
+		pool.pContext = pContext;
+		pool.nTasks = nTasks;
+		pool.nNext = pool.nDone = 0;
+		pool.generation++;
+		pthread_cond_broadcast(&pool.wake);
+		_RunTasks();
+		while (pool.nDone < pool.nTasks)
+			pthread_cond_wait(&pool.done, &pool.mutex);
+		pthread_mutex_unlock(&pool.mutex);
+		pthread_mutex_unlock(&pool.busy);
+		return;
+	}
+	for (i = 0; i < nTasks; i++)
+		pfnTask(pContext, i);
+}
+
+// The threads of the asynchronous calls each wait for a post and call
+// pfnRun() once for it.  HoloStor_StopAsync() ends the generation they were
+// started in, and they exit once they see it has ended (a thread in pfnRun()
+// when it ends exits on its return), without the caller waiting for them.
+// The posts are then taken by the threads of a later HoloStor_StartAsync().
+static struct {
+	pthread_mutex_t users;			// of HoloStor_LockAsync()
+	pthread_mutex_t mutex;			// guards what follows
+	pthread_cond_t posted;			// for the threads: a post or a new generation
+	unsigned int generation;		// of the threads started last
+	unsigned int nPosted;			// posts not yet taken
+	void (*pfnRun)(void);
+} async = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+
+static void *
+_AsyncWorker(void *arg)
+{
+	const unsigned int generation = (unsigned int)(size_t)arg;
+	pthread_mutex_lock(&async.mutex);
+	for (;;) {
+		while (async.nPosted == 0 && async.generation == generation)
+			pthread_cond_wait(&async.posted, &async.mutex);
+		if (async.generation != generation)
+			break;
+		async.nPosted--;
+		pthread_mutex_unlock(&async.mutex);
+		async.pfnRun();
+		pthread_mutex_lock(&async.mutex);
+	}
+	pthread_mutex_unlock(&async.mutex);
+	return NULL;
+}
+
+int
+HoloStor_StartAsync(void (*pfnRun)(void), unsigned int nThreads)
+{
+	unsigned int i;
+	int status = -1;
+	pthread_t thread;
+	pthread_mutex_lock(&async.mutex);
+	async.pfnRun = pfnRun;
+	async.nPosted = 0;
+	for (i = 0; i < nThreads; i++)
+		if (pthread_create(&thread, NULL, _AsyncWorker,
+				(void*)(size_t)async.generation) == 0) {
+			pthread_detach(thread);
+			status = 0;
+		}
+	pthread_mutex_unlock(&async.mutex);
+	return status;
+}
+
+void
+HoloStor_StopAsync(void)
+{
+	pthread_mutex_lock(&async.mutex);
+	async.generation++;
+	pthread_cond_broadcast(&async.posted);
+	pthread_mutex_unlock(&async.mutex);
+}
+
+void
+HoloStor_PostAsync(void)
+{
+	pthread_mutex_lock(&async.mutex);
+	async.nPosted++;
+	pthread_cond_signal(&async.posted);
+	pthread_mutex_unlock(&async.mutex);
+}
+
+void HoloStor_LockAsync(void) { pthread_mutex_lock(&async.users); }
+void HoloStor_UnlockAsync(void) { pthread_mutex_unlock(&async.users); }
+
+#else // __KERNEL__ || _WIN32 - no threads
+
+unsigned int HoloStor_SetWorkers(unsigned int nThreads) { return 1; }
+
+void
+HoloStor_RunTasks(void (*pfnTask)(void *pContext, unsigned int i),
+				  void *pContext, unsigned int nTasks)
+{
+	unsigned int i;
+	for (i = 0; i < nTasks; i++)
+		pfnTask(pContext, i);
+}
+
+int HoloStor_StartAsync(void (*pfnRun)(void), unsigned int nThreads) { return -1; }
+void HoloStor_StopAsync(void) {}
+void HoloStor_PostAsync(void) {}
+void HoloStor_LockAsync(void) {}
+void HoloStor_UnlockAsync(void) {}
+
+#endif
+
+#if	defined(__linux__) && !defined(__KERNEL__)
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+int HoloStor_OpenEvent(void) { return eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK); }
+
+void
+HoloStor_SignalEvent(int hEvent)
+{
+	const unsigned long long one = 1;
+	if (write(hEvent, &one, sizeof(one)) != sizeof(one))
+		;							// the count is at its maximum
+}
+
+void HoloStor_CloseEvent(int hEvent) { close(hEvent); }
+
+#else // no eventfd
+
+int HoloStor_OpenEvent(void) { return -1; }
+void HoloStor_SignalEvent(int hEvent) {}
+void HoloStor_CloseEvent(int hEvent) {}
+
+#endif
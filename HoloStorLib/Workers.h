@@ -0,0 +1,78 @@
+/*  Copyright (C) 2003-2011 Thomas P. Scott and Myron Zimmerman
+
+    Thomas P. Scott <tpscott@alum.mit.edu>
+    Myron Zimmerman <MyronZimmerman@alum.mit.edu>
+
+    This file is part of HoloStor.
+
+    HoloStor is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3 of the License.
+
+    HoloStor is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with HoloStor.  If not, see <http://www.gnu.org/licenses/>.
+
+    Parts of HoloStor are protected by US Patent 7,472,334, the use of
+    which is granted in accordance to the terms of GPLv3.
+*/
+/*****************************************************************************
+
+ Module Name:
+	Workers.h
+
+ Abstract:
+	Interface to the pool of worker threads, in C.
+
+	A call spreads the coding of a large block over several cores by
+	running tasks on the pool.  Where there are no threads (e.g. the
+	Linux kernel) the tasks are run one after the other by the caller.
+
+	Other threads of the pool run the calls submitted asynchronously,
+	which post their completions to eventfds.
+
+--****************************************************************************/
+
+#ifndef HOLOSTOR_HOLOSTORLIB_WORKERS_H_
+#define HOLOSTOR_HOLOSTORLIB_WORKERS_H_
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+// Set the threads of the pool to nThreads, the caller of
+// HoloStor_RunTasks() being one of them, and return the number in effect.
+extern unsigned int HoloStor_SetWorkers(unsigned int nThreads);
+// Call pfnTask(pContext, i) for i from 0 to nTasks-1 on the threads of the
+// pool, and return when all have returned.  If the pool is busy with the
+// tasks of another caller, the caller runs its own.
+extern void HoloStor_RunTasks(void (*pfnTask)(void *pContext, unsigned int i),
+							  void *pContext, unsigned int nTasks);
+
+// Start nThreads threads that each call pfnRun() once for each
+// HoloStor_PostAsync(), and return 0 (or -1 if there are no threads).
+// HoloStor_StopAsync() lets them exit; it does not wait for them, so that
+// it may be called by one of them.  The calls of the two alternate.
+extern int HoloStor_StartAsync(void (*pfnRun)(void), unsigned int nThreads);
+extern void HoloStor_StopAsync(void);
+extern void HoloStor_PostAsync(void);
+// A mutex for the callers of HoloStor_StartAsync() and HoloStor_StopAsync(),
+// to count the users of the threads.  It blocks rather than spins, as the
+// threads take a while to start.
+extern void HoloStor_LockAsync(void);
+extern void HoloStor_UnlockAsync(void);
+
+// An eventfd, signalled once by each HoloStor_SignalEvent().  -1 is returned
+// where there are none.
+extern int HoloStor_OpenEvent(void);
+extern void HoloStor_SignalEvent(int hEvent);
+extern void HoloStor_CloseEvent(int hEvent);
+
+#ifdef  __cplusplus
+}
+#endif
+#endif // HOLOSTOR_HOLOSTORLIB_WORKERS_H_
@@ -0,0 +1,249 @@
+/*  Copyright (C) 2003-2011 Thomas P. Scott and Myron Zimmerman
+
+    Thomas P. Scott <tpscott@alum.mit.edu>
+    Myron Zimmerman <MyronZimmerman@alum.mit.edu>
+
+    This file is part of HoloStor.
+
+    HoloStor is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3 of the License.
+
+    HoloStor is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with HoloStor.  If not, see <http://www.gnu.org/licenses/>.
+
+    Parts of HoloStor are protected by US Patent 7,472,334, the use of
+    which is granted in accordance to the terms of GPLv3.
+*/
+/*****************************************************************************
+
+ Module Name:
+	XorSchedule.hpp
+
+ Abstract:
+	XOR schedules for the GF(2**W) multiply-add operation of class GF2Mul
+	(W = ELEMENT_WIDTH = 4) and of the bit-sliced GF(2**8) kernels of class
+	GF2Mul256 (W = 8), generated at compile time.
+
+	Multiplication by v is the W x W matrix over GF(2) of GF2Mul::multOp(v):
+	destination hyperword i is XOR-ed with source hyperword j where the
+	matrix has a 1.  Rather than XOR each destination
+	independently, sums of source hyperwords that are needed by more than one
+	destination are computed once (common subexpression elimination by the
+	greedy method of Paar: repeatedly take the pair of terms shared by the
+	most destinations).  Over the 16 multipliers of GF(2**4) this takes 109
+	XORs where the matrices have 128 ones.
+
+	The schedules are expanded by templates into straight-line code on any
+	type with an XOR, such as the SIMD vector types.
+
+--****************************************************************************/
+#ifndef HOLOSTOR_HOLOSTORLIB_XORSCHEDULE_HPP_
+#define HOLOSTOR_HOLOSTORLIB_XORSCHEDULE_HPP_
+
+#include "Config.h"
+#include <utility>		// for std::integer_sequence
+#ifdef	SIMD_INTRINSICS
+#include <immintrin.h>
+#endif
+
+#if ELEMENT_WIDTH != 4
+#error Invalid ELEMENT_WIDTH constant (must be 4)
+#endif
+
+namespace HoloStor {
+
+// A schedule works on a file of registers: the destination hyperwords in
+// r[0..W-1], the source hyperwords in r[W..2*W-1] and the common
+// subexpressions after them.  Operation k is r[op[k][0]] = r[op[k][1]] ^
+// r[op[k][2]].
+template <unsigned W = ELEMENT_WIDTH>
+struct XorSchedule {
+	enum {
+		MaxTemps = W*W/2,				// each removes at least 2 terms
+		MaxRegs = 2*W + MaxTemps,
+		MaxOps = MaxTemps + W*W
+	};
+	unsigned nOps;
+	unsigned char op[MaxOps][3];
+};
+
+// The polynomial of the field GF(2**W): that of class GF16 (x**4 + x + 1)
+// or of class GF256 (x**8 + x**4 + x**3 + x**2 + 1).
+constexpr unsigned
+FieldPoly(unsigned W)
+{
+	return W == 4 ? 0x13 : 0x11D;
+}
+
+// GF(2**W) multiplication.
+constexpr unsigned
+GFMul(unsigned a, unsigned b, unsigned W = ELEMENT_WIDTH)
+{
+	unsigned p = 0;
+	for (; b != 0; b >>= 1) {
+		if (b & 1)
+			p ^= a;
+		a <<= 1;
+		if (a >> W)
+			a ^= FieldPoly(W);
+	}
+	return p;
+}
+
+constexpr unsigned
+GF16Mul(unsigned a, unsigned b)
+{
+	return GFMul(a, b, 4);
+}
+
+// The schedule for multiply-add by v.
+template <unsigned W = ELEMENT_WIDTH>
+constexpr XorSchedule<W>
+MakeXorSchedule(unsigned v)
+{
+	typedef unsigned long long regset_t;	// a set of registers (MaxRegs <= 64)
+	static_assert(XorSchedule<W>::MaxRegs <= 64, "too many registers");
+	XorSchedule<W> sched = {};
+	// terms[i] is the set of registers still to be XOR-ed into destination i
+	regset_t terms[W] = {};
+	for (unsigned j = 0; j < W; j++) {
+		const unsigned u = GFMul(v, 1u<<j, W);	// column j of multOp(v)
+		for (unsigned i = 0; i < W; i++)
+			if (u>>i & 1)
+				terms[i] |= regset_t(1) << (W+j);
+	}
+	unsigned nRegs = 2*W;
+	for (;;) {
+		unsigned nBest = 1, aBest = 0, bBest = 0;
+		for (unsigned a = W; a < nRegs; a++)
+			for (unsigned b = a+1; b < nRegs; b++) {
+				const regset_t pair = regset_t(1)<<a | regset_t(1)<<b;
+				unsigned n = 0;
+				for (unsigned i = 0; i < W; i++)
+					n += (terms[i] & pair) == pair;
+				if (n > nBest) {
+					nBest = n;
+					aBest = a;
+					bBest = b;
+				}
+			}
+		if (nBest < 2)
+			break;							// nothing left in common
+		const regset_t pair = regset_t(1)<<aBest | regset_t(1)<<bBest;
+		for (unsigned i = 0; i < W; i++)
+			if ((terms[i] & pair) == pair)
+				terms[i] = (terms[i] & ~pair) | regset_t(1)<<nRegs;
+		sched.op[sched.nOps][0] = nRegs++;
+		sched.op[sched.nOps][1] = aBest;
+		sched.op[sched.nOps][2] = bBest;
+		sched.nOps++;
+	}
+	for (unsigned i = 0; i < W; i++)
+		for (unsigned r = W; r < nRegs; r++)
+			if (terms[i]>>r & 1) {
+				sched.op[sched.nOps][0] = i;
+				sched.op[sched.nOps][1] = i;
+				sched.op[sched.nOps][2] = r;
+				sched.nOps++;
+			}
+	return sched;
+}
+
+template <unsigned V, unsigned W = ELEMENT_WIDTH> struct XorScheduleOf {
+	static constexpr XorSchedule<W> value = MakeXorSchedule<W>(V);
+};
+
+// XOR for the register types.  GCC vector types have the operator built in.
+#if !defined(__GNUC__) && defined(SIMD_INTRINSICS)
+static SIMD_INLINE __m128i
+Xor(const __m128i& a, const __m128i& b) { return _mm_xor_si128(a, b); }
+static SIMD_INLINE __m256i
+Xor(const __m256i& a, const __m256i& b) { return _mm256_xor_si256(a, b); }
+static SIMD_INLINE __m512i
+Xor(const __m512i& a, const __m512i& b) { return _mm512_xor_si512(a, b); }
+#ifdef	_M_IX86
+static SIMD_INLINE __m64
+Xor(const __m64& a, const __m64& b) { return _mm_xor_si64(a, b); }
+#endif
+#endif
+
+// Operation K of the schedule for V.
+template <unsigned V, unsigned W, unsigned K>
+struct XorOp {
+	enum {
+		D = XorScheduleOf<V, W>::value.op[K][0],
+		A = XorScheduleOf<V, W>::value.op[K][1],
+		B = XorScheduleOf<V, W>::value.op[K][2]
+	};
+};
+
+// The operations of the schedule for V, one statement each (in order: the
+// elements of a braced list are evaluated left to right).  A pack expansion
+// rather than a recursion keeps the instantiations (and the compilation of
+// the 256 schedules of GF(2**8)) cheap.
+template <unsigned V, unsigned W, typename T, unsigned... K> static SIMD_INLINE void
+XorOps(T *r, std::integer_sequence<unsigned, K...>)
+{
+#ifdef	__GNUC__
+	const int sequence[] = { 0, (r[XorOp<V, W, K>::D] =
+		r[XorOp<V, W, K>::A] ^ r[XorOp<V, W, K>::B], 0)... };
+#else
+	const int sequence[] = { 0, (r[XorOp<V, W, K>::D] =
+		Xor(r[XorOp<V, W, K>::A], r[XorOp<V, W, K>::B]), 0)... };
+#endif
+	(void)sequence;
+}
+
+// d[i] += (V * s)[i] for the W hyperwords (of one or more Elements side by
+// side) in d and s.
+template <unsigned V, unsigned W = ELEMENT_WIDTH, typename T> static SIMD_INLINE void
+XorMultAdd(T *d, const T *s)
+{
+	T r[XorSchedule<W>::MaxRegs];
+	for (unsigned i = 0; i < W; i++) {
+		r[i] = d[i];
+		r[W+i] = s[i];
+	}
+	XorOps<V, W>(r, std::make_integer_sequence<unsigned,
+		XorScheduleOf<V, W>::value.nOps>());
+	for (unsigned i = 0; i < W; i++)
+		d[i] = r[i];
+}
+
+// The same with a run-time multiplier.
+#define	XOR_SCHEDULE_CASES(CASE)	\
+	CASE(0)  CASE(1)  CASE(2)  CASE(3)  CASE(4)  CASE(5)  CASE(6)  CASE(7)	\
+	CASE(8)  CASE(9)  CASE(10) CASE(11) CASE(12) CASE(13) CASE(14) CASE(15)
+
+template <typename T> static SIMD_INLINE void
+XorMultAdd(unsigned v, T *d, const T *s)
+{
+	switch (v) {
+#define	CASE(V)	case V: XorMultAdd<V>(d, s); break;
+	XOR_SCHEDULE_CASES(CASE)
+#undef	CASE
+	}
+}
+
+// The 256 multipliers of GF(2**8), as CASE(0x00) ... CASE(0xFF).
+#define	XOR_SCHEDULE_CASES16(CASE, H)	\
+	CASE(H##0) CASE(H##1) CASE(H##2) CASE(H##3) CASE(H##4) CASE(H##5) CASE(H##6) CASE(H##7) \
+	CASE(H##8) CASE(H##9) CASE(H##A) CASE(H##B) CASE(H##C) CASE(H##D) CASE(H##E) CASE(H##F)
+#define	XOR_SCHEDULE_CASES256(CASE)	\
+	XOR_SCHEDULE_CASES16(CASE, 0x0) XOR_SCHEDULE_CASES16(CASE, 0x1)	\
+	XOR_SCHEDULE_CASES16(CASE, 0x2) XOR_SCHEDULE_CASES16(CASE, 0x3)	\
+	XOR_SCHEDULE_CASES16(CASE, 0x4) XOR_SCHEDULE_CASES16(CASE, 0x5)	\
+	XOR_SCHEDULE_CASES16(CASE, 0x6) XOR_SCHEDULE_CASES16(CASE, 0x7)	\
+	XOR_SCHEDULE_CASES16(CASE, 0x8) XOR_SCHEDULE_CASES16(CASE, 0x9)	\
+	XOR_SCHEDULE_CASES16(CASE, 0xA) XOR_SCHEDULE_CASES16(CASE, 0xB)	\
+	XOR_SCHEDULE_CASES16(CASE, 0xC) XOR_SCHEDULE_CASES16(CASE, 0xD)	\
+	XOR_SCHEDULE_CASES16(CASE, 0xE) XOR_SCHEDULE_CASES16(CASE, 0xF)
+
+} // namespace HoloStor
+#endif	// HOLOSTOR_HOLOSTORLIB_XORSCHEDULE_HPP_
@@ -36,6 +36,7 @@
 //
 #include "Session.hpp"
 #include "SessionTable.hpp"
+#include "Workers.h"
 //
 static const char Copyright[] = " HoloStor " HOLOSTOR_VERSION
 	" Copyright (C) 2003-2011 Thomas P. Scott and Myron Zimmerman ";
@@ -45,27 +46,80 @@ static const void *CopyrightUse = ((void)CopyrightUse, Copyright);
 namespace HoloStor {
 
 unsigned int CpuType = CPU_UNKNOWN;
+unsigned int CpuFeatures = 0;
+unsigned int CacheSize = 0;				// unknown
+unsigned int PrefetchDistance = DefaultPrefetchDistance;
+unsigned int Threads = 1;				// see HoloStor_SetThreads()
 
-// Get the CPU Type (using assembly language assist).
-unsigned int
-GetCpuType(){
-	unsigned int i;			// EDX extended feature flags
+// Execute CPUID for the given leaf and sub-leaf, returning EAX, EBX, ECX
+// and EDX in regs[0..3].
+static void
+CpuId(unsigned int leaf, unsigned int regs[4], unsigned int subleaf = 0){
+	unsigned int a, b, c, d;
 #ifdef	_MSC_VER
 	__asm {
-		xor		ebx,ebx		// Touch other registers used by CPUID so
-		xor		ecx,ecx		// that the compiler knows side effects
-		mov		eax,1
+		mov		eax,leaf
+		mov		ecx,subleaf
 		cpuid
-		mov		i,edx
+		mov		a,eax
+		mov		b,ebx
+		mov		c,ecx
+		mov		d,edx
 	}
 #else	// !_MSC_VER	(GCC)
 	__asm__ __volatile__(
-		"movl	$1,%%eax\n\t"
 		"cpuid"
-		: "=d" (i) : : "eax","ebx","ecx"
+		: "=a" (a), "=b" (b), "=c" (c), "=d" (d) : "a" (leaf), "c" (subleaf)
 	);
 #endif // _MSC_VER
-	// First check for SSE2 feature bit (bit 26 in EDX)
+	regs[0] = a; regs[1] = b; regs[2] = c; regs[3] = d;
+}
+
+// Return the low word of XCR0, which tells which register state the OS
+// saves on a context switch.  Only valid if CPUID reports OSXSAVE.
+static unsigned int
+XGetBv0(){
+	unsigned int a;
+#ifdef	_MSC_VER
+	__asm {
+		xor		ecx,ecx
+		_emit	0x0F
+		_emit	0x01
+		_emit	0xD0		// xgetbv -- not an instruction on VC 2008
+		mov		a,eax
+	}
+#else	// !_MSC_VER	(GCC)
+	unsigned int d;
+	__asm__ __volatile__(
+		"xgetbv"
+		: "=a" (a), "=d" (d) : "c" (0)
+	);
+#endif // _MSC_VER
+	return a;
+}
+
+// Get the CPU Type (using assembly language assist).
+unsigned int
+GetCpuType(){
+	unsigned int regs[4];
+	CpuId(0, regs);
+	const unsigned int nMaxLeaf = regs[0];
+	CpuId(1, regs);
+	const unsigned int i = regs[3];		// EDX feature flags
+	const unsigned int j = regs[2];		// ECX feature flags
+	// AVX2 needs CPU support (leaf 7 EBX bit 5) and the OS must save the
+	// YMM state (OSXSAVE is ECX bit 27, XCR0 bits 1 and 2).  AVX-512F
+	// (leaf 7 EBX bit 16) additionally needs the opmask and ZMM state
+	// (XCR0 bits 5, 6 and 7).
+	if (nMaxLeaf >= 7 && (j&(1<<27)) != 0) {
+		const unsigned int xcr0 = XGetBv0();
+		CpuId(7, regs);
+		if ((regs[1]&(1<<16)) != 0 && (xcr0&0xE6) == 0xE6)
+			return CPU_AVX512;
+		if ((regs[1]&(1<<5)) != 0 && (xcr0&0x6) == 0x6)
+			return CPU_AVX2;
+	}
+	// Then check for SSE2 feature bit (bit 26 in EDX)
 	if ((i&(1<<26)) != 0)
 		return CPU_SSE2;
 	// If not, then check for MMX feature bit (bit 23)
@@ -74,13 +128,62 @@ GetCpuType(){
 	return CPU_STD;
 }
 
+// Get the CPU features (CPU_FEATURE_*) beyond those of the CPU Type.
+unsigned int
+GetCpuFeatures(){
+	unsigned int regs[4];
+	unsigned int features = 0;
+	CpuId(0, regs);
+	const unsigned int nMaxLeaf = regs[0];
+	CpuId(1, regs);
+	if ((regs[2]&(1<<9)) != 0)			// SSSE3 is ECX bit 9
+		features |= CPU_FEATURE_SSSE3;
+	if (nMaxLeaf >= 7) {
+		CpuId(7, regs);
+		if ((regs[1]&(1<<30)) != 0)		// AVX-512BW is leaf 7 EBX bit 30
+			features |= CPU_FEATURE_AVX512BW;
+	}
+	return features;
+}
+
+// Get the size in bytes of the L2 cache of a core, from the deterministic
+// cache parameters (CPUID leaf 4, Intel) or else the L2 descriptor (leaf
+// 0x80000006, AMD).
+unsigned int
+GetCacheSize(){
+	unsigned int regs[4];
+	CpuId(0, regs);
+	if (regs[0] >= 4) {
+		for (unsigned int i = 0; ; i++) {
+			CpuId(4, regs, i);
+			const unsigned int type = regs[0]&0x1F;		// 2 is instruction
+			if (type == 0)
+				break;								// no more caches
+			if (type != 2 && ((regs[0]>>5)&0x7) == 2)
+				return ((regs[1]>>22) + 1)			// ways
+					* (((regs[1]>>12)&0x3FF) + 1)	// partitions
+					* ((regs[1]&0xFFF) + 1)			// line size
+					* (regs[2] + 1);				// sets
+		}
+	}
+	CpuId(0x80000000, regs);
+	if (regs[0] >= 0x80000006) {
+		CpuId(0x80000006, regs);
+		if ((regs[2]>>16) != 0)
+			return (regs[2]>>16)*1024;				// ECX[31:16] in KB
+	}
+	return DefaultCacheSize;
+}
+
 /*
  * To avoid reliance on the runtime system, global objects must not have
- * a constructor/destructor.  The SessionTable goes futher by being an 
- * aggregate [see the C++ ARM] so that it can be initialized with an
- * initializer-list.
+ * a constructor/destructor.  The SessionTable (and CodingTableCache and
+ * AsyncQueue) goes further by being an aggregate [see the C++ ARM] so that
+ * it can be initialized with an initializer-list.
  */
 SessionTable sessions = { { 0 } };
+CodingTableCache codingTables = { 0, 0 };
+AsyncQueue asyncQueue = { 0 };
 
 } // namespace HoloStor
 
@@ -91,13 +194,26 @@ HoloStor_CreateSession(
   const HOLOSTOR_CFG	*lpConfiguration
   )
 {
-	if (CpuType == CPU_UNKNOWN)
+	return HoloStor_CreateSessionEx(lpConfiguration, NULL);
+}
+
+HOLOSTORAPI HOLOSTOR_SESSION
+HoloStor_CreateSessionEx(
+  const HOLOSTOR_CFG	*lpConfiguration,
+  const HOLOSTOR_OPTIONS *lpOptions
+  )
+{
+	if (CpuType == CPU_UNKNOWN) {
 		CpuType = GetCpuType();
+		CpuFeatures = GetCpuFeatures();
+	}
+	if (CacheSize == 0)
+		CacheSize = GetCacheSize();
 
 	Session *pSession = new Session;
 	if (pSession == NULL)
 		return HOLOSTOR_STATUS_NO_MEMORY;
-	int eStatus = pSession->SessionInit(lpConfiguration);
+	int eStatus = pSession->SessionInit(lpConfiguration, lpOptions);
 	if (eStatus != HOLOSTOR_STATUS_SUCCESS) {
 		delete pSession;
 		return eStatus;
@@ -113,11 +229,9 @@ HoloStor_CloseSession(
   IN HOLOSTOR_SESSION	hSession
   )
 {
-	Session *pSession = sessions.remove(hSession);
-	if (pSession == NULL)
+	if (!sessions.remove(hSession))
 		return HOLOSTOR_STATUS_BAD_SESSION;
-	delete pSession;
-	return HOLOSTOR_STATUS_SUCCESS;
+	return HOLOSTOR_STATUS_SUCCESS;				// deleted by its last user
 }
 
 HOLOSTORAPI INT
@@ -126,11 +240,10 @@ HoloStor_Encode(
   IN OUT PVOID *	lpBlockGroup	// IN Data; OUT all ECC
   )
 {
-	Session *pSession = sessions.lookup(hSession);
-	if (pSession == NULL)
+	SessionRef pSession(hSession);
+	if (pSession.isNull())
 		return HOLOSTOR_STATUS_BAD_SESSION;
-	return pSession->
-		Rebuild(pSession->uEccBlockMask(), (UCHAR**)lpBlockGroup, -1);
+	return pSession->Encode((UCHAR**)lpBlockGroup);
 }
 
 HOLOSTORAPI INT
@@ -140,11 +253,11 @@ HoloStor_Decode(
   IN UINT		uInvalidBlockMask	// Mask of buffers with invalid data
   )
 {
-	Session *pSession = sessions.lookup(hSession);
-	if (pSession == NULL)
+	SessionRef pSession(hSession);
+	if (pSession.isNull())
 		return HOLOSTOR_STATUS_BAD_SESSION;
 	return pSession->
-		Rebuild(uInvalidBlockMask, (UCHAR**)lpBlockGroup, -1);
+		Rebuild(&uInvalidBlockMask, 1, (UCHAR**)lpBlockGroup, -1);
 }
 
 HOLOSTORAPI INT
@@ -155,11 +268,38 @@ HoloStor_Rebuild(
   IN INT		lWhichBlock			// Block index to rebuild (-1 all)
   )
 {
-	Session *pSession = sessions.lookup(hSession);
-	if (pSession == NULL)
+	SessionRef pSession(hSession);
+	if (pSession.isNull())
 		return HOLOSTOR_STATUS_BAD_SESSION;
 	return pSession->
-		Rebuild(uInvalidBlockMask, (UCHAR**)lpBlockGroup, lWhichBlock);
+		Rebuild(&uInvalidBlockMask, 1, (UCHAR**)lpBlockGroup, lWhichBlock);
+}
+
+HOLOSTORAPI INT
+HoloStor_DecodeEx(
+  IN HOLOSTOR_SESSION	hSession,
+  IN OUT PVOID *	lpBlockGroup,	// IN Data & ECC; OUT missing data
+  IN const UINT*	lpInvalidBlockMask	// Mask of buffers with invalid data
+  )
+{
+	return HoloStor_RebuildEx(hSession, lpBlockGroup, lpInvalidBlockMask, -1);
+}
+
+HOLOSTORAPI INT
+HoloStor_RebuildEx(
+  IN HOLOSTOR_SESSION	hSession,
+  IN OUT PVOID *	lpBlockGroup, 	// IN Data & ECC; OUT as specified
+  IN const UINT*	lpInvalidBlockMask,	// Mask of buffers with invalid data
+  IN INT		lWhichBlock			// Block index to rebuild (-1 all)
+  )
+{
+	SessionRef pSession(hSession);
+	if (pSession.isNull())
+		return HOLOSTOR_STATUS_BAD_SESSION;
+	if (lpInvalidBlockMask == NULL)
+		return HOLOSTOR_STATUS_INVALID_PARAMETER;
+	return pSession->Rebuild(lpInvalidBlockMask, (pSession->nBlocks()+31)/32,
+							 (UCHAR**)lpBlockGroup, lWhichBlock);
 }
 
 HOLOSTORAPI INT
@@ -170,8 +310,8 @@ HoloStor_WriteDelta(
   OUT void *		lpDeltaBlock		// Delta for forwarding to ECC's
   )
 {
-	Session *pSession = sessions.lookup(hSession);
-	if (pSession == NULL)
+	SessionRef pSession(hSession);
+	if (pSession.isNull())
 		return HOLOSTOR_STATUS_BAD_SESSION;
 	return pSession->WriteDelta((const UCHAR*)lpDataBlockOld,
 								(const UCHAR*)lpDataBlockNew,
@@ -188,14 +328,261 @@ HoloStor_EncodeDelta(
   OUT void *		lpEccBlockNew		// Returned new ECC block
   )
 {
-	Session *pSession = sessions.lookup(hSession);
-	if (pSession == NULL)
+	SessionRef pSession(hSession);
+	if (pSession.isNull())
 		return HOLOSTOR_STATUS_BAD_SESSION;
 	return pSession->EncodeDelta(lDataIndex, (const UCHAR*)lpDeltaBlock,
 								 lEccIndex,  (const UCHAR*)lpEccBlockOld,
 								                   (UCHAR*)lpEccBlockNew);
 }
 
+HOLOSTORAPI INT
+HoloStor_EncodeRange(
+  IN HOLOSTOR_SESSION	hSession,
+  IN OUT PVOID *	lpBlockGroup,	// IN Data; OUT all ECC
+  IN UINT		lOffset,			// Byte offset of the range in each block
+  IN UINT		lLength				// Bytes in the range
+  )
+{
+	SessionRef pSession(hSession);
+	if (pSession.isNull())
+		return HOLOSTOR_STATUS_BAD_SESSION;
+	if (lLength == 0)					// 0 is the whole block to Session
+		return HOLOSTOR_STATUS_INVALID_PARAMETER;
+	return pSession->Encode((UCHAR**)lpBlockGroup, lOffset, lLength);
+}
+
+HOLOSTORAPI INT
+HoloStor_DecodeRange(
+  IN HOLOSTOR_SESSION	hSession,
+  IN OUT PVOID *	lpBlockGroup,	// IN Data & ECC; OUT missing data
+  IN const UINT*	lpInvalidBlockMask,	// Mask of buffers with invalid data
+  IN UINT		lOffset,			// Byte offset of the range in each block
+  IN UINT		lLength				// Bytes in the range
+  )
+{
+	return HoloStor_RebuildRange(hSession, lpBlockGroup, lpInvalidBlockMask, -1,
+								 lOffset, lLength);
+}
+
+HOLOSTORAPI INT
+HoloStor_RebuildRange(
+  IN HOLOSTOR_SESSION	hSession,
+  IN OUT PVOID *	lpBlockGroup, 	// IN Data & ECC; OUT as specified
+  IN const UINT*	lpInvalidBlockMask,	// Mask of buffers with invalid data
+  IN INT		lWhichBlock,		// Block index to rebuild (-1 all)
+  IN UINT		lOffset,			// Byte offset of the range in each block
+  IN UINT		lLength				// Bytes in the range
+  )
+{
+	SessionRef pSession(hSession);
+	if (pSession.isNull())
+		return HOLOSTOR_STATUS_BAD_SESSION;
+	if (lpInvalidBlockMask == NULL || lLength == 0)
+		return HOLOSTOR_STATUS_INVALID_PARAMETER;
+	return pSession->Rebuild(lpInvalidBlockMask, (pSession->nBlocks()+31)/32,
+							 (UCHAR**)lpBlockGroup, lWhichBlock, lOffset, lLength);
+}
+
+HOLOSTORAPI INT
+HoloStor_WriteDeltaRange(
+  IN HOLOSTOR_SESSION	hSession,
+  IN const void *	lpDataBlockOld,		// Data block before updating
+  IN const void *	lpDataBlockNew,		// New contents of the data block
+  OUT void *		lpDeltaBlock,		// Delta for forwarding to ECC's
+  IN UINT			lOffset,			// Byte offset of the range in each block
+  IN UINT			lLength				// Bytes in the range
+  )
+{
+	SessionRef pSession(hSession);
+	if (pSession.isNull())
+		return HOLOSTOR_STATUS_BAD_SESSION;
+	if (lLength == 0)
+		return HOLOSTOR_STATUS_INVALID_PARAMETER;
+	return pSession->WriteDelta((const UCHAR*)lpDataBlockOld,
+								(const UCHAR*)lpDataBlockNew,
+								      (UCHAR*)lpDeltaBlock, lOffset, lLength);
+}
+
+HOLOSTORAPI INT
+HoloStor_EncodeDeltaRange(
+  IN HOLOSTOR_SESSION	hSession,
+  IN UINT			lDataIndex,			// Data block index of delta
+  IN const void *	lpDeltaBlock,		// Forwarded data delta
+  IN UINT			lEccIndex,			// ECC block index being updated
+  IN const void *	lpEccBlockOld,		// Old ECC block
+  OUT void *		lpEccBlockNew,		// Returned new ECC block
+  IN UINT			lOffset,			// Byte offset of the range in each block
+  IN UINT			lLength				// Bytes in the range
+  )
+{
+	SessionRef pSession(hSession);
+	if (pSession.isNull())
+		return HOLOSTOR_STATUS_BAD_SESSION;
+	if (lLength == 0)
+		return HOLOSTOR_STATUS_INVALID_PARAMETER;
+	return pSession->EncodeDelta(lDataIndex, (const UCHAR*)lpDeltaBlock,
+								 lEccIndex,  (const UCHAR*)lpEccBlockOld,
+								                   (UCHAR*)lpEccBlockNew,
+								 lOffset, lLength);
+}
+
+HOLOSTORAPI INT
+HoloStor_EncodeBatch(
+  IN HOLOSTOR_SESSION	hSession,
+  IN OUT PVOID **	lpBlockGroups,	// IN Data; OUT all ECC (each stripe)
+  IN UINT		nGroups				// Stripes in the batch
+  )
+{
+	SessionRef pSession(hSession);
+	if (pSession.isNull())
+		return HOLOSTOR_STATUS_BAD_SESSION;
+	if (lpBlockGroups == NULL && nGroups != 0)
+		return HOLOSTOR_STATUS_INVALID_PARAMETER;
+	return pSession->EncodeBatch((UCHAR***)lpBlockGroups, nGroups);
+}
+
+HOLOSTORAPI INT
+HoloStor_DecodeBatch(
+  IN HOLOSTOR_SESSION	hSession,
+  IN OUT PVOID **	lpBlockGroups,	// IN Data & ECC; OUT missing data
+  IN const UINT*	lpInvalidBlockMasks,	// Masks of invalid buffers
+  IN UINT		nGroups				// Stripes in the batch
+  )
+{
+	SessionRef pSession(hSession);
+	if (pSession.isNull())
+		return HOLOSTOR_STATUS_BAD_SESSION;
+	if ((lpBlockGroups == NULL || lpInvalidBlockMasks == NULL) && nGroups != 0)
+		return HOLOSTOR_STATUS_INVALID_PARAMETER;
+	return pSession->RebuildBatch(lpInvalidBlockMasks, (pSession->nBlocks()+31)/32,
+								  (UCHAR***)lpBlockGroups, nGroups);
+}
+
+HOLOSTORAPI INT
+HoloStor_OpenQueue(
+  IN HOLOSTOR_SESSION	hSession,
+  IN UINT			nEntries			// Calls in flight at most
+  )
+{
+	SessionRef pSession(hSession);
+	if (pSession.isNull())
+		return HOLOSTOR_STATUS_BAD_SESSION;
+	return pSession->OpenQueue(nEntries);
+}
+
+HOLOSTORAPI INT
+HoloStor_SubmitEncode(
+  IN HOLOSTOR_SESSION	hSession,
+  IN OUT PVOID *	lpBlockGroup,	// IN Data; OUT all ECC
+  IN PVOID			lpContext		// Returned with the completion
+  )
+{
+	AsyncRequest *pRequest = new AsyncRequest;
+	if (pRequest != NULL) {
+		pRequest->op = AsyncRequest::Encode;
+		pRequest->lpContext = lpContext;
+		pRequest->lpBlockGroup = (UCHAR**)lpBlockGroup;
+	}
+	return asyncQueue.submit(hSession, pRequest);
+}
+
+HOLOSTORAPI INT
+HoloStor_SubmitDecode(
+  IN HOLOSTOR_SESSION	hSession,
+  IN OUT PVOID *	lpBlockGroup,	// IN Data & ECC; OUT missing data
+  IN const UINT*	lpInvalidBlockMask,	// Mask of buffers with invalid data
+  IN PVOID			lpContext		// Returned with the completion
+  )
+{
+	return HoloStor_SubmitRebuild(hSession, lpBlockGroup, lpInvalidBlockMask, -1,
+								  lpContext);
+}
+
+HOLOSTORAPI INT
+HoloStor_SubmitRebuild(
+  IN HOLOSTOR_SESSION	hSession,
+  IN OUT PVOID *	lpBlockGroup, 	// IN Data & ECC; OUT as specified
+  IN const UINT*	lpInvalidBlockMask,	// Mask of buffers with invalid data
+  IN INT		lWhichBlock,		// Block index to rebuild (-1 all)
+  IN PVOID			lpContext		// Returned with the completion
+  )
+{
+	if (lpInvalidBlockMask == NULL)
+		return HOLOSTOR_STATUS_INVALID_PARAMETER;
+	UINT nMaskWords;
+	{
+		SessionRef pSession(hSession);
+		if (pSession.isNull())
+			return HOLOSTOR_STATUS_BAD_SESSION;
+		nMaskWords = (pSession->nBlocks()+31)/32;
+	}
+	AsyncRequest *pRequest = new AsyncRequest;
+	if (pRequest != NULL) {
+		pRequest->op = AsyncRequest::Rebuild;
+		pRequest->lpContext = lpContext;
+		pRequest->lpBlockGroup = (UCHAR**)lpBlockGroup;
+		for (UINT w = 0; w < nMaskWords; w++)
+			pRequest->uInvalidBlockMask[w] = lpInvalidBlockMask[w];
+		pRequest->lWhichBlock = lWhichBlock;
+	}
+	return asyncQueue.submit(hSession, pRequest);
+}
+
+HOLOSTORAPI INT
+HoloStor_SubmitEncodeDelta(
+  IN HOLOSTOR_SESSION	hSession,
+  IN UINT			lDataIndex,			// Data block index of delta
+  IN const void *	lpDeltaBlock,		// Forwarded data delta
+  IN UINT			lEccIndex,			// ECC block index being updated
+  IN const void *	lpEccBlockOld,		// Old ECC block
+  OUT void *		lpEccBlockNew,		// Returned new ECC block
+  IN PVOID			lpContext			// Returned with the completion
+  )
+{
+	AsyncRequest *pRequest = new AsyncRequest;
+	if (pRequest != NULL) {
+		pRequest->op = AsyncRequest::EncodeDelta;
+		pRequest->lpContext = lpContext;
+		pRequest->lDataIndex = lDataIndex;
+		pRequest->lpDeltaBlock = (const UCHAR*)lpDeltaBlock;
+		pRequest->lEccIndex = lEccIndex;
+		pRequest->lpEccBlockOld = (const UCHAR*)lpEccBlockOld;
+		pRequest->lpEccBlockNew = (UCHAR*)lpEccBlockNew;
+	}
+	return asyncQueue.submit(hSession, pRequest);
+}
+
+HOLOSTORAPI INT
+HoloStor_Reap(
+  IN HOLOSTOR_SESSION	hSession,
+  OUT HOLOSTOR_COMPLETION* lpCompletions,	// Completions taken
+  IN UINT			nMax				// Size of lpCompletions
+  )
+{
+	SessionRef pSession(hSession);
+	if (pSession.isNull())
+		return HOLOSTOR_STATUS_BAD_SESSION;
+	if (lpCompletions == NULL && nMax != 0)
+		return HOLOSTOR_STATUS_INVALID_PARAMETER;
+	SessionQueue *pQueue = pSession->Queue();
+	if (pQueue == NULL)
+		return HOLOSTOR_STATUS_INVALID_PARAMETER;	// not opened
+	return pQueue->reap(lpCompletions, nMax);
+}
+
+HOLOSTORAPI INT
+HoloStor_Warmup(
+  IN HOLOSTOR_SESSION	hSession,
+  IN UINT			nFaults				// Invalid blocks to be ready for
+  )
+{
+	SessionRef pSession(hSession);
+	if (pSession.isNull())
+		return HOLOSTOR_STATUS_BAD_SESSION;
+	return pSession->Warmup(nFaults);
+}
+
 HOLOSTORAPI INT
 HoloStor_SetMethod(
   IN OUT UINT* pMethod
@@ -203,10 +590,40 @@ HoloStor_SetMethod(
 {
 	if (pMethod == NULL)
 		return HOLOSTOR_STATUS_INVALID_PARAMETER;
-	if (CpuType == CPU_UNKNOWN)
+	if (CpuType == CPU_UNKNOWN) {
 		CpuType = GetCpuType();
+		CpuFeatures = GetCpuFeatures();
+	}
 	if (*pMethod < CpuType)
 		CpuType = *pMethod;			// limit support
 	*pMethod = CpuType;
 	return HOLOSTOR_STATUS_SUCCESS;
 }
+
+HOLOSTORAPI INT
+HoloStor_SetPrefetch(
+  IN OUT UINT* pDistance
+  )
+{
+	if (pDistance == NULL)
+		return HOLOSTOR_STATUS_INVALID_PARAMETER;
+	UINT distance = *pDistance;
+	if (distance > MaxPrefetchDistance)
+		distance = MaxPrefetchDistance;
+	distance -= distance % sizeof(Element);		// whole Elements
+	PrefetchDistance = distance;
+	*pDistance = PrefetchDistance;
+	return HOLOSTOR_STATUS_SUCCESS;
+}
+
+HOLOSTORAPI INT
+HoloStor_SetThreads(
+  IN OUT UINT* pThreads
+  )
+{
+	if (pThreads == NULL)
+		return HOLOSTOR_STATUS_INVALID_PARAMETER;
+	Threads = HoloStor_SetWorkers(*pThreads);
+	*pThreads = Threads;
+	return HOLOSTOR_STATUS_SUCCESS;
+}
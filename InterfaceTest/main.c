@@ -36,7 +36,7 @@
 #else // !__KERNEL__
 #include <stdio.h>
 #include <malloc.h>
-#include <string.h>			// for memset()
+#include <string.h>			// for memset(), memcpy()
 #include <stdlib.h>			// for abort() & rand()
 #include <assert.h>			// for assert()
 #endif // __KERNEL__
@@ -365,6 +365,7 @@ test0(void)
 	char moniker[] = "test0";
 	int ret;
 	HOLOSTOR_CFG cfg;
+	HOLOSTOR_OPTIONS opts;
 	HOLOSTOR_SESSION hSession;
 	//
 	cfg.BlockSize = nMinBlockSize;	// valid small configuration values
@@ -396,7 +397,7 @@ test0(void)
 
 	cfg.BlockSize = nMinBlockSize;	// OK
 	cfg.DataBlocks = 1;				// OK
-	cfg.EccBlocks = 5;				// too large
+	cfg.EccBlocks = 9;				// too large
 	//
 	hSession = HoloStor_CreateSession(&cfg);
 	report(moniker, "4 HoloStor_CreateSession", hSession, HOLOSTOR_STATUS_BAD_CONFIGURATION);
@@ -414,7 +415,7 @@ test0(void)
 
 	cfg.BlockSize = nMinBlockSize;	// OK
 	cfg.DataBlocks = 1;				// OK
-	cfg.EccBlocks = 5;				// too big: K>4
+	cfg.EccBlocks = 9;				// too big: K>8
 	//
 	hSession = HoloStor_CreateSession(&cfg);
 	report(moniker, "6 HoloStor_CreateSession", hSession, HOLOSTOR_STATUS_BAD_CONFIGURATION);
@@ -429,6 +430,131 @@ test0(void)
 	report(moniker, "7 HoloStor_CreateSession", hSession, HOLOSTOR_STATUS_BAD_CONFIGURATION);
 	ret = HoloStor_CloseSession(hSession);
 	report(moniker, "7 HoloStor_CloseSession", ret, HOLOSTOR_STATUS_BAD_SESSION);
+
+	cfg.BlockSize = nMinBlockSize;	// OK
+	cfg.DataBlocks = 1;				// OK
+	cfg.EccBlocks = 1;				// OK
+	opts.Size = sizeof(opts);
+	opts.Flags = ~HOLOSTOR_FLAGS_VALID;	// unknown options
+	//
+	hSession = HoloStor_CreateSessionEx(&cfg, &opts);
+	report(moniker, "8 HoloStor_CreateSessionEx", hSession, HOLOSTOR_STATUS_BAD_CONFIGURATION);
+	ret = HoloStor_CloseSession(hSession);
+	report(moniker, "8 HoloStor_CloseSession", ret, HOLOSTOR_STATUS_BAD_SESSION);
+
+	cfg.BlockSize = nMinBlockSize;	// OK
+	cfg.DataBlocks = 1;				// OK
+	cfg.EccBlocks = 1;				// OK
+	opts.Flags = HOLOSTOR_FLAG_NONTEMPORAL;	// OK
+	//
+	hSession = HoloStor_CreateSessionEx(&cfg, &opts);
+	report(moniker, "9 HoloStor_CreateSessionEx", hSession, HOLOSTOR_STATUS_SUCCESS);
+	ret = HoloStor_CloseSession(hSession);
+	report(moniker, "9 HoloStor_CloseSession", ret, HOLOSTOR_STATUS_SUCCESS);
+
+	opts.Flags = HOLOSTOR_FLAG_METHOD;	// OK
+	opts.Method = ~0u;				// OK: no limit at all
+	//
+	hSession = HoloStor_CreateSessionEx(&cfg, &opts);
+	report(moniker, "11 HoloStor_CreateSessionEx", hSession, HOLOSTOR_STATUS_SUCCESS);
+	ret = HoloStor_CloseSession(hSession);
+	report(moniker, "11 HoloStor_CloseSession", ret, HOLOSTOR_STATUS_SUCCESS);
+
+	cfg.BlockSize = nMinBlockSize;	// OK
+	cfg.DataBlocks = 16;			// OK: N+K<=255 over GF(2**8)
+	cfg.EccBlocks = 4;
+	opts.Flags = HOLOSTOR_FLAG_GF256;
+	//
+	hSession = HoloStor_CreateSessionEx(&cfg, &opts);
+	report(moniker, "12 HoloStor_CreateSessionEx", hSession, HOLOSTOR_STATUS_SUCCESS);
+	ret = HoloStor_CloseSession(hSession);
+	report(moniker, "12 HoloStor_CloseSession", ret, HOLOSTOR_STATUS_SUCCESS);
+
+	cfg.DataBlocks = 252;			// too big: N+K>255
+	cfg.EccBlocks = 4;
+	//
+	hSession = HoloStor_CreateSessionEx(&cfg, &opts);
+	report(moniker, "13 HoloStor_CreateSessionEx", hSession, HOLOSTOR_STATUS_BAD_CONFIGURATION);
+	ret = HoloStor_CloseSession(hSession);
+	report(moniker, "13 HoloStor_CloseSession", ret, HOLOSTOR_STATUS_BAD_SESSION);
+
+	cfg.DataBlocks = 16;			// OK
+	cfg.EccBlocks = 4;				// OK
+	opts.Flags = HOLOSTOR_FLAG_BITSLICED;	// needs HOLOSTOR_FLAG_GF256
+	//
+	hSession = HoloStor_CreateSessionEx(&cfg, &opts);
+	report(moniker, "14 HoloStor_CreateSessionEx", hSession, HOLOSTOR_STATUS_BAD_CONFIGURATION);
+	ret = HoloStor_CloseSession(hSession);
+	report(moniker, "14 HoloStor_CloseSession", ret, HOLOSTOR_STATUS_BAD_SESSION);
+
+	cfg.BlockSize = 3*nMinBlockSize/2;	// not whole slices
+	opts.Flags = HOLOSTOR_FLAG_GF256|HOLOSTOR_FLAG_BITSLICED;
+	//
+	hSession = HoloStor_CreateSessionEx(&cfg, &opts);
+	report(moniker, "15 HoloStor_CreateSessionEx", hSession, HOLOSTOR_STATUS_BAD_CONFIGURATION);
+	ret = HoloStor_CloseSession(hSession);
+	report(moniker, "15 HoloStor_CloseSession", ret, HOLOSTOR_STATUS_BAD_SESSION);
+
+	cfg.BlockSize = nMinBlockSize;	// OK
+	cfg.DataBlocks = 9;				// OK: N+K<=17
+	cfg.EccBlocks = 8;				// OK: K<=8
+	//
+	hSession = HoloStor_CreateSession(&cfg);
+	report(moniker, "16 HoloStor_CreateSession", hSession, HOLOSTOR_STATUS_SUCCESS);
+	ret = HoloStor_CloseSession(hSession);
+	report(moniker, "16 HoloStor_CloseSession", ret, HOLOSTOR_STATUS_SUCCESS);
+
+	cfg.DataBlocks = 200;			// too big: too many recovery matrices
+	cfg.EccBlocks = 8;
+	opts.Flags = HOLOSTOR_FLAG_GF256;
+	//
+	hSession = HoloStor_CreateSessionEx(&cfg, &opts);
+	report(moniker, "17 HoloStor_CreateSessionEx", hSession, HOLOSTOR_STATUS_BAD_CONFIGURATION);
+	ret = HoloStor_CloseSession(hSession);
+	report(moniker, "17 HoloStor_CloseSession", ret, HOLOSTOR_STATUS_BAD_SESSION);
+
+	cfg.DataBlocks = 9;				// OK
+	cfg.EccBlocks = 8;				// OK
+	opts.Flags = HOLOSTOR_FLAG_LAZY;
+	//
+	hSession = HoloStor_CreateSessionEx(&cfg, &opts);
+	report(moniker, "18 HoloStor_CreateSessionEx", hSession, HOLOSTOR_STATUS_SUCCESS);
+	ret = HoloStor_Warmup(hSession, 1);
+	report(moniker, "18 HoloStor_Warmup", ret, HOLOSTOR_STATUS_SUCCESS);
+	ret = HoloStor_Warmup(hSession, 100);	// OK: as many as EccBlocks
+	report(moniker, "18 HoloStor_Warmup", ret, HOLOSTOR_STATUS_SUCCESS);
+	ret = HoloStor_CloseSession(hSession);
+	report(moniker, "18 HoloStor_CloseSession", ret, HOLOSTOR_STATUS_SUCCESS);
+	ret = HoloStor_Warmup(hSession, 1);
+	report(moniker, "18 HoloStor_Warmup", ret, HOLOSTOR_STATUS_BAD_SESSION);
+
+	cfg.DataBlocks = 1;				// OK
+	cfg.EccBlocks = 1;				// OK
+	opts.Size = 0;					// too small
+	//
+	hSession = HoloStor_CreateSessionEx(&cfg, &opts);
+	report(moniker, "19 HoloStor_CreateSessionEx", hSession, HOLOSTOR_STATUS_BAD_CONFIGURATION);
+
+	opts.Size = sizeof(opts) + 4;	// too big: beyond those known
+	//
+	hSession = HoloStor_CreateSessionEx(&cfg, &opts);
+	report(moniker, "20 HoloStor_CreateSessionEx", hSession, HOLOSTOR_STATUS_BAD_CONFIGURATION);
+
+	opts.Size = sizeof(opts.Size);	// OK: Flags taken as 0
+	opts.Flags = ~HOLOSTOR_FLAGS_VALID;
+	//
+	hSession = HoloStor_CreateSessionEx(&cfg, &opts);
+	report(moniker, "21 HoloStor_CreateSessionEx", hSession, HOLOSTOR_STATUS_SUCCESS);
+	ret = HoloStor_CloseSession(hSession);
+	report(moniker, "21 HoloStor_CloseSession", ret, HOLOSTOR_STATUS_SUCCESS);
+
+	hSession = HoloStor_CreateSessionEx(&cfg, NULL);	// OK: the defaults
+	report(moniker, "22 HoloStor_CreateSessionEx", hSession, HOLOSTOR_STATUS_SUCCESS);
+	ret = HoloStor_CloseSession(hSession);
+	report(moniker, "22 HoloStor_CloseSession", ret, HOLOSTOR_STATUS_SUCCESS);
+
+	ret = HoloStor_SetPrefetch(NULL);
+	report(moniker, "10 HoloStor_SetPrefetch", ret, HOLOSTOR_STATUS_INVALID_PARAMETER);
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -468,6 +594,12 @@ test1(void){
 	// Bad lWhichBlock
 	ret = HoloStor_Rebuild(hSession, (PVOID*)BlockGroup, 0,  2);
 	report(moniker, "2 HoloStor_Rebuild", ret, HOLOSTOR_STATUS_INVALID_PARAMETER);
+	// lWhichBlock not among the invalid blocks is zeroed
+	FillOne(BlockGroup[1], JunkFill, &cfg);
+	ret = HoloStor_Rebuild(hSession, (PVOID*)BlockGroup, 1<<0, 1);
+	report(moniker, "3 HoloStor_Rebuild", ret, HOLOSTOR_STATUS_SUCCESS);
+	ret = CheckOne(BlockGroup[1], 0, &cfg);
+	report(moniker, "3 CheckOne", ret, 0);
 	// Misaligned buffers
 	ret = HoloStor_Encode(hSession, (PVOID*)BadBuffers);
 	report(moniker, "1 HoloStor_Encode", ret, HOLOSTOR_STATUS_MISALIGNED_BUFFER);
@@ -506,22 +638,26 @@ test1(void){
 //////////////////////////////////////////////////////////////////////
 
 void
-test2(void){
+test2(unsigned uFlags){
 	char moniker[] = "test2";
 	unsigned i;
 	int ret;
 	unsigned uInvalidMask;
 	HOLOSTOR_CFG cfg;
+	HOLOSTOR_OPTIONS opts;
 	HOLOSTOR_SESSION hSession;
 	char** BlockGroup;
 	//
 	cfg.BlockSize = nMinBlockSize;				// smallest supported
 	cfg.DataBlocks = 3;
 	cfg.EccBlocks = 2;
+	opts.Size = sizeof(opts);
+	opts.Flags = uFlags;
+	opts.Method = 0;
 	BlockGroup = ppAlloc(&cfg);
 	//
-	hSession = HoloStor_CreateSession(&cfg);
-	report(moniker, "HoloStor_CreateSession", hSession, HOLOSTOR_STATUS_SUCCESS);
+	hSession = HoloStor_CreateSessionEx(&cfg, &opts);
+	report(moniker, "HoloStor_CreateSessionEx", hSession, HOLOSTOR_STATUS_SUCCESS);
 	//
 	FillAll(BlockGroup, &cfg);
 	// Zap first ECC block.
@@ -566,11 +702,12 @@ test2(void){
 //////////////////////////////////////////////////////////////////////
 
 void
-test2b(void){
+test2b(unsigned uFlags){
 	char moniker[] = "test2b";
 	unsigned i, j;
 	int ret;
 	HOLOSTOR_CFG cfg;
+	HOLOSTOR_OPTIONS opts;
 	HOLOSTOR_SESSION hSession;
 	char** BlockGroup1;
 	char** BlockGroup2;
@@ -579,12 +716,15 @@ test2b(void){
 	cfg.BlockSize = nMinBlockSize;	// smallest supported
 	cfg.DataBlocks = 3;
 	cfg.EccBlocks = 2;
+	opts.Size = sizeof(opts);
+	opts.Flags = uFlags;
+	opts.Method = 0;
 	BlockGroup1 = ppAlloc(&cfg);
 	BlockGroup2 = ppAlloc(&cfg);
 	BlockGroupX = ppAlloc(&cfg);	// for scratch
 	//
-	hSession = HoloStor_CreateSession(&cfg);
-	report(moniker, "HoloStor_CreateSession", hSession, HOLOSTOR_STATUS_SUCCESS);
+	hSession = HoloStor_CreateSessionEx(&cfg, &opts);
+	report(moniker, "HoloStor_CreateSessionEx", hSession, HOLOSTOR_STATUS_SUCCESS);
 	//
 	for (i = 0; i < cfg.DataBlocks; i++) {
 		FillAll(BlockGroup1, &cfg);
@@ -623,32 +763,733 @@ test2b(void){
 	ppFree(BlockGroupX, &cfg);
 }
 
+//////////////////////////////////////////////////////////////////////
+//
+//	Test2c - Exercise a stripe of more than 32 blocks (GF(2**8) only).
+//
+//////////////////////////////////////////////////////////////////////
+
+void
+test2c(unsigned uFlags){
+	char moniker[] = "test2c";
+	static const unsigned Zap[3] = { 0, 31, 33 };	// Data blocks to zap
+	unsigned i;
+	int ret;
+	unsigned uInvalidMask[2];
+	HOLOSTOR_CFG cfg;
+	HOLOSTOR_OPTIONS opts;
+	HOLOSTOR_SESSION hSession;
+	char** BlockGroup;
+	char *pSave;
+	//
+	cfg.BlockSize = nMinBlockSize;	// smallest supported
+	cfg.DataBlocks = 40;
+	cfg.EccBlocks = 3;
+	opts.Size = sizeof(opts);
+	opts.Flags = uFlags;
+	BlockGroup = ppAlloc(&cfg);
+	pSave = _AlignedAlloc(cfg.BlockSize, &cfg);
+	//
+	hSession = HoloStor_CreateSessionEx(&cfg, &opts);
+	report(moniker, "HoloStor_CreateSessionEx", hSession, HOLOSTOR_STATUS_SUCCESS);
+	//
+	FillAll(BlockGroup, &cfg);
+	ret = HoloStor_Encode(hSession, (PVOID*)BlockGroup);
+	report(moniker, "1 HoloStor_Encode", ret, HOLOSTOR_STATUS_SUCCESS);
+	// Zap the maximum Data blocks, on both sides of bit 32.
+	uInvalidMask[0] = uInvalidMask[1] = 0;
+	for (i = 0; i < cfg.EccBlocks; i++) {
+		FillOne(BlockGroup[Zap[i]], JunkFill, &cfg);
+		uInvalidMask[Zap[i]/32] |= (1u<<(Zap[i]%32));
+	}
+	ret = HoloStor_DecodeEx(hSession, (PVOID*)BlockGroup, uInvalidMask);
+	report(moniker, "2 HoloStor_DecodeEx", ret, HOLOSTOR_STATUS_SUCCESS);
+	ret = CheckData(BlockGroup, &cfg);
+	report(moniker, "2 CheckData", ret, 0);		// pass if Data restored
+	// Zap one too many blocks.
+	uInvalidMask[1] |= (1u<<(39%32));
+	ret = HoloStor_DecodeEx(hSession, (PVOID*)BlockGroup, uInvalidMask);
+	report(moniker, "3 HoloStor_DecodeEx", ret, HOLOSTOR_STATUS_TOO_MANY_BAD_BLOCKS);
+	// Zap the last ECC block and rebuild it alone.
+	memcpy(pSave, BlockGroup[42], cfg.BlockSize);
+	FillOne(BlockGroup[42], JunkFill, &cfg);
+	uInvalidMask[0] = 0;
+	uInvalidMask[1] = (1u<<(42%32));
+	ret = HoloStor_RebuildEx(hSession, (PVOID*)BlockGroup, uInvalidMask, 42);
+	report(moniker, "4 HoloStor_RebuildEx", ret, HOLOSTOR_STATUS_SUCCESS);
+	ret = CompareOne(BlockGroup[42], pSave, &cfg);
+	report(moniker, "4 CompareOne", ret, 0);	// pass if ECC restored
+	// A block beyond the stripe.
+	uInvalidMask[1] = (1u<<(43%32));
+	ret = HoloStor_DecodeEx(hSession, (PVOID*)BlockGroup, uInvalidMask);
+	report(moniker, "5 HoloStor_DecodeEx", ret, HOLOSTOR_STATUS_INVALID_PARAMETER);
+	//
+	ret = HoloStor_CloseSession(hSession);
+	report(moniker, "HoloStor_CloseSession", ret, HOLOSTOR_STATUS_SUCCESS);
+	//
+	_AlignedFree(pSave, &cfg);
+	ppFree(BlockGroup, &cfg);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+//	Test2d - Exercise the byte-range calls.
+//
+//////////////////////////////////////////////////////////////////////
+
+void
+test2d(unsigned uFlags){
+	char moniker[] = "test2d";
+	const unsigned nOffset = 1024, nLength = 1024;	// the range coded
+	unsigned i;
+	int ret;
+	unsigned uInvalidMask;
+	HOLOSTOR_CFG cfg;
+	HOLOSTOR_OPTIONS opts;
+	HOLOSTOR_SESSION hSession;
+	char** BlockGroup;
+	char** Expect;
+	char *pNew, *pDelta, *pEcc;
+	//
+	cfg.BlockSize = 4096;
+	cfg.DataBlocks = 6;
+	cfg.EccBlocks = 3;
+	opts.Size = sizeof(opts);
+	opts.Flags = uFlags;
+	BlockGroup = ppAlloc(&cfg);
+	Expect = ppAlloc(&cfg);
+	pNew = _AlignedAlloc(cfg.BlockSize, &cfg);
+	pDelta = _AlignedAlloc(cfg.BlockSize, &cfg);
+	pEcc = _AlignedAlloc(cfg.BlockSize, &cfg);
+	//
+	hSession = HoloStor_CreateSessionEx(&cfg, &opts);
+	report(moniker, "HoloStor_CreateSessionEx", hSession, HOLOSTOR_STATUS_SUCCESS);
+	//
+	FillAll(BlockGroup, &cfg);
+	ret = HoloStor_Encode(hSession, (PVOID*)BlockGroup);
+	report(moniker, "1 HoloStor_Encode", ret, HOLOSTOR_STATUS_SUCCESS);
+	// Overwrite the range of Data block 2 and update the ECC by deltas.
+	memcpy(pNew, BlockGroup[2], cfg.BlockSize);
+	memset(pNew+nOffset, 'x', nLength);
+	ret = HoloStor_WriteDeltaRange(hSession, BlockGroup[2], pNew, pDelta,
+								   nOffset, nLength);
+	report(moniker, "2 HoloStor_WriteDeltaRange", ret, HOLOSTOR_STATUS_SUCCESS);
+	memcpy(BlockGroup[2], pNew, cfg.BlockSize);
+	for (i = cfg.DataBlocks; i < cfg.DataBlocks+cfg.EccBlocks; i++) {
+		memcpy(pEcc, BlockGroup[i], cfg.BlockSize);
+		ret = HoloStor_EncodeDeltaRange(hSession, 2, pDelta, i, BlockGroup[i], pEcc,
+										nOffset, nLength);
+		report(moniker, "2 HoloStor_EncodeDeltaRange", ret, HOLOSTOR_STATUS_SUCCESS);
+		memcpy(BlockGroup[i], pEcc, cfg.BlockSize);
+	}
+	for (i = 0; i < cfg.DataBlocks+cfg.EccBlocks; i++)
+		memcpy(Expect[i], BlockGroup[i], cfg.BlockSize);
+	ret = HoloStor_Encode(hSession, (PVOID*)Expect);
+	report(moniker, "2 HoloStor_Encode", ret, HOLOSTOR_STATUS_SUCCESS);
+	ret = 0;
+	for (i = cfg.DataBlocks; i < cfg.DataBlocks+cfg.EccBlocks; i++)
+		ret |= CompareOne(BlockGroup[i], Expect[i], &cfg);
+	report(moniker, "2 CompareOne", ret, 0);	// pass if ECC as if encoded
+	// Trash the range of the ECC blocks and encode only it.
+	for (i = cfg.DataBlocks; i < cfg.DataBlocks+cfg.EccBlocks; i++)
+		memset(BlockGroup[i]+nOffset, JunkFill, nLength);
+	ret = HoloStor_EncodeRange(hSession, (PVOID*)BlockGroup, nOffset, nLength);
+	report(moniker, "3 HoloStor_EncodeRange", ret, HOLOSTOR_STATUS_SUCCESS);
+	ret = 0;
+	for (i = cfg.DataBlocks; i < cfg.DataBlocks+cfg.EccBlocks; i++)
+		ret |= CompareOne(BlockGroup[i], Expect[i], &cfg);
+	report(moniker, "3 CompareOne", ret, 0);	// pass if ECC restored
+	// Trash Data blocks 0 and 2 whole and decode only the range.
+	FillOne(BlockGroup[0], JunkFill, &cfg);
+	FillOne(BlockGroup[2], JunkFill, &cfg);
+	uInvalidMask = (1u<<0)|(1u<<2);
+	ret = HoloStor_DecodeRange(hSession, (PVOID*)BlockGroup, &uInvalidMask,
+							   nOffset, nLength);
+	report(moniker, "4 HoloStor_DecodeRange", ret, HOLOSTOR_STATUS_SUCCESS);
+	ret = memcmp(BlockGroup[0]+nOffset, Expect[0]+nOffset, nLength) ||
+		  memcmp(BlockGroup[2]+nOffset, Expect[2]+nOffset, nLength) ? -1 : 0;
+	report(moniker, "4 memcmp", ret, 0);		// pass if the range restored
+	memcpy(pNew, BlockGroup[0], cfg.BlockSize);
+	memset(pNew+nOffset, JunkFill, nLength);
+	ret = CheckOne(pNew, (char)JunkFill, &cfg);
+	report(moniker, "4 CheckOne", ret, 0);		// pass if the rest untouched
+	// Rebuild the range of an ECC block alone.
+	memset(BlockGroup[7]+nOffset, JunkFill, nLength);
+	uInvalidMask = (1u<<0)|(1u<<7);
+	ret = HoloStor_RebuildRange(hSession, (PVOID*)BlockGroup, &uInvalidMask, 7,
+								nOffset, nLength);
+	report(moniker, "5 HoloStor_RebuildRange", ret, HOLOSTOR_STATUS_SUCCESS);
+	ret = CompareOne(BlockGroup[7], Expect[7], &cfg);
+	report(moniker, "5 CompareOne", ret, 0);	// pass if ECC restored
+	// Bad ranges.
+	ret = HoloStor_EncodeRange(hSession, (PVOID*)BlockGroup, 32, nLength);
+	report(moniker, "6 HoloStor_EncodeRange", ret, HOLOSTOR_STATUS_INVALID_PARAMETER);
+	ret = HoloStor_EncodeRange(hSession, (PVOID*)BlockGroup, nOffset, 0);
+	report(moniker, "6 HoloStor_EncodeRange", ret, HOLOSTOR_STATUS_INVALID_PARAMETER);
+	ret = HoloStor_EncodeRange(hSession, (PVOID*)BlockGroup, nOffset, cfg.BlockSize);
+	report(moniker, "6 HoloStor_EncodeRange", ret, HOLOSTOR_STATUS_INVALID_PARAMETER);
+	ret = HoloStor_DecodeRange(hSession, (PVOID*)BlockGroup, NULL, nOffset, nLength);
+	report(moniker, "6 HoloStor_DecodeRange", ret, HOLOSTOR_STATUS_INVALID_PARAMETER);
+	ret = HoloStor_WriteDeltaRange(hSession, BlockGroup[2], pNew, pDelta,
+								   nOffset, nLength+32);
+	report(moniker, "6 HoloStor_WriteDeltaRange", ret, HOLOSTOR_STATUS_INVALID_PARAMETER);
+	ret = HoloStor_EncodeDeltaRange(hSession, 2, pDelta, 6, BlockGroup[6], pEcc,
+									~0u-511, 1024);
+	report(moniker, "6 HoloStor_EncodeDeltaRange", ret, HOLOSTOR_STATUS_INVALID_PARAMETER);
+	//
+	ret = HoloStor_CloseSession(hSession);
+	report(moniker, "HoloStor_CloseSession", ret, HOLOSTOR_STATUS_SUCCESS);
+	ret = HoloStor_EncodeRange(hSession, (PVOID*)BlockGroup, nOffset, nLength);
+	report(moniker, "7 HoloStor_EncodeRange", ret, HOLOSTOR_STATUS_BAD_SESSION);
+	//
+	_AlignedFree(pEcc, &cfg);
+	_AlignedFree(pDelta, &cfg);
+	_AlignedFree(pNew, &cfg);
+	ppFree(Expect, &cfg);
+	ppFree(BlockGroup, &cfg);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+//	Test2e - Exercise the batch calls.
+//
+//////////////////////////////////////////////////////////////////////
+
+#define	NSTRIPES	150				// more than a chunk of the library
+
+void
+test2e(unsigned uFlags){
+	char moniker[] = "test2e";
+	static const unsigned Masks[4] = {	// invalid blocks, by stripe % 4
+		0, (1u<<0), (1u<<1)|(1u<<3), (1u<<2)|(1u<<6)|(1u<<8)
+	};
+	unsigned i, s;
+	int ret;
+	unsigned uInvalidMasks[NSTRIPES];
+	HOLOSTOR_CFG cfg;
+	HOLOSTOR_OPTIONS opts;
+	HOLOSTOR_SESSION hSession;
+	char** BlockGroups[NSTRIPES];
+	char *pSave;
+	pcycles_t time, timeBatch;
+	//
+	cfg.BlockSize = nMinBlockSize;	// smallest supported
+	cfg.DataBlocks = 6;
+	cfg.EccBlocks = 3;
+	opts.Size = sizeof(opts);
+	opts.Flags = uFlags;
+	for (s = 0; s < NSTRIPES; s++) {
+		BlockGroups[s] = ppAlloc(&cfg);
+		for (i = 0; i < cfg.DataBlocks; i++)	// different in every stripe
+			FillOne(BlockGroups[s][i], (s+i)&0x7F, &cfg);
+	}
+	pSave = _AlignedAlloc(cfg.BlockSize, &cfg);
+	//
+	hSession = HoloStor_CreateSessionEx(&cfg, &opts);
+	report(moniker, "HoloStor_CreateSessionEx", hSession, HOLOSTOR_STATUS_SUCCESS);
+	//
+	ret = HoloStor_EncodeBatch(hSession, (PVOID**)BlockGroups, NSTRIPES);
+	report(moniker, "1 HoloStor_EncodeBatch", ret, HOLOSTOR_STATUS_SUCCESS);
+	memcpy(pSave, BlockGroups[NSTRIPES-1][8], cfg.BlockSize);
+	ret = HoloStor_Encode(hSession, (PVOID*)BlockGroups[NSTRIPES-1]);
+	report(moniker, "1 HoloStor_Encode", ret, HOLOSTOR_STATUS_SUCCESS);
+	ret = CompareOne(BlockGroups[NSTRIPES-1][8], pSave, &cfg);
+	report(moniker, "1 CompareOne", ret, 0);	// pass if ECC as if encoded
+	// The time of the batch against that of a call per stripe (warm cache).
+	time = PentiumCycles();
+	for (s = 0; s < NSTRIPES; s++)
+		HoloStor_Encode(hSession, (PVOID*)BlockGroups[s]);
+	time = PentiumCycles() - time;
+	timeBatch = PentiumCycles();
+	HoloStor_EncodeBatch(hSession, (PVOID**)BlockGroups, NSTRIPES);
+	timeBatch = PentiumCycles() - timeBatch;
+	printf("[Encode of %u stripes of %u+%u : %s cycles, batched %s cycles]\n",
+		NSTRIPES, cfg.DataBlocks, cfg.EccBlocks,
+		PercentE(time,1,2), PercentE(timeBatch,1,2));
+	// Zap blocks of the stripes, the same ones in every fourth.
+	for (s = 0; s < NSTRIPES; s++) {
+		uInvalidMasks[s] = Masks[s%4];
+		for (i = 0; i < cfg.DataBlocks+cfg.EccBlocks; i++)
+			if (uInvalidMasks[s] & (1u<<i))
+				FillOne(BlockGroups[s][i], JunkFill, &cfg);
+	}
+	ret = HoloStor_DecodeBatch(hSession, (PVOID**)BlockGroups, uInvalidMasks, NSTRIPES);
+	report(moniker, "2 HoloStor_DecodeBatch", ret, HOLOSTOR_STATUS_SUCCESS);
+	ret = 0;
+	for (s = 0; s < NSTRIPES; s++)
+		for (i = 0; i < cfg.DataBlocks; i++)
+			ret |= CheckOne(BlockGroups[s][i], (s+i)&0x7F, &cfg);
+	report(moniker, "2 CheckOne", ret, 0);		// pass if Data restored
+	// One stripe too many bad blocks: nothing is decoded.
+	FillOne(BlockGroups[1][0], JunkFill, &cfg);
+	uInvalidMasks[NSTRIPES-1] = (1u<<0)|(1u<<1)|(1u<<2)|(1u<<3);
+	ret = HoloStor_DecodeBatch(hSession, (PVOID**)BlockGroups, uInvalidMasks, NSTRIPES);
+	report(moniker, "3 HoloStor_DecodeBatch", ret, HOLOSTOR_STATUS_TOO_MANY_BAD_BLOCKS);
+	ret = CheckOne(BlockGroups[1][0], (char)JunkFill, &cfg);
+	report(moniker, "3 CheckOne", ret, 0);		// pass if left alone
+	uInvalidMasks[NSTRIPES-1] = (1u<<9);		// beyond the stripe
+	ret = HoloStor_DecodeBatch(hSession, (PVOID**)BlockGroups, uInvalidMasks, NSTRIPES);
+	report(moniker, "4 HoloStor_DecodeBatch", ret, HOLOSTOR_STATUS_INVALID_PARAMETER);
+	ret = HoloStor_DecodeBatch(hSession, (PVOID**)BlockGroups, NULL, NSTRIPES);
+	report(moniker, "4 HoloStor_DecodeBatch", ret, HOLOSTOR_STATUS_INVALID_PARAMETER);
+	ret = HoloStor_EncodeBatch(hSession, (PVOID**)BlockGroups, 0);
+	report(moniker, "4 HoloStor_EncodeBatch", ret, HOLOSTOR_STATUS_SUCCESS);
+	//
+	ret = HoloStor_CloseSession(hSession);
+	report(moniker, "HoloStor_CloseSession", ret, HOLOSTOR_STATUS_SUCCESS);
+	ret = HoloStor_EncodeBatch(hSession, (PVOID**)BlockGroups, NSTRIPES);
+	report(moniker, "5 HoloStor_EncodeBatch", ret, HOLOSTOR_STATUS_BAD_SESSION);
+	//
+	_AlignedFree(pSave, &cfg);
+	for (s = 0; s < NSTRIPES; s++)
+		ppFree(BlockGroups[s], &cfg);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+//	Test2f - Exercise the coding of large blocks by the worker threads.
+//
+//////////////////////////////////////////////////////////////////////
+
+void
+test2f(unsigned uFlags){
+	char moniker[] = "test2f";
+	unsigned i, threads;
+	int ret;
+	unsigned uInvalidMask;
+	HOLOSTOR_CFG cfg;
+	HOLOSTOR_OPTIONS opts;
+	HOLOSTOR_SESSION hSession;
+	char** BlockGroup;
+	char** Expect;
+	pcycles_t time, time1;
+	//
+	cfg.BlockSize = 1024*1024;		// 16 tasks of the library
+	cfg.DataBlocks = 8;
+	cfg.EccBlocks = 3;
+	opts.Size = sizeof(opts);
+	opts.Flags = uFlags;
+	BlockGroup = ppAlloc(&cfg);
+	Expect = ppAlloc(&cfg);
+	//
+	hSession = HoloStor_CreateSessionEx(&cfg, &opts);
+	report(moniker, "HoloStor_CreateSessionEx", hSession, HOLOSTOR_STATUS_SUCCESS);
+	ret = HoloStor_SetThreads(NULL);
+	report(moniker, "0 HoloStor_SetThreads", ret, HOLOSTOR_STATUS_INVALID_PARAMETER);
+	//
+	FillAll(Expect, &cfg);
+	time1 = PentiumCycles();
+	ret = HoloStor_Encode(hSession, (PVOID*)Expect);
+	time1 = PentiumCycles() - time1;
+	report(moniker, "1 HoloStor_Encode", ret, HOLOSTOR_STATUS_SUCCESS);
+	threads = 4;
+	ret = HoloStor_SetThreads(&threads);
+	report(moniker, "1 HoloStor_SetThreads", ret, HOLOSTOR_STATUS_SUCCESS);
+	FillAll(BlockGroup, &cfg);
+	time = PentiumCycles();
+	ret = HoloStor_Encode(hSession, (PVOID*)BlockGroup);
+	time = PentiumCycles() - time;
+	report(moniker, "1 HoloStor_Encode", ret, HOLOSTOR_STATUS_SUCCESS);
+	printf("[Encode of %u+%u (%u byte blocks) : %s cycles, %u threads %s cycles]\n",
+		cfg.DataBlocks, cfg.EccBlocks, cfg.BlockSize,
+		PercentE(time1,1,2), threads, PercentE(time,1,2));
+	ret = 0;
+	for (i = cfg.DataBlocks; i < cfg.DataBlocks+cfg.EccBlocks; i++)
+		ret |= CompareOne(BlockGroup[i], Expect[i], &cfg);
+	report(moniker, "1 CompareOne", ret, 0);	// pass if ECC as if by one
+	// Zap the maximum Data blocks.
+	uInvalidMask = 0;
+	for (i = 0; i < cfg.EccBlocks; i++) {
+		FillOne(BlockGroup[2*i], JunkFill, &cfg);
+		uInvalidMask |= (1u<<(2*i));
+	}
+	ret = HoloStor_Decode(hSession, (PVOID*)BlockGroup, uInvalidMask);
+	report(moniker, "2 HoloStor_Decode", ret, HOLOSTOR_STATUS_SUCCESS);
+	ret = CheckData(BlockGroup, &cfg);
+	report(moniker, "2 CheckData", ret, 0);		// pass if Data restored
+	//
+	threads = 1;
+	ret = HoloStor_SetThreads(&threads);
+	report(moniker, "3 HoloStor_SetThreads", ret, HOLOSTOR_STATUS_SUCCESS);
+	report(moniker, "3 threads", threads == 1 ? 0 : -1, 0);
+	ret = HoloStor_CloseSession(hSession);
+	report(moniker, "HoloStor_CloseSession", ret, HOLOSTOR_STATUS_SUCCESS);
+	//
+	ppFree(Expect, &cfg);
+	ppFree(BlockGroup, &cfg);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+//	Test4 - Exercise many sessions, stale handles and Close under use.
+//
+//////////////////////////////////////////////////////////////////////
+
+#define	NSESSIONS	1000			// well beyond a segment of the table
+
+#if defined(__linux__) && !defined(__KERNEL__)
+#include <pthread.h>
+
+#define	NTHREADS	4
+#define	NREOPENS	200
+
+static volatile HOLOSTOR_SESSION hShared;	// swapped under the threads
+static volatile int bStop;
+
+typedef struct {
+	HOLOSTOR_CFG cfg;
+	int nSuccess, nBadSession, nErrors;
+} worker_t;
+
+// Encode and decode with whatever session is current, until stopped.
+static void *
+worker(void *arg)
+{
+	worker_t *pWorker = (worker_t *)arg;
+	char **BlockGroup = ppAlloc(&pWorker->cfg);
+	while (!bStop) {
+		int ret;
+		FillAll(BlockGroup, &pWorker->cfg);
+		ret = HoloStor_Encode(hShared, (PVOID*)BlockGroup);
+		if (ret == HOLOSTOR_STATUS_SUCCESS) {
+			FillOne(BlockGroup[0], JunkFill, &pWorker->cfg);
+			ret = HoloStor_Decode(hShared, (PVOID*)BlockGroup, 1<<0);
+		}
+		if (ret == HOLOSTOR_STATUS_SUCCESS) {
+			pWorker->nSuccess++;
+			if (CheckData(BlockGroup, &pWorker->cfg) < 0)
+				pWorker->nErrors++;
+		} else if (ret == HOLOSTOR_STATUS_BAD_SESSION)
+			pWorker->nBadSession++;		// closed under us:  expected
+		else
+			pWorker->nErrors++;
+	}
+	ppFree(BlockGroup, &pWorker->cfg);
+	return NULL;
+}
+
+void
+test4b(void){
+	char moniker[] = "test4b";
+	pthread_t threads[NTHREADS];
+	worker_t workers[NTHREADS];
+	HOLOSTOR_CFG cfg;
+	HOLOSTOR_OPTIONS opts;
+	unsigned i;
+	int ret, nBad, nSuccess;
+	//
+	cfg.BlockSize = nMinBlockSize;
+	cfg.DataBlocks = 4;
+	cfg.EccBlocks = 2;
+	opts.Size = sizeof(opts);
+	opts.Flags = HOLOSTOR_FLAG_LAZY;		// the workers race to build the matrices
+	hShared = HoloStor_CreateSessionEx(&cfg, &opts);
+	report(moniker, "HoloStor_CreateSessionEx", hShared < 0, 0);
+	bStop = 0;
+	for (i = 0; i < NTHREADS; i++) {
+		memset(&workers[i], 0, sizeof(workers[i]));
+		workers[i].cfg = cfg;
+		pthread_create(&threads[i], NULL, worker, &workers[i]);
+	}
+	// Replace the session over and over, closing each under the workers.
+	nBad = 0;
+	for (i = 0; i < NREOPENS; i++) {
+		HOLOSTOR_SESSION hOld = hShared;
+		hShared = HoloStor_CreateSessionEx(&cfg, &opts);
+		if (hShared < 0 || HoloStor_CloseSession(hOld) != HOLOSTOR_STATUS_SUCCESS)
+			nBad++;
+	}
+	bStop = 1;
+	nSuccess = 0;
+	for (i = 0; i < NTHREADS; i++) {
+		pthread_join(threads[i], NULL);
+		nBad += workers[i].nErrors;
+		nSuccess += workers[i].nSuccess;
+	}
+	report(moniker, "concurrent close errors", nBad, 0);
+	report(moniker, "concurrent decodes", nSuccess > 0, 1);
+	ret = HoloStor_CloseSession(hShared);
+	report(moniker, "HoloStor_CloseSession", ret, HOLOSTOR_STATUS_SUCCESS);
+}
+#endif
+
+void
+test4(void){
+	char moniker[] = "test4";
+	static HOLOSTOR_SESSION hSessions[NSESSIONS];
+	unsigned i, j;
+	int ret, nBad;
+	unsigned uInvalidMask;
+	HOLOSTOR_CFG cfg;
+	HOLOSTOR_SESSION hSession;
+	char** BlockGroup;
+	pcycles_t time;
+	//
+	cfg.BlockSize = nMinBlockSize;
+	cfg.DataBlocks = 1;
+	cfg.EccBlocks = 1;
+	// Open many sessions, with distinct handles.
+	nBad = 0;
+	for (i = 0; i < NSESSIONS; i++) {
+		hSessions[i] = HoloStor_CreateSession(&cfg);
+		if (hSessions[i] < 0)
+			nBad++;
+		for (j = 0; j < i; j++)
+			if (hSessions[j] == hSessions[i])
+				nBad++;
+	}
+	report(moniker, "1 HoloStor_CreateSession", nBad, 0);
+	// Close every other one; their handles go stale.
+	nBad = 0;
+	for (i = 0; i < NSESSIONS; i += 2)
+		if (HoloStor_CloseSession(hSessions[i]) != HOLOSTOR_STATUS_SUCCESS)
+			nBad++;
+	report(moniker, "2 HoloStor_CloseSession", nBad, 0);
+	ret = HoloStor_CloseSession(hSessions[0]);
+	report(moniker, "3 HoloStor_CloseSession", ret, HOLOSTOR_STATUS_BAD_SESSION);
+	// A new session reuses a slot, but not a handle.
+	hSession = HoloStor_CreateSession(&cfg);
+	report(moniker, "4 HoloStor_CreateSession", hSession < 0, 0);
+	nBad = 0;
+	for (i = 0; i < NSESSIONS; i += 2)
+		if (hSessions[i] == hSession)
+			nBad++;
+	report(moniker, "4 stale handles reused", nBad, 0);
+	ret = HoloStor_Encode(hSessions[0], NULL);
+	report(moniker, "5 HoloStor_Encode", ret, HOLOSTOR_STATUS_BAD_SESSION);
+	ret = HoloStor_CloseSession(hSession);
+	report(moniker, "6 HoloStor_CloseSession", ret, HOLOSTOR_STATUS_SUCCESS);
+	for (i = 1; i < NSESSIONS; i += 2)
+		HoloStor_CloseSession(hSessions[i]);
+	ret = HoloStor_CloseSession(-1);
+	report(moniker, "7 HoloStor_CloseSession", ret, HOLOSTOR_STATUS_BAD_SESSION);
+	ret = HoloStor_CloseSession(0x7FFFFFFF);
+	report(moniker, "8 HoloStor_CloseSession", ret, HOLOSTOR_STATUS_BAD_SESSION);
+	// Sessions of the same DataBlocks and EccBlocks share a coding table (of
+	// any BlockSize), which outlives the session that built it.
+	cfg.DataBlocks = 13;
+	cfg.EccBlocks = 4;
+	for (i = 0; i < 2; i++) {
+		cfg.BlockSize = nMinBlockSize << i;
+		time = PentiumCycles();
+		hSessions[i] = HoloStor_CreateSession(&cfg);
+		time = PentiumCycles() - time;
+		report(moniker, "9 HoloStor_CreateSession", hSessions[i] < 0, 0);
+		printf("[CreateSession for %u+%u, BlockSize %u : %s cycles]\n",
+			cfg.DataBlocks, cfg.EccBlocks, cfg.BlockSize,
+			PercentE(time,1,2));
+	}
+	ret = HoloStor_CloseSession(hSessions[0]);
+	report(moniker, "10 HoloStor_CloseSession", ret, HOLOSTOR_STATUS_SUCCESS);
+	BlockGroup = ppAlloc(&cfg);
+	FillAll(BlockGroup, &cfg);
+	ret = HoloStor_Encode(hSessions[1], (PVOID*)BlockGroup);
+	report(moniker, "11 HoloStor_Encode", ret, HOLOSTOR_STATUS_SUCCESS);
+	uInvalidMask = 0;
+	for (i = 0; i < cfg.EccBlocks; i++) {
+		FillOne(BlockGroup[i], JunkFill, &cfg);
+		uInvalidMask |= (1<<i);
+	}
+	ret = HoloStor_Decode(hSessions[1], (PVOID*)BlockGroup, uInvalidMask);
+	report(moniker, "11 HoloStor_Decode", ret, HOLOSTOR_STATUS_SUCCESS);
+	ret = CheckData(BlockGroup, &cfg);
+	report(moniker, "11 CheckData", ret, 0);		// pass if Data restored
+	ppFree(BlockGroup, &cfg);
+	ret = HoloStor_CloseSession(hSessions[1]);
+	report(moniker, "12 HoloStor_CloseSession", ret, HOLOSTOR_STATUS_SUCCESS);
+#if defined(__linux__) && !defined(__KERNEL__)
+	test4b();
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+//	Test5 - Exercise the asynchronous calls (Linux only).
+//
+//////////////////////////////////////////////////////////////////////
+
+#if defined(__linux__) && !defined(__KERNEL__)
+#include <poll.h>
+#include <unistd.h>
+
+#define	NENTRIES	4				// calls in flight
+
+// Wait on the eventfd for nCompletions completions and reap them, returning
+// how many were reaped (fewer after a second without one).
+static int
+WaitReap(HOLOSTOR_SESSION hSession, int hEvent,
+		 HOLOSTOR_COMPLETION *pCompletions, int nCompletions)
+{
+	int n = 0;
+	while (n < nCompletions) {
+		struct pollfd pfd;
+		unsigned long long count;
+		int ret = HoloStor_Reap(hSession, pCompletions+n, nCompletions-n);
+		if (ret < 0)
+			return ret;
+		n += ret;
+		if (n == nCompletions)
+			break;
+		pfd.fd = hEvent;
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, 1000) != 1)
+			break;						// timed out
+		if (read(hEvent, &count, sizeof(count)) != sizeof(count))
+			break;
+	}
+	return n;
+}
+
+void
+test5(void){
+	char moniker[] = "test5";
+	unsigned i;
+	int ret, hEvent;
+	unsigned uInvalidMask;
+	HOLOSTOR_CFG cfg;
+	HOLOSTOR_SESSION hSession;
+	HOLOSTOR_COMPLETION completions[NENTRIES];
+	char** BlockGroups[NENTRIES];
+	char *pEcc;
+	//
+	cfg.BlockSize = 4096;
+	cfg.DataBlocks = 8;
+	cfg.EccBlocks = 3;
+	for (i = 0; i < NENTRIES; i++)
+		BlockGroups[i] = ppAlloc(&cfg);
+	pEcc = _AlignedAlloc(cfg.BlockSize, &cfg);
+	//
+	hSession = HoloStor_CreateSession(&cfg);
+	report(moniker, "HoloStor_CreateSession", hSession, HOLOSTOR_STATUS_SUCCESS);
+	ret = HoloStor_SubmitEncode(hSession, (PVOID*)BlockGroups[0], NULL);
+	report(moniker, "0 HoloStor_SubmitEncode", ret, HOLOSTOR_STATUS_INVALID_PARAMETER);
+	ret = HoloStor_Reap(hSession, completions, NENTRIES);
+	report(moniker, "0 HoloStor_Reap", ret, HOLOSTOR_STATUS_INVALID_PARAMETER);
+	ret = HoloStor_OpenQueue(hSession, 0);
+	report(moniker, "0 HoloStor_OpenQueue", ret, HOLOSTOR_STATUS_INVALID_PARAMETER);
+	hEvent = HoloStor_OpenQueue(hSession, NENTRIES);
+	report(moniker, "0 HoloStor_OpenQueue", hEvent, HOLOSTOR_STATUS_SUCCESS);
+	ret = HoloStor_OpenQueue(hSession, NENTRIES);
+	report(moniker, "0 HoloStor_OpenQueue", ret, HOLOSTOR_STATUS_INVALID_PARAMETER);
+	// Encode the groups, one call too many.
+	for (i = 0; i < NENTRIES; i++) {
+		FillAll(BlockGroups[i], &cfg);
+		ret = HoloStor_SubmitEncode(hSession, (PVOID*)BlockGroups[i], BlockGroups[i]);
+		report(moniker, "1 HoloStor_SubmitEncode", ret, HOLOSTOR_STATUS_SUCCESS);
+	}
+	ret = HoloStor_SubmitEncode(hSession, (PVOID*)BlockGroups[0], NULL);
+	report(moniker, "1 HoloStor_SubmitEncode", ret, HOLOSTOR_STATUS_QUEUE_FULL);
+	ret = WaitReap(hSession, hEvent, completions, NENTRIES);
+	report(moniker, "1 WaitReap", ret == NENTRIES ? 0 : -1, 0);
+	ret = 0;
+	for (i = 0; i < NENTRIES; i++) {
+		unsigned j;
+		for (j = 0; j < NENTRIES; j++)	// in any order
+			if (completions[j].lpContext == BlockGroups[i])
+				break;
+		if (j == NENTRIES || completions[j].lStatus != HOLOSTOR_STATUS_SUCCESS)
+			ret = -1;
+	}
+	report(moniker, "1 completions", ret, 0);
+	// Zap Data blocks and decode them.
+	uInvalidMask = (1u<<0)|(1u<<3)|(1u<<7);
+	for (i = 0; i < NENTRIES; i++) {
+		FillOne(BlockGroups[i][0], JunkFill, &cfg);
+		FillOne(BlockGroups[i][3], JunkFill, &cfg);
+		FillOne(BlockGroups[i][7], JunkFill, &cfg);
+		ret = HoloStor_SubmitDecode(hSession, (PVOID*)BlockGroups[i], &uInvalidMask,
+									BlockGroups[i]);
+		report(moniker, "2 HoloStor_SubmitDecode", ret, HOLOSTOR_STATUS_SUCCESS);
+	}
+	uInvalidMask = 0;					// the calls have copies
+	ret = WaitReap(hSession, hEvent, completions, NENTRIES);
+	report(moniker, "2 WaitReap", ret == NENTRIES ? 0 : -1, 0);
+	ret = 0;
+	for (i = 0; i < NENTRIES; i++) {
+		ret |= completions[i].lStatus;
+		ret |= CheckData(BlockGroups[i], &cfg);
+	}
+	report(moniker, "2 CheckData", ret, 0);		// pass if Data restored
+	// The status of a failing call is that of the synchronous call.
+	uInvalidMask = (1u<<0)|(1u<<1)|(1u<<2)|(1u<<3);
+	ret = HoloStor_SubmitRebuild(hSession, (PVOID*)BlockGroups[0], &uInvalidMask, 0, NULL);
+	report(moniker, "3 HoloStor_SubmitRebuild", ret, HOLOSTOR_STATUS_SUCCESS);
+	ret = HoloStor_SubmitEncodeDelta(hSession, cfg.DataBlocks, BlockGroups[0][0],
+									 8, BlockGroups[0][8], pEcc, NULL);
+	report(moniker, "3 HoloStor_SubmitEncodeDelta", ret, HOLOSTOR_STATUS_SUCCESS);
+	ret = WaitReap(hSession, hEvent, completions, 2);
+	report(moniker, "3 WaitReap", ret == 2 ? 0 : -1, 0);
+	ret = (completions[0].lStatus + completions[1].lStatus ==
+		HOLOSTOR_STATUS_TOO_MANY_BAD_BLOCKS + HOLOSTOR_STATUS_INVALID_PARAMETER) ? 0 : -1;
+	report(moniker, "3 completions", ret, 0);
+	// Close with a call in flight.
+	ret = HoloStor_SubmitEncode(hSession, (PVOID*)BlockGroups[1], NULL);
+	report(moniker, "4 HoloStor_SubmitEncode", ret, HOLOSTOR_STATUS_SUCCESS);
+	ret = HoloStor_CloseSession(hSession);
+	report(moniker, "HoloStor_CloseSession", ret, HOLOSTOR_STATUS_SUCCESS);
+	ret = HoloStor_Reap(hSession, completions, NENTRIES);
+	report(moniker, "4 HoloStor_Reap", ret, HOLOSTOR_STATUS_BAD_SESSION);
+	ret = HoloStor_SubmitEncode(hSession, (PVOID*)BlockGroups[1], NULL);
+	report(moniker, "4 HoloStor_SubmitEncode", ret, HOLOSTOR_STATUS_BAD_SESSION);
+	usleep(100000);						// for the call in flight
+	// The threads stopped with the last queue; another queue starts them again.
+	hSession = HoloStor_CreateSession(&cfg);
+	report(moniker, "HoloStor_CreateSession", hSession, HOLOSTOR_STATUS_SUCCESS);
+	hEvent = HoloStor_OpenQueue(hSession, NENTRIES);
+	report(moniker, "5 HoloStor_OpenQueue", hEvent, HOLOSTOR_STATUS_SUCCESS);
+	ret = HoloStor_SubmitEncode(hSession, (PVOID*)BlockGroups[1], NULL);
+	report(moniker, "5 HoloStor_SubmitEncode", ret, HOLOSTOR_STATUS_SUCCESS);
+	ret = WaitReap(hSession, hEvent, completions, 1);
+	report(moniker, "5 WaitReap", ret == 1 ? completions[0].lStatus : -1, 0);
+	ret = HoloStor_CloseSession(hSession);
+	report(moniker, "HoloStor_CloseSession", ret, HOLOSTOR_STATUS_SUCCESS);
+	//
+	_AlignedFree(pEcc, &cfg);
+	for (i = 0; i < NENTRIES; i++)
+		ppFree(BlockGroups[i], &cfg);
+}
+#endif
+
+
 //////////////////////////////////////////////////////////////////////
 //
 //	Test3 - Measure Encode/Decode performance.
 //
 //////////////////////////////////////////////////////////////////////
 
-void benchmark(const HOLOSTOR_CFG *pCfg, int nIterations);
+void benchmark(const HOLOSTOR_CFG *pCfg, const HOLOSTOR_OPTIONS *pOpts, int nIterations);
 
 void
 test3(void){
 	HOLOSTOR_CFG cfg;
+	HOLOSTOR_OPTIONS opts;
 	// Measure table lookup overhead with a small configuraton
 	cfg.BlockSize = nMinBlockSize;	// smallest supported
 	cfg.DataBlocks = 1;
 	cfg.EccBlocks = 1;
-	benchmark(&cfg, nBenchRepeats);
+	benchmark(&cfg, NULL, nBenchRepeats);
 	// Measure typical data processing overhead with moderate configuration
 	cfg.BlockSize = nTypBlockSize;	// typical value used
 	cfg.DataBlocks = 14;
 	cfg.EccBlocks = 3;
-	benchmark(&cfg, nBenchRepeats);
+	benchmark(&cfg, NULL, nBenchRepeats);
 	// Measure typical data processing overhead with maximal configuration
 	cfg.BlockSize = nTypBlockSize;	// typical value used
 	cfg.DataBlocks = 13;
 	cfg.EccBlocks = 4;
-	benchmark(&cfg, nBenchRepeats);
+	benchmark(&cfg, NULL, nBenchRepeats);
+	opts.Size = sizeof(opts);
+	opts.Flags = HOLOSTOR_FLAG_MINXOR;
+	benchmark(&cfg, &opts, nBenchRepeats);
+	opts.Flags = HOLOSTOR_FLAG_LAZY;		// for the time of HoloStor_CreateSession
+	benchmark(&cfg, &opts, nBenchRepeats);
+	// Compare the GF(2**8) engines with the same configuration
+	opts.Flags = HOLOSTOR_FLAG_GF256;
+	benchmark(&cfg, &opts, nBenchRepeats);
+	opts.Flags = HOLOSTOR_FLAG_GF256|HOLOSTOR_FLAG_BITSLICED;
+	benchmark(&cfg, &opts, nBenchRepeats);
+	opts.Flags = HOLOSTOR_FLAG_GF256|HOLOSTOR_FLAG_BITSLICED|HOLOSTOR_FLAG_MINXOR;
+	benchmark(&cfg, &opts, nBenchRepeats);
 }
 
 metric_t metric[] = {
@@ -664,7 +1505,7 @@ metric_t metric[] = {
 #define	METRIC_ENCODE	5
 #define	METRIC_CREATE	6
 
-void benchmark(const HOLOSTOR_CFG *pCfg, int nIterations)
+void benchmark(const HOLOSTOR_CFG *pCfg, const HOLOSTOR_OPTIONS *pOpts, int nIterations)
 {
 	char moniker[] = "test3";
 	MetricsInit(metric);
@@ -677,7 +1518,7 @@ void benchmark(const HOLOSTOR_CFG *pCfg, int nIterations)
 		pcycles_t time;
 		//
 		time = PentiumCycles();
-		hSession = HoloStor_CreateSession(pCfg);
+		hSession = HoloStor_CreateSessionEx(pCfg, pOpts);
 		time = PentiumCycles() - time;
 		//
 		MetricSample(&metric[METRIC_CREATE], (cnt_t)time, (cnt_t)1);
@@ -770,12 +1611,19 @@ int
 main(int argc, char *argv[])
 {
 	unsigned method = ~0u;
+	unsigned prefetch = ~0u;		// library default
 #ifndef	__KERNEL__
-	if (argc == 2) 
+	if (argc >= 2) 
 		sscanf(argv[1], "%u", &method);
+	if (argc >= 3) 
+		sscanf(argv[2], "%u", &prefetch);
 #endif
 	HoloStor_SetMethod(&method);
 	printf("method = %u\n", method);
+	if (prefetch != ~0u) {
+		HoloStor_SetPrefetch(&prefetch);
+		printf("prefetch = %u\n", prefetch);
+	}
 	self_test();
 	printf("*** HoloStor library interface test ***\n");
 #ifdef	DO_TESTX
@@ -783,8 +1631,38 @@ main(int argc, char *argv[])
 #endif
 	test0();
 	test1();
-	test2();
-	test2b();
+	test2(0);
+	test2b(0);
+	test2(HOLOSTOR_FLAG_NONTEMPORAL);
+	test2b(HOLOSTOR_FLAG_NONTEMPORAL);
+	test2(HOLOSTOR_FLAG_METHOD);		// method 0, whatever the CPU
+	test2b(HOLOSTOR_FLAG_METHOD);
+	test2(HOLOSTOR_FLAG_GF256);
+	test2b(HOLOSTOR_FLAG_GF256);
+	test2c(HOLOSTOR_FLAG_GF256);
+	test2(HOLOSTOR_FLAG_GF256|HOLOSTOR_FLAG_BITSLICED);
+	test2b(HOLOSTOR_FLAG_GF256|HOLOSTOR_FLAG_BITSLICED);
+	test2c(HOLOSTOR_FLAG_GF256|HOLOSTOR_FLAG_BITSLICED);
+	test2(HOLOSTOR_FLAG_MINXOR);
+	test2b(HOLOSTOR_FLAG_MINXOR);
+	test2(HOLOSTOR_FLAG_GF256|HOLOSTOR_FLAG_BITSLICED|HOLOSTOR_FLAG_MINXOR);
+	test2b(HOLOSTOR_FLAG_GF256|HOLOSTOR_FLAG_BITSLICED|HOLOSTOR_FLAG_MINXOR);
+	test2c(HOLOSTOR_FLAG_GF256|HOLOSTOR_FLAG_BITSLICED|HOLOSTOR_FLAG_MINXOR);
+	test2(HOLOSTOR_FLAG_LAZY);
+	test2b(HOLOSTOR_FLAG_LAZY);
+	test2c(HOLOSTOR_FLAG_GF256|HOLOSTOR_FLAG_LAZY);
+	test2d(0);
+	test2d(HOLOSTOR_FLAG_GF256);
+	test2d(HOLOSTOR_FLAG_GF256|HOLOSTOR_FLAG_BITSLICED);
+	test2e(0);
+	test2e(HOLOSTOR_FLAG_GF256|HOLOSTOR_FLAG_BITSLICED);
+	test2e(HOLOSTOR_FLAG_LAZY);
+	test2f(0);
+	test2f(HOLOSTOR_FLAG_GF256|HOLOSTOR_FLAG_BITSLICED);
+	test4();
+#if defined(__linux__) && !defined(__KERNEL__)
+	test5();
+#endif
 	test3();
 	printf("*** Summary: %d failures, %d successes ***\n", nFail, nPass);
 	REPORTMEMORY;
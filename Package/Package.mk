@@ -41,7 +41,7 @@ THIS=Package.mk
 # Ownership of file in tarball
 TARFLAGS=--owner=root --group=root --numeric-owner
 # Major.Minor.Build
-VERSION=1.0.4
+VERSION=1.1.0
 # -Alpha, -Beta, -RC1, "", etc.
 RELEASE=
 #
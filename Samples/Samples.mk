@@ -76,7 +76,7 @@ LinuxRelease LinuxKernel:			# Make the sub-directories.
 	if [ ! -e $@ ]; then mkdir $@; fi
 
 LinuxRelease/EncodeDecode.exe: LinuxRelease LinuxRelease/EncodeDecode.o
-	$(CC) $(LDFLAGS) LinuxRelease/EncodeDecode.o ../$(LIB) -o $@ 
+	$(CC) $(LDFLAGS) LinuxRelease/EncodeDecode.o ../$(LIB) -lpthread -o $@ 
 
 LinuxRelease/EncodeDecode.o: EncodeDecode.c
 	$(CC) -c $(CFLAGS) $(CPPFLAGS) EncodeDecode.c \
@@ -41,6 +41,7 @@
 #include <linux/kernel.h>
 #include <linux/string.h>	// Needed for strncmp()
 #include <linux/sched.h>	// Needed for cond_resched()
+#include <linux/vmalloc.h>	// Needed for vmalloc/vfree()
 #include <asm/div64.h>		// Needed for do_div()
 #else //!__KERNEL__
 #include <stdlib.h>
@@ -58,19 +59,10 @@
 
 //
 // SSE2 instructions require Data and ECC buffers be aligned on 16-byte
-// boundaries.
+// boundaries (see AllocBuffer).
 // 
 // NOTE: In general, align buffers of Cache Line sizes for best performance.
 //
-#ifdef _MSC_VER
-#if MSC_VER >= 1300
-#define	ALIGN16	_declspec(align(16))
-#else	// !_MSC_VER >= 1300	// VC 6 does not support alignment and SSE2
-#define ALIGN16
-#endif	// _MSC_VER >= 1300
-#else	// !_MSC_VER (GCC)
-#define	ALIGN16 __attribute__ ((aligned(16)))
-#endif	// _MSC_VER
 
 
 //
@@ -119,7 +111,8 @@ typedef int BOOL;
 // Local defines.
 //
 #define	MAX_BLOCKS	17			// Limited by the HoloStor 1.0 library
-#define	MAX_BSIZE	65536		// 64 KB - a reasonable upper test limit
+#define	MAX_BSIZE	8388608		// 8 MB - a reasonable upper test limit
+#define	MIN_BUFFER	65536		// Smallest Bsize the buffers are sized for
 
 
 //
@@ -148,8 +141,11 @@ ULONG	Cache		= 0;
 ULONG	Verbose		= 1;
 //
 ULONG	Method		= ~0ul;		// Use the best method supported in HW
+ULONG	Flags		= 0;		// HOLOSTOR_FLAG_* session options
+ULONG	Threads		= 1;		// Threads per call (HoloStor_SetThreads)
 
 HOLOSTOR_CFG	Cfg;
+HOLOSTOR_OPTIONS	Opts;
 PVOID	Group[MAX_BLOCKS];
 LONG	CacheLine;
 LONG	Failures;
@@ -159,10 +155,15 @@ COUNTER	DecodeCounter[MAX_BLOCKS];
 COUNTER	WriteDeltaCounter;
 COUNTER	EncodeDeltaCounter;
 
-ALIGN16 CHAR Buffers[MAX_BLOCKS * MAX_BSIZE];
-ALIGN16 CHAR Data[MAX_BLOCKS * MAX_BSIZE];
-ALIGN16 CHAR Data2[MAX_BLOCKS * MAX_BSIZE];
-ALIGN16 CHAR Delta[MAX_BSIZE], NewEcc[MAX_BSIZE];
+//
+// Test buffers are allocated for the largest Bsize tested (but at least
+// MIN_BUFFER, so that dirtying the cache still displaces it).
+//
+ULONG	BufferSize;				// Bytes in Buffers, Data and Data2
+PCHAR	Buffers;				// MAX_BLOCKS blocks each
+PCHAR	Data;
+PCHAR	Data2;
+PCHAR	Delta, NewEcc;			// One block each
 
 
 //
@@ -201,6 +202,48 @@ inline int GetCacheLineSize(VOID)
 //
 INLINE INT64 ReadProcessorClock(VOID) { return PentiumCycles(); }
 
+//
+// Allocate a test buffer aligned on a 16-byte boundary.  The original
+// pointer is kept just below the returned buffer for FreeBuffer().
+//
+PCHAR AllocBuffer( ULONG lBytes)
+{
+	PCHAR	lp;
+	PCHAR	lpAligned;
+
+#ifdef	__KERNEL__
+	lp = vmalloc(lBytes + 16 + sizeof(PCHAR));
+#else
+	lp = malloc(lBytes + 16 + sizeof(PCHAR));
+#endif
+	if (lp==NULL)
+		return NULL;
+
+	lpAligned = (PCHAR)(((unsigned long)lp + sizeof(PCHAR) + 15) & ~15ul);
+	((PCHAR*)lpAligned)[-1] = lp;
+	return lpAligned;
+}
+
+VOID FreeBuffer( PCHAR lpAligned)
+{
+	if (lpAligned==NULL)
+		return;
+#ifdef	__KERNEL__
+	vfree(((PCHAR*)lpAligned)[-1]);
+#else
+	free(((PCHAR*)lpAligned)[-1]);
+#endif
+}
+
+VOID FreeBuffers(VOID)
+{
+	FreeBuffer(Buffers);
+	FreeBuffer(Data);
+	FreeBuffer(Data2);
+	FreeBuffer(Delta);
+	FreeBuffer(NewEcc);
+}
+
 //
 // Divide a 32-bit divisor into a 64-bit dividend.
 //
@@ -271,12 +314,12 @@ PrepareCacheState(VOID)
 		break;
 
 	case 1:				// Fill the cache with other data (dirty cache case)
-		for (lp = &Data[MAX_BLOCKS*MAX_BSIZE]; lp>=Data; lp -= CacheLine)
+		for (lp = &Data[BufferSize-1]; lp>=Data; lp -= CacheLine)
 			l = *lp;
 		break;
 
 	case 2:				// Flush and invalidate the cache (cold cache case)
-		for (lp = &Buffers[MAX_BLOCKS*MAX_BSIZE]; lp>=Buffers; lp -= CacheLine)
+		for (lp = &Buffers[BufferSize-1]; lp>=Buffers; lp -= CacheLine)
 #ifdef _MSC_VER
 			__asm
 			{
@@ -331,6 +374,7 @@ VOID
 PrintCounter( PCOUNTER lpCounter)
 {
 	LONG	avg;
+	INT64	bytes, cycles;
 
 	if (lpCounter->Calls==0)
 	{
@@ -338,8 +382,18 @@ PrintCounter( PCOUNTER lpCounter)
 		return;
 	}
 
-	// XXX - lpCounter->Bytes assumed < 4-GBytes
-	avg = (LONG) div64by32(lpCounter->Cycles*1000, (LONG)lpCounter->Bytes);
+	//
+	// Scale the totals down so that the byte count fits the 32-bit divisor
+	// (multi-MB blocks quickly total more than 2 GB).
+	//
+	bytes = lpCounter->Bytes;
+	cycles = lpCounter->Cycles;
+	while (bytes > 0x7FFFFFFF)
+	{
+		bytes >>= 1;
+		cycles >>= 1;
+	}
+	avg = (LONG) div64by32(cycles*1000, (INT32)bytes);
 
 	printf("Min=%ld.%03ld, Max=%ld.%03ld, Avg=%ld.%03ld, Calls=%ld\n",
 		lpCounter->MinRate / 1000, lpCounter->MinRate % 1000,
@@ -394,7 +448,13 @@ main( INT argc, PCHAR argv[])
 		if (GetParameter( &Verbose, argv[i], "Verbosity=%lu", 0, 2))
 			continue;
 
-		if (GetParameter( &Method, argv[i], "Method=%lu", 0, 2))
+		if (GetParameter( &Method, argv[i], "Method=%lu", 0, 4))
+			continue;
+
+		if (GetParameter( &Flags, argv[i], "Flags=%lx", 0, HOLOSTOR_FLAGS_VALID))
+			continue;
+
+		if (GetParameter( &Threads, argv[i], "Threads=%lu", 1, 64))
 			continue;
 
 		if (strcmp(argv[i], "/?")!=0)
@@ -403,7 +463,9 @@ main( INT argc, PCHAR argv[])
 		printf("Usage: EncodeDecode [/?] [MinBsize=# MaxBsize=# MinData=# MaxData=#\n");
 		printf("       MinEcc=# MaxEcc=# Verbosity=0-2 TestData=X,0(random)\n");
 		printf("       Cache=0(warm),1(dirty),2(flush)\n");
-		printf("       Method=0(std),1(mmx),2(sse2)]\n");
+		printf("       Method=0(std),1(mmx),2(sse2),3(avx2),4(avx512)\n");
+		printf("       Flags=X(1=non-temporal,4=GF256,8=bit-sliced,10=min-XOR)\n");
+		printf("       Threads=#]\n");
 		return 1;
 	}
 
@@ -418,6 +480,23 @@ main( INT argc, PCHAR argv[])
 	while ((i >>= 1)!=0)
 		MaxBsize &= ~i;
 
+	//
+	// Allocate the test buffers.
+	//
+	BufferSize = MAX_BLOCKS * (MaxBsize > MIN_BUFFER ? MaxBsize : MIN_BUFFER);
+	Buffers = AllocBuffer(BufferSize);
+	Data = AllocBuffer(BufferSize);
+	Data2 = AllocBuffer(BufferSize);
+	Delta = AllocBuffer(MaxBsize);
+	NewEcc = AllocBuffer(MaxBsize);
+	if (Buffers==NULL || Data==NULL || Data2==NULL || Delta==NULL || NewEcc==NULL)
+	{
+		printf("Error: Cannot allocate %lu bytes of test buffers\n",
+			3*BufferSize + 2*MaxBsize);
+		FreeBuffers();
+		return 9;
+	}
+
 	//
 	// Get CacheLine size for this processor and check if CLFLUSH is supported.
 	//
@@ -449,7 +528,7 @@ main( INT argc, PCHAR argv[])
 		printf("0(random)");
 	else
 		printf("%08lX", TestData);
-	printf(", Cache = %s\n", Cache==0 ? "0(warm)" : Cache==1 ? "1(dirty)" : "2(flush)" );
+	printf(", Cache = %s, Flags = %lX\n", Cache==0 ? "0(warm)" : Cache==1 ? "1(dirty)" : "2(flush)", Flags );
 
 	{
 		unsigned method = Method;
@@ -457,14 +536,20 @@ main( INT argc, PCHAR argv[])
 		printf("Method = %u (%s constrained)\n", method,
 			(Method==~0ul)?"HW":"user");
 	}
+	if (Threads != 1)
+	{
+		unsigned threads = Threads;
+		HoloStor_SetThreads(&threads);
+		printf("Threads = %u\n", threads);
+	}
 
 	//
 	// Initialize test data.
 	//
-	for (lp = (UINT32*)Data; lp < (UINT32*)&Data[MAX_BLOCKS * MAX_BSIZE]; )
+	for (lp = (UINT32*)Data; lp < (UINT32*)&Data[BufferSize]; )
 		*lp++ = TestData==0 ? rand32() : TestData;
 
-	for (lp = (UINT32*)Data2; lp < (UINT32*)&Data2[MAX_BLOCKS * MAX_BSIZE]; )
+	for (lp = (UINT32*)Data2; lp < (UINT32*)&Data2[BufferSize]; )
 		*lp++ = TestData==0 ? rand32() : ~TestData;
 
 	//
@@ -486,12 +571,15 @@ main( INT argc, PCHAR argv[])
 		Cfg.BlockSize = bsize;
 		Cfg.DataBlocks = ndata;
 		Cfg.EccBlocks = necc;
+		Opts.Size = sizeof(Opts);
+		Opts.Flags = Flags;
 
-		hSession = HoloStor_CreateSession( &Cfg);
+		hSession = HoloStor_CreateSessionEx( &Cfg, &Opts);
 		if (hSession<0)
 		{
-			printf("Error: HoloStor_CreateSession=%d; Bsize=%ld, Data=%ld, Ecc=%ld\n",
+			printf("Error: HoloStor_CreateSessionEx=%d; Bsize=%ld, Data=%ld, Ecc=%ld\n",
 				hSession, bsize, ndata, necc);
+			FreeBuffers();
 			return 10;
 		}
 
@@ -512,6 +600,7 @@ main( INT argc, PCHAR argv[])
 		{
 			printf("Error: HoloStor_Encode=%ld; Bsize=%ld, Data=%ld, Ecc=%ld\n",
 				status, bsize, ndata, necc);
+			FreeBuffers();
 			return 11;
 		}
 
@@ -604,7 +693,8 @@ main( INT argc, PCHAR argv[])
 			{
 				printf("Error: Recover/Rebuild on mask 0x%x;  Bsize=%ld, Data=%ld, Ecc=%ld\n",
 					mask, bsize, ndata, necc);
-				return 12;
+				FreeBuffers();
+			return 12;
 			}
 
 			UpdateCounter( &DecodeCounter[count], ndata*bsize, time);
@@ -632,6 +722,7 @@ main( INT argc, PCHAR argv[])
 		{
 			printf("Error: HoloStor_CloseSession=%ld; Bsize=%ld, Data=%ld, Ecc=%ld\n",
 				status, bsize, ndata, necc);
+			FreeBuffers();
 			return 13;
 		}
 
@@ -662,5 +753,7 @@ main( INT argc, PCHAR argv[])
 	printf("Encode Delta: ");
 	PrintCounter( &EncodeDeltaCounter);
 
+	FreeBuffers();
+
 	return Failures==0 ? 0 : 2;
 }
@@ -65,7 +65,7 @@ endif
 release: OPT=-O3
 release: GFLAG=
 release: CFG=-DNDEBUG
-release: EXTRA_LIBS=
+release: EXTRA_LIBS=-lpthread
 # The target
 release: $(R_DIR)/$(EXE)
 
@@ -73,7 +73,7 @@ release: $(R_DIR)/$(EXE)
 debug  : OPT=
 debug  : GFLAG=-g
 debug  : CFG=-D_DEBUG
-debug  : EXTRA_LIBS=-lstdc++
+debug  : EXTRA_LIBS=-lstdc++ -lpthread
 # The target
 debug  : $(D_DIR)/$(EXE)
 
@@ -363,13 +363,6 @@ TestCombinIter()
 //
 //////////////////////////////////////////////////////////////////////
 
-namespace HoloStor {
-extern UINT32 Mask2Index(
-            UINT32    Mask,               // Bit mask of invalid blocks
-            UINT32    Blocks              // Number of blocks
-            );
-}
-
 #include "Config.h"
 #include "Tuple.hpp"
 #include "CombinIter.hpp"
@@ -398,25 +391,174 @@ void
 TestCodingHash()
 {
 	using namespace std;
-	const unsigned nBlocks = 5;					// test case (must be > MaxK)
+	const unsigned nBlocks = 5;					// test case
 	Moniker moniker("TestCodingHash");
 	moniker.tag() << "nBlocks=" << nBlocks << endl;
 
+	// The indices of a table of 1+4 blocks are 0 thru 30, each once.
+	HOLOSTOR_CFG cfg;
+	cfg.BlockSize = 1024;
+	cfg.DataBlocks = 1;
+	cfg.EccBlocks = nBlocks-1;
+	CodingTable small;
+	small.CodingTableInit(&cfg, HOLOSTOR_FLAG_LAZY);
+	const unsigned nExpected = CodingTable::_MatrixCount(1,nBlocks-1);
+	unsigned used = 0;
 	int nCases = 0;
 	CombinIter iter;
-	for (unsigned r = 0; r <= MaxK; r++) {
-		unsigned max = CodingTable::_MaxHash(nBlocks-r,r);
-		moniker.tag() << r << " faults out of " << nBlocks << " has max hash of " << max << endl;
+	for (unsigned r = 0; r < nBlocks; r++) {
+		moniker.tag() << r << " faults out of " << nBlocks << endl;
 		iter.CombinIterInit(nBlocks, r);
 		Tuple tup;
 		while (iter.Draw(tup)) {
 			long mask = tup.mask();
-			moniker.tag() << bin(mask) << " -> " << dec << Mask2Index(mask, nBlocks) << endl;
+			const CodingIndex index = small._Index(tup);
+			moniker.tag() << bin(mask) << " -> " << (int)index << endl;
+			if (index < nExpected)
+				used |= 1u << index;
 			nCases++;
 		}
 	}
+	unsigned nDistinct = 0;
+	for (unsigned u = used; u != 0; u = BitReset(u))
+		nDistinct++;
 	moniker.tag() << nCases-1 << " non-zero cases counted, " 
-			  << CodingTable::_MatrixCount(nBlocks-MaxK,MaxK) << " cases expected" << endl;
+			  << nExpected << " cases expected, " 
+			  << nDistinct << " distinct indices" << endl;
+
+	// Look up every recovery matrix of some tables, up to MaxK faults (the
+	// lazy tables building them as they go).
+	static const unsigned cases[][3] = {	// n, k, Flags
+		{ 13, 4, 0 }, { 9, 8, 0 }, { 1, MaxK, 0 }, { 8, 6, HOLOSTOR_FLAG_GF256 },
+		{ 9, 8, HOLOSTOR_FLAG_LAZY }, { 8, 6, HOLOSTOR_FLAG_GF256|HOLOSTOR_FLAG_LAZY }
+	};
+	for (unsigned c = 0; c < sizeof(cases)/sizeof(cases[0]); c++) {
+		HOLOSTOR_CFG cfg;
+		cfg.BlockSize = 1024;
+		cfg.DataBlocks = cases[c][0];
+		cfg.EccBlocks = cases[c][1];
+		const unsigned flags = cases[c][2];
+		const unsigned M = cfg.DataBlocks + cfg.EccBlocks;
+		CodingTable table;
+		pcycles_t time = PentiumCycles();
+		int ret = table.CodingTableInit(&cfg, flags);
+		time = PentiumCycles() - time;
+		moniker.tag() << cfg.DataBlocks << "+" << cfg.EccBlocks << ": " <<
+			CodingTable::_MatrixCount(cfg.DataBlocks, cfg.EccBlocks) <<
+			" matrices" << (flags & HOLOSTOR_FLAG_LAZY ? ", lazy" : "") <<
+			" (time = " << (float)time << " cycles)" << endl;
+		if (ret != HOLOSTOR_STATUS_SUCCESS) {
+			moniker.tag() << "CodingTableInit failed: " << ret << endl;
+			continue;
+		}
+		unsigned nFound = 0, nBad = 0;
+		for (unsigned r = 1; r <= cfg.EccBlocks + 1 && r <= M && r <= MaxK; r++) {
+			iter.CombinIterInit(M, r);
+			Tuple tup;
+			while (iter.Draw(tup)) {
+				const CodingMatrix *pMatrix;
+				ret = table.lookup(tup, &pMatrix);
+				const CodingMatrix *pAgain = NULL;	// the same matrix once built
+				if (ret == HOLOSTOR_STATUS_SUCCESS)
+					table.lookup(tup, &pAgain);
+				if (r <= cfg.EccBlocks && ret == HOLOSTOR_STATUS_SUCCESS && pAgain == pMatrix)
+					nFound++;
+				else if (r <= cfg.EccBlocks || ret != HOLOSTOR_STATUS_TOO_MANY_BAD_BLOCKS)
+					nBad++;
+			}
+		}
+		moniker.tag() << nFound << " found, " << nBad << " errors" << endl;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+//	TestCodingRace - Look up the matrices of a lazy table on many threads.
+//
+//////////////////////////////////////////////////////////////////////
+
+#if defined(__linux__)
+#include <pthread.h>
+
+struct CodingRace {
+	const CodingTable *pTable;
+	const CodingTable *pReference;		// the same, built on one thread
+	unsigned n, k;
+	const CodingMatrix **ppFound;	// the matrix of each index, or NULL
+	unsigned nBad;
+};
+
+static void *
+CodingRaceThread(void *arg)
+{
+	CodingRace *pRace = (CodingRace*)arg;
+	for (unsigned r = 1; r <= pRace->k; r++) {
+		CombinIter iter;
+		iter.CombinIterInit(pRace->n + pRace->k, r);
+		Tuple tup;
+		while (iter.Draw(tup)) {
+			// The matrix is whole as soon as it is found.
+			const CodingMatrix *pMatrix, *pExpected;
+			pRace->pReference->lookup(tup, &pExpected);
+			if (pRace->pTable->lookup(tup, &pMatrix) != HOLOSTOR_STATUS_SUCCESS ||
+				::memcmp(pMatrix, pExpected, CodingMatrix::Size(r, pRace->n)) != 0)
+				pRace->nBad++;
+			else
+				pRace->ppFound[pRace->pTable->_Index(tup)] = pMatrix;
+		}
+	}
+	return NULL;
+}
+#endif
+
+void
+TestCodingRace()
+{
+	using namespace std;
+	Moniker moniker("TestCodingRace");
+#if defined(__linux__)
+	const unsigned nThreads = 4, nRounds = 8;
+	HOLOSTOR_CFG cfg;
+	cfg.BlockSize = 1024;
+	cfg.DataBlocks = 13;
+	cfg.EccBlocks = 4;
+	const unsigned nMatrices = CodingTable::_MatrixCount(cfg.DataBlocks, cfg.EccBlocks);
+	CodingTable reference;
+	reference.CodingTableInit(&cfg, 0);
+	unsigned nBad = 0;
+	for (unsigned round = 0; round < nRounds; round++) {
+		// The threads draw the faults in the same order, to race for each.
+		CodingTable table;
+		table.CodingTableInit(&cfg, HOLOSTOR_FLAG_LAZY);
+		pthread_t threads[nThreads];
+		CodingRace races[nThreads];
+		for (unsigned t = 0; t < nThreads; t++) {
+			races[t].pTable = &table;
+			races[t].pReference = &reference;
+			races[t].n = cfg.DataBlocks;
+			races[t].k = cfg.EccBlocks;
+			races[t].ppFound = new const CodingMatrix* [nMatrices];
+			::memset(races[t].ppFound, 0, nMatrices*sizeof(CodingMatrix*));
+			races[t].nBad = 0;
+			pthread_create(&threads[t], NULL, CodingRaceThread, &races[t]);
+		}
+		for (unsigned t = 0; t < nThreads; t++)
+			pthread_join(threads[t], NULL);
+		// Each thread found the same matrix.
+		for (unsigned i = 0; i < nMatrices; i++)
+			for (unsigned t = 1; t < nThreads; t++)
+				if (races[t].ppFound[i] != races[0].ppFound[i])
+					nBad++;
+		for (unsigned t = 0; t < nThreads; t++) {
+			nBad += races[t].nBad;
+			delete [] races[t].ppFound;
+		}
+	}
+	if (nBad != 0)
+		moniker.tag() << "bad lookups: " << nBad << endl;
+	moniker.tag() << nRounds << " rounds of " << nThreads << " threads over " <<
+		nMatrices << " matrices" << endl;
+#endif
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -429,10 +571,15 @@ void
 TestBench()
 {
 	using namespace std;
-	const unsigned nBlocks = 17;	// number of blocks for Mask2Index()
 	unsigned mask = 0x11101;	// test case (4 bits out of 17)
 	Moniker moniker("TestBench");
-	moniker.tag() << "nBlocks=" << nBlocks << ", mask=" << bin(mask) << endl;
+	moniker.tag() << "mask=" << bin(mask) << endl;
+	HOLOSTOR_CFG cfg;
+	cfg.BlockSize = 1024;
+	cfg.DataBlocks = 13;
+	cfg.EccBlocks = 4;
+	CodingTable table;
+	table.CodingTableInit(&cfg, HOLOSTOR_FLAG_LAZY);
 	pcycles_t time;
 	while (mask) {
 		unsigned n;
@@ -442,10 +589,17 @@ TestBench()
 		time = PentiumCycles() - time;
 		moniker.tag() << "back-to-back timing: " << (int)time << " cycles" << endl;
 		//
+		Tuple tup;						// the bits of mask in descending order
+		tup.setDim(0);
+		for (unsigned u = mask; u != 0; u = BitReset(u))
+			tup.setDim(tup.getDim()+1);
+		unsigned i = tup.getDim();
+		for (unsigned u = mask; u != 0; u = BitReset(u))
+			tup(--i) = BitScan(u);
 		time = PentiumCycles();
-		n = Mask2Index(mask, nBlocks);
+		n = table._Index(tup);
 		time = PentiumCycles() - time;
-		moniker.tag() << "Mask2Index:" << (int)time << " cycles" << endl;
+		moniker.tag() << "_Index returns " << n << ": " << (int)time << " cycles" << endl;
 		//
 		time = PentiumCycles();
 		n = BitScan(mask);
@@ -484,6 +638,208 @@ TestGF2Mul()
 	GF2Mul::dump();
 }
 
+//////////////////////////////////////////////////////////////////////
+//
+//	TestGF2MulMethods - Compare GF2Mul::gf2multadd() for each method
+//						supported in HW against the standard method.
+//
+//////////////////////////////////////////////////////////////////////
+
+void
+TestGF2MulMethods()
+{
+	using namespace std;
+	Moniker moniker("TestGF2MulMethods");
+	const unsigned nMaxElements = 5;		// exercise odd and even counts
+	const unsigned nBytes = nMaxElements*sizeof(Element);
+	char *pSrc = _AlignedAlloc(nBytes, 16);
+	char *pRef = _AlignedAlloc(nBytes, 16);
+	char *pDst = _AlignedAlloc(nBytes, 16);
+	for (unsigned i = 0; i < nBytes; i++) {
+		pSrc[i] = (char)(i*7 + 3);
+		pRef[i] = (char)(i*13 + 1);
+	}
+	unsigned nMethod = ~0u;
+	HoloStor_SetMethod(&nMethod);			// highest method supported in HW
+	const unsigned nSavedCpuType = CpuType;
+	int nErrors = 0;
+	for (unsigned method = CPU_MMX; method <= nMethod; method++) {
+		for (unsigned v = 0; v < gfQ::order; v++) {
+			for (unsigned n = 1; n <= nMaxElements; n++) {
+				char expect[nBytes];
+				::memcpy(expect, pRef, nBytes);
+				::memcpy(pDst, pRef, nBytes);
+				CpuType = CPU_STD;
+				GF2Mul(v).gf2multadd((hyperword_t*)expect, (hyperword_t*)pSrc, n);
+				CpuType = method;
+				GF2Mul(v).gf2multadd((hyperword_t*)pDst, (hyperword_t*)pSrc, n);
+				if (::memcmp(expect, pDst, nBytes) != 0) {
+					moniker.tag() << "method " << method << " differs for multiplier "
+						<< v << " over " << n << " elements" << endl;
+					nErrors++;
+				}
+			}
+		}
+	}
+	CpuType = nSavedCpuType;
+	moniker.tag() << "methods 1 to " << nMethod << " checked, "
+		<< nErrors << " errors" << endl;
+	_AlignedFree(pSrc, 16);
+	_AlignedFree(pRef, 16);
+	_AlignedFree(pDst, 16);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+//	TestGF2Mul256 - Check the bit-sliced GF(2**8) kernels of each method
+//					supported in HW against GF256 arithmetic.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "GF2Mul256.hpp"
+
+// Convert between bytes and the bit-sliced layout of nSymbols symbols.
+static void
+BitSlice(unsigned char *pSliced, const unsigned char *pSymbols, unsigned nSymbols)
+{
+	const unsigned nSlice = GF2Mul256::SliceSize();
+	const unsigned nPlane = sizeof(Element);
+	::memset(pSliced, 0, nSymbols);
+	for (unsigned t = 0; t < nSymbols; t++)
+		for (unsigned i = 0; i < 8; i++)
+			if (pSymbols[t]>>i & 1)
+				pSliced[t/nSlice*nSlice + i*nPlane + t%nSlice/8] |= 1u << (t%8);
+}
+
+static void
+BitUnslice(unsigned char *pSymbols, const unsigned char *pSliced, unsigned nSymbols)
+{
+	const unsigned nSlice = GF2Mul256::SliceSize();
+	const unsigned nPlane = sizeof(Element);
+	::memset(pSymbols, 0, nSymbols);
+	for (unsigned t = 0; t < nSymbols; t++)
+		for (unsigned i = 0; i < 8; i++)
+			if (pSliced[t/nSlice*nSlice + i*nPlane + t%nSlice/8] >> (t%8) & 1)
+				pSymbols[t] |= 1u << i;
+}
+
+void
+TestGF2Mul256()
+{
+	using namespace std;
+	Moniker moniker("TestGF2Mul256");
+	const unsigned nSlices = 5;				// more than a chunk of multsum()
+	const unsigned nBytes = nSlices*GF2Mul256::SliceSize();
+	const unsigned nElements = nBytes/sizeof(Element);
+	unsigned char *pSymbols[3], *pSliced[3];
+	for (unsigned k = 0; k < 3; k++) {
+		pSymbols[k] = (unsigned char*)_AlignedAlloc(nBytes, 16);
+		pSliced[k] = (unsigned char*)_AlignedAlloc(nBytes, 16);
+		for (unsigned t = 0; t < nBytes; t++)
+			pSymbols[k][t] = (unsigned char)(t*(7+2*k) + 3*k + (t>>8));
+	}
+	unsigned char *pExpect = (unsigned char*)_AlignedAlloc(nBytes, 16);
+	unsigned char *pResult = (unsigned char*)_AlignedAlloc(nBytes, 16);
+	unsigned nMethod = ~0u;
+	HoloStor_SetMethod(&nMethod);			// highest method supported in HW
+	int nErrors = 0;
+	for (unsigned method = CPU_STD; method <= nMethod; method++) {
+		const GF256Kernels& kernels = GF2Mul256::Kernels(method);
+		// multadd: pSymbols[1] += v*pSymbols[0]
+		BitSlice(pSliced[0], pSymbols[0], nBytes);
+		for (unsigned v = 0; v < GF256::order; v++) {
+			BitSlice(pSliced[1], pSymbols[1], nBytes);
+			kernels.multadd((hyperword_t*)pSliced[1], (hyperword_t*)pSliced[0], nElements, v);
+			BitUnslice(pResult, pSliced[1], nBytes);
+			for (unsigned t = 0; t < nBytes; t++)
+				pExpect[t] = pSymbols[1][t] ^ (GF256(v) * GF256(pSymbols[0][t])).regular();
+			if (::memcmp(pExpect, pResult, nBytes) != 0) {
+				moniker.tag() << "method " << method << " multadd differs for multiplier "
+					<< v << endl;
+				nErrors++;
+			}
+		}
+		if (kernels.multsum == NULL)
+			continue;
+		// multsum: pSymbols[2] = v0*pSymbols[0] + v1*pSymbols[1]
+		BitSlice(pSliced[1], pSymbols[1], nBytes);
+		for (unsigned v = 0; v < GF256::order; v++) {
+			const unsigned char Value[2] = { (unsigned char)v, (unsigned char)(255-v) };
+			hyperword_t *pDst = (hyperword_t*)pSliced[2];
+			const hyperword_t *pSrcs[2] = {
+				(const hyperword_t*)pSliced[0], (const hyperword_t*)pSliced[1]
+			};
+			kernels.multsum(&pDst, 1, pSrcs, 2, Value, nElements, (v&1) != 0);
+			BitUnslice(pResult, pSliced[2], nBytes);
+			for (unsigned t = 0; t < nBytes; t++)
+				pExpect[t] = ((GF256(Value[0]) * GF256(pSymbols[0][t])) +
+							  (GF256(Value[1]) * GF256(pSymbols[1][t]))).regular();
+			if (::memcmp(pExpect, pResult, nBytes) != 0) {
+				moniker.tag() << "method " << method << " multsum differs for multipliers "
+					<< v << "," << 255-v << endl;
+				nErrors++;
+			}
+		}
+	}
+	moniker.tag() << "methods 0 to " << nMethod << " checked, "
+		<< nErrors << " errors" << endl;
+	for (unsigned k = 0; k < 3; k++) {
+		_AlignedFree((char*)pSymbols[k], 16);
+		_AlignedFree((char*)pSliced[k], 16);
+	}
+	_AlignedFree((char*)pExpect, 16);
+	_AlignedFree((char*)pResult, 16);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+//	TestXorSchedule - Check the field of the compile-time XOR schedules
+//					  against GF16 and report their XOR counts.
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifdef	SIMD_INTRINSICS
+#include "XorSchedule.hpp"
+
+void
+TestXorSchedule()
+{
+	using namespace std;
+	Moniker moniker("TestXorSchedule");
+	int nErrors = 0;
+	for (unsigned a = 0; a < gfQ::order; a++)
+		for (unsigned b = 0; b < gfQ::order; b++)
+			if (GF16Mul(a, b) != (gfQ(a) * gfQ(b)).regular())
+				nErrors++;
+	unsigned nXORs = 0, nOnes = 0;
+	for (unsigned v = 0; v < gfQ::order; v++) {
+		nXORs += MakeXorSchedule(v).nOps;
+		for (unsigned j = 0; j < ELEMENT_WIDTH; j++)
+			for (unsigned u = GF16Mul(v, 1u<<j); u != 0; u >>= 1)
+				nOnes += u & 1;
+	}
+	moniker.tag() << nXORs << " XORs for " << nOnes << " matrix ones, "
+		<< nErrors << " errors" << endl;
+	// The same for the 8x8 schedules of GF(2**8).
+	nErrors = 0;
+	for (unsigned a = 0; a < GF256::order; a++)
+		for (unsigned b = 0; b < GF256::order; b++)
+			if (GFMul(a, b, 8) != (GF256(a) * GF256(b)).regular())
+				nErrors++;
+	nXORs = nOnes = 0;
+	for (unsigned v = 0; v < GF256::order; v++) {
+		nXORs += MakeXorSchedule<8>(v).nOps;
+		for (unsigned j = 0; j < 8; j++)
+			for (unsigned u = GFMul(v, 1u<<j, 8); u != 0; u >>= 1)
+				nOnes += u & 1;
+	}
+	moniker.tag() << nXORs << " XORs for " << nOnes << " GF(2**8) matrix ones, "
+		<< nErrors << " errors" << endl;
+}
+#else
+void TestXorSchedule() {}
+#endif
+
 //////////////////////////////////////////////////////////////////////
 //
 //	TestGF - Compare results of operations over GF16 with gf2pow<4>.
@@ -545,18 +901,19 @@ TestGFBench()
 #include "IDA.hpp"
 #include "MathUtils.hpp"
 
-void TestMatrix()
+void TestMatrix(bool bMinXor)
 {
 	using namespace std;
 	Moniker moniker("TestMatrix");
 	const int n = 13;				// test case
 	const int k = 4;
-	moniker.tag() << "n=" << n << ", k=" << k << endl;
+	moniker.tag() << "n=" << n << ", k=" << k << (bMinXor ? ", MinXor" : "") << endl;
 	IDA ida;
-	ida.IDAInit(n, k);
+	ida.IDAInit(n, k, bMinXor);
 	moniker.tag() << "Attention! Visually inspect the following encoding matrix: " << endl;
-	matrix<GF16> mx = IDA::EncodeMatrix(n+k, n);
+	matrix<GF16> mx = IDA::EncodeMatrix(n+k, n, bMinXor);
 	mx.print("IDA::Encode");		// silent unless Debug library
+	moniker.tag() << "weight " << IDA::MatrixWeight(mx) << endl;
 	//
 	moniker.tag() << "Standby... Checking all possible combinations of submatrices. " << endl;
 	pcycles_t time = PentiumCycles();
@@ -597,6 +954,111 @@ void TestMatrix()
 					 (float)time << " cycles)" << endl;
 }
 
+//////////////////////////////////////////////////////////////////////
+//
+//	TestMinXor - Compare the weight of the default and MinXor encoding
+//				 matrices (the XORs of the bit-sliced kernels).
+//
+//////////////////////////////////////////////////////////////////////
+
+void TestMinXor()
+{
+	using namespace std;
+	Moniker moniker("TestMinXor");
+	static const unsigned cases[][3] = {	// n, k, GF(2**8)
+		{ 4, 2, 0 }, { 8, 3, 0 }, { 13, 4, 0 }, { 16, 1, 0 },
+		{ 13, 4, 1 }, { 40, 4, 1 }
+	};
+	for (unsigned c = 0; c < sizeof(cases)/sizeof(cases[0]); c++) {
+		const unsigned n = cases[c][0], k = cases[c][1];
+		unsigned w0, w1;
+		pcycles_t time;
+		if (cases[c][2]) {
+			w0 = IDA256::MatrixWeight(IDA256::EncodeMatrix(n+k, n));
+			time = PentiumCycles();
+			w1 = IDA256::MatrixWeight(IDA256::EncodeMatrix(n+k, n, true));
+		} else {
+			w0 = IDA::MatrixWeight(IDA::EncodeMatrix(n+k, n));
+			time = PentiumCycles();
+			w1 = IDA::MatrixWeight(IDA::EncodeMatrix(n+k, n, true));
+		}
+		time = PentiumCycles() - time;
+		const unsigned wI = n * (cases[c][2] ? 8 : 4);	// of the systematic rows
+		moniker.tag() << (cases[c][2] ? "GF(2**8) " : "GF(2**4) ") << n << "+" << k <<
+			": ECC rows weight " << w0 - wI << " -> " << w1 - wI <<
+			" (search = " << (float)time << " cycles)" << endl;
+		if (w1 > w0)
+			moniker.tag() << "MinXor matrix is heavier than the default" << endl;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+//	TestDecodeCost - Check that the recovery matrices use valid rows and
+//					 weigh no more than those of the lowest numbered ones.
+//
+//////////////////////////////////////////////////////////////////////
+
+template <class gf> static void
+DecodeCost(Moniker& moniker, unsigned n, unsigned k, bool bMinXor)
+{
+	using namespace std;
+	IDAT<gf> ida;
+	ida.IDAInit(n, k, bMinXor);
+	matrix<gf> mx = IDAT<gf>::EncodeMatrix(n+k, n, bMinXor);
+	unsigned wLow = 0, wUsed = 0, nCases = 0;
+	for (unsigned e = 1; e <= k; e++) {
+		CombinIter iter;
+		iter.CombinIterInit(n+k, e);
+		Tuple faults;
+		while (iter.Draw(faults)) {
+			nCases++;
+			matrix<gf> mCoding;
+			UCHAR rowsUsed[MaxBlocks];
+			if ( !ida.GenerateCoding(faults, mCoding, rowsUsed) ) {
+				moniker.tag() << "GenerateCoding failed" << endl;
+				return;
+			}
+			for (unsigned j = 0; j < n; j++)
+				if ( faults.isMember(rowsUsed[j]) || (j > 0 && rowsUsed[j] <= rowsUsed[j-1]) )
+					moniker.tag() << "bad row " << (unsigned)rowsUsed[j] << " used" << endl;
+			// The recovery from the n lowest numbered valid rows.
+			matrix<gf> aa(n,n), bb, ff(e,n);
+			for (unsigned iSrc = 0, iDst = 0; iDst < n; iSrc++)
+				if (!faults.isMember(iSrc)) {
+					for (unsigned j = 0; j < n; j++)
+						aa(iDst,j) = mx(iSrc,j);
+					iDst++;
+				}
+			for (unsigned i = 0; i < e; i++)
+				for (unsigned j = 0; j < n; j++)
+					ff(i,j) = mx(faults(i),j);
+			if ( !aa.inverse(bb) ) {
+				moniker.tag() << "inverse failed" << endl;
+				return;
+			}
+			const unsigned w0 = IDAT<gf>::MatrixWeight(ff * bb);
+			const unsigned w1 = IDAT<gf>::MatrixWeight(mCoding);
+			if (w1 > w0)
+				moniker.tag() << "recovery heavier than that of the lowest rows" << endl;
+			wLow += w0;
+			wUsed += w1;
+		}
+	}
+	moniker.tag() << (gf::degree == 8 ? "GF(2**8) " : "GF(2**4) ") << n << "+" << k <<
+		(bMinXor ? " MinXor" : "") << ": " << nCases << " recoveries weight " <<
+		wLow << " -> " << wUsed << endl;
+}
+
+void TestDecodeCost()
+{
+	Moniker moniker("TestDecodeCost");
+	DecodeCost<GF16>(moniker, 8, 3, false);
+	DecodeCost<GF16>(moniker, 8, 3, true);
+	DecodeCost<GF16>(moniker, 12, 4, true);
+	DecodeCost<GF256>(moniker, 13, 4, true);
+}
+
 //////////////////////////////////////////////////////////////////////
 //
 //	TestNilMatrix - Exercise Nil propagation in matrix 
@@ -632,11 +1094,18 @@ void RunTests()
 	TestCombinIter();
 	TestGF2Mul();
 	//
+	TestGF2MulMethods();
+	TestXorSchedule();
+	TestGF2Mul256();
 	TestCodingHash();
+	TestCodingRace();
 	TestBench();
 	TestGF();
 	TestGFBench();
 	TestNilMatrix();
-	TestMatrix();
+	TestMatrix(false);
+	TestMatrix(true);
+	TestMinXor();
+	TestDecodeCost();
 	TestInterface();
 }
@@ -40,7 +40,7 @@ WARNINGS = -Wall
 CPPFLAGS = $(CFG) -I.. -I../HoloStorLib -I../Extras 
 CXXFLAGS = $(WARNINGS) $(GFLAG) $(OPT) -fno-exceptions -fno-rtti
 LDFLAGS = $(GFLAG)
-EXTRA_LIBS =
+EXTRA_LIBS = -lpthread
 #
 R_DIR = LinuxRelease
 D_DIR = LinuxDebug